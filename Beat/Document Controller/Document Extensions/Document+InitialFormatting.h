@@ -16,13 +16,10 @@ NS_ASSUME_NONNULL_BEGIN
 -(void)renderDocument;
 
 /**
- Applies the initial formatting while document is loading. We'll create a temporary formatting object and attributed string to handle rendering off screen, and the text storage contents are put into text view after formatting is complete. This cuts the formatting time for longer documents to half.
+ Applies the initial formatting while document is loading. Attributes are calculated in the background, and the lines around the stored caret position are applied first. The document is revealed as soon as that part is styled, and the rest of the text is formatted in small slices on main thread.
  */
 -(void)applyInitialFormatting;
 
-/// Asynchronous formatting. Takes in an index and formats a bunch of parsed lines starting from that index, applying the formatting attributes to given attributed string. This avoids beach ball when opening a large document.
-- (void)formatAllWithDelayFrom:(NSInteger)idx formattedString:(NSMutableAttributedString*)formattedString;
-
 
 @end
 
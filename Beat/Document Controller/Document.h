@@ -236,13 +236,6 @@ THE SOFTWARE.
 
 #pragma mark - Initial formatting
 
-/// This class handles the first-time format of the editor text to spare some CPU time. It has to be retained in memory but can be released once loading is complete.
-@property (nonatomic) BeatEditorFormatting* _Nullable initialFormatting;
-/// When loading longer documents, we need to show a progress panel
-@property (nonatomic) NSPanel* _Nullable progressPanel;
-/// The indicator for above panel
-@property (nonatomic) NSProgressIndicator* _Nullable progressIndicator;
-
 - (void)loadingComplete;
 
 @end
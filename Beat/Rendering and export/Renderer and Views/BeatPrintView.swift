@@ -138,7 +138,7 @@ class BeatPrintView:NSView {
 			
 			DispatchQueue.main.sync {
 				// PDF operations require a URL. Temporary one for preview, user-selected for export.
-				if self.operation == .toPreview {
+				if self.operation == .toPreview || self.operation == .toFile {
 					self.url = self.tempURL()
 				}
 				else if self.operation == .toPDF {
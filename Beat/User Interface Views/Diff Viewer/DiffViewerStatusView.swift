@@ -12,6 +12,9 @@ class DiffViewerStatusView: NSView {
 	@IBOutlet weak var icon: NSImageView?
 	@IBOutlet weak var text: NSTextField?
 	
+	private var progressIndicator: NSProgressIndicator?
+	private var progressObservation: NSKeyValueObservation?
+	
 	func update(uncommitedChanges: Bool) {
 		if uncommitedChanges {
 			if #available(macOS 11.0, *) {
@@ -29,4 +32,36 @@ class DiffViewerStatusView: NSView {
 			text?.stringValue = "Up to date"
 		}
 	}
+	
+	/// Shows progress of a background operation in place of commit status
+	func showProgress(_ progress: Progress, label: String) {
+		if progressIndicator == nil {
+			let indicator = NSProgressIndicator(frame: NSRect(x: self.frame.width - 130, y: (self.frame.height - 12) / 2, width: 120, height: 12))
+			indicator.style = .bar
+			indicator.controlSize = .small
+			indicator.isIndeterminate = false
+			indicator.minValue = 0.0
+			indicator.maxValue = 1.0
+			indicator.autoresizingMask = [.minXMargin]
+			self.addSubview(indicator)
+			progressIndicator = indicator
+		}
+		
+		progressIndicator?.doubleValue = 0.0
+		progressIndicator?.isHidden = false
+		text?.stringValue = label
+		
+		// Progress is updated from a background thread
+		progressObservation = progress.observe(\.fractionCompleted) { [weak self] progress, _ in
+			DispatchQueue.main.async {
+				self?.progressIndicator?.doubleValue = progress.fractionCompleted
+			}
+		}
+	}
+	
+	func hideProgress() {
+		progressObservation?.invalidate()
+		progressObservation = nil
+		progressIndicator?.isHidden = true
+	}
 }
@@ -41,6 +41,9 @@ class DiffViewerViewController: NSViewController {
 	
 	private var externalFiles:[URL] = []
 	
+	/// Progress of background revision generation, if running
+	private var revisionProgress:Progress?
+	
 	private var originalTarget: VersionItem = VersionItem(timestamp: "base") {
 		didSet {
 			otherVersionMenu?.selectCommit(originalTarget)
@@ -496,17 +499,30 @@ class DiffViewerViewController: NSViewController {
 	// MARK: - Revision menu
 	
 	func generateRevisions(generation:Int) {
-		guard let vc else { return }
+		guard let vc, revisionProgress == nil else { return }
 		
+		// Diffing is done in background and the ranges are applied once it's done
+		let completion:(Bool) -> Void = { [weak self] applied in
+			self?.revisionProgress = nil
+			self?.statusView?.hideProgress()
+			self?.refreshView()
+			
+			if applied { self?.close(nil) }
+		}
+		
+		let progress:Progress
 		if let _ = originalTarget.URL, let text = originalText, text.count > 0 {
 			// This is an external diff file
-			vc.generateRevisedRanges(fromText: text, generation: generation)
+			progress = vc.generateRevisedRanges(fromText: text, generation: generation, completion: completion)
 		} else {
 			// This is a timestamp from internal VC
-			vc.generateRevisedRanges(from: self.originalTarget.timestamp, generation: generation)
+			progress = vc.generateRevisedRanges(from: self.originalTarget.timestamp, generation: generation, completion: completion)
 		}
 		
-		self.close(nil)
+		revisionProgress = progress
+		generateRevisionsButton?.isEnabled = false
+		statusView?.isHidden = false
+		statusView?.showProgress(progress, label: "Generating revisions...")
 	}
 	
 	
@@ -519,6 +535,12 @@ class DiffViewerViewController: NSViewController {
 	}
 	
 	override func cancelOperation(_ sender: Any?) {
+		// First escape cancels revision generation
+		if let revisionProgress {
+			revisionProgress.cancel()
+			return
+		}
+		
 		close(sender)
 	}
 	
@@ -7,6 +7,10 @@
 //
 
 #import <XCTest/XCTest.h>
+#import <BeatParsing/BeatParsing.h>
+#import <BeatCore/BeatCore.h>
+#import <BeatCore/BeatCore-Swift.h>
+#import <BeatFileExport/BeatFileExport.h>
 
 @interface BeatTests : XCTestCase
 
@@ -27,6 +31,85 @@
     // Use XCTAssert and related functions to verify your tests produce the correct results.
 }
 
+/// Committed base texts have no settings block, so the scenes need to be matched without UUIDs, even if both drafts have them
+- (void)testThreeWayMergeWithoutBaseUUIDs {
+    NSString* base = @"INT. HOUSE - DAY\n\nJohn enters.\n\nEXT. STREET - NIGHT\n\nMary waits.\n";
+    NSString* ours = @"INT. HOUSE - DAY\n\nJohn enters quietly.\n\nEXT. STREET - NIGHT\n\nMary waits.\n";
+    NSString* theirs = @"INT. HOUSE - DAY\n\nJohn enters.\n\nEXT. STREET - NIGHT\n\nMary waits in the rain.\n";
+    
+    BeatDocumentSettings* settings = BeatDocumentSettings.new;
+    [settings set:DocSettingHeadingUUIDs as:@[
+        @{ @"uuid": NSUUID.UUID.UUIDString, @"string": @"INT. HOUSE - DAY" },
+        @{ @"uuid": NSUUID.UUID.UUIDString, @"string": @"EXT. STREET - NIGHT" }
+    ]];
+    NSString* settingsString = settings.getSettingsString;
+    
+    BeatThreeWayMerge* merge = [BeatThreeWayMerge.alloc initWithBase:base ours:[ours stringByAppendingString:settingsString] theirs:[theirs stringByAppendingString:settingsString]];
+    BeatMergeResult* result = merge.merge;
+    
+    XCTAssertEqual(result.conflicts, 0);
+    XCTAssertTrue([result.text containsString:@"John enters quietly."]);
+    XCTAssertTrue([result.text containsString:@"Mary waits in the rain."]);
+    XCTAssertFalse([result.text containsString:@"MERGE CONFLICT"]);
+}
+
+/// Renaming a heading on one side and editing the same scene on the other shouldn't duplicate the scene when the base has no UUIDs
+- (void)testThreeWayMergeRenamedHeading {
+    NSString* base = @"INT. HOUSE - DAY\n\nJohn enters.\n\nEXT. STREET - NIGHT\n\nMary waits.\n";
+    NSString* ours = @"INT. CABIN - DAY\n\nJohn enters.\n\nEXT. STREET - NIGHT\n\nMary waits.\n";
+    NSString* theirs = @"INT. HOUSE - DAY\n\nJohn enters quietly.\n\nEXT. STREET - NIGHT\n\nMary waits.\n";
+    
+    BeatThreeWayMerge* merge = [BeatThreeWayMerge.alloc initWithBase:base ours:ours theirs:theirs];
+    BeatMergeResult* result = merge.merge;
+    
+    XCTAssertEqual(result.conflicts, 0);
+    XCTAssertTrue([result.text hasPrefix:@"INT. CABIN - DAY\n\nJohn enters quietly.\n\nEXT. STREET - NIGHT\n\nMary waits."]);
+    XCTAssertFalse([result.text containsString:@"INT. HOUSE"]);
+}
+
+/// A lone surrogate followed by an escaped character produces a replacement character and an entity for a single unit. Write it right at the end of the buffer (64 kB).
+- (void)testXMLStreamWriterLoneSurrogateAtBufferBoundary {
+    NSString* tail = [NSString stringWithFormat:@"%C\"", (unichar)0xD800];
+    
+    for (NSInteger prefixLength = 65500; prefixLength <= 65540; prefixLength++) {
+        NSString* prefix = [@"" stringByPaddingToLength:prefixLength withString:@"a" startingAtIndex:0];
+        
+        NSOutputStream* stream = NSOutputStream.outputStreamToMemory;
+        [stream open];
+        
+        BeatXMLStreamWriter* writer = [BeatXMLStreamWriter.alloc initWithOutputStream:stream];
+        [writer write:prefix];
+        [writer writeEscaped:tail];
+        XCTAssertTrue([writer flush]);
+        
+        NSData* data = [stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey];
+        NSString* expected = [prefix stringByAppendingString:@"\uFFFD&quot;"];
+        XCTAssertEqualObjects([NSString.alloc initWithData:data encoding:NSUTF8StringEncoding], expected);
+        
+        [stream close];
+    }
+}
+
+/// Reverting commits shouldn't leave their content in the archive
+- (void)testVersionControlArchiveDropsRevertedStrings {
+    NSString* base = @"INT. HOUSE - DAY\n\nJohn enters.\n";
+    
+    BeatVersionControlArchive* archive = [BeatVersionControlArchive.alloc initWithBaseText:base];
+    [archive addCommitWithText:@"INT. HOUSE - DAY\n\nJohn enters.\n\nMary follows.\n" timestamp:@"2026-10-19 10:00" message:@"First"];
+    [archive addCommitWithText:@"INT. HOUSE - DAY\n\nJohn leaves.\n" timestamp:@"2026-10-19 11:00" message:@"Second"];
+    
+    [archive removeCommitsAfter:@"2026-10-19 10:00"];
+    XCTAssertEqual(archive.commitCount, 1);
+    XCTAssertEqualObjects([archive textAt:nil], @"INT. HOUSE - DAY\n\nJohn enters.\n\nMary follows.\n");
+    
+    [archive removeCommitsAfter:nil];
+    XCTAssertEqualObjects(archive.encodedString, [BeatVersionControlArchive.alloc initWithBaseText:base].encodedString);
+    
+    BeatVersionControlArchive* decoded = [BeatVersionControlArchive archiveWithEncodedString:archive.encodedString];
+    XCTAssertEqualObjects(decoded.baseText, base);
+    XCTAssertEqual(decoded.commitCount, 0);
+}
+
 - (void)testPerformanceExample {
     // This is an example of a performance test case.
     [self measureBlock:^{
@@ -61,6 +61,7 @@ FOUNDATION_EXPORT const unsigned char BeatCoreVersionString[];
 #import <BeatCore/NSString+Compression.h>
 
 #import <BeatCore/BeatVersionControl.h>
+#import <BeatCore/BeatVersionControlArchive.h>
 
 #import <BeatCore/BeatReviewExports.h>
 
@@ -64,6 +64,7 @@ NS_ASSUME_NONNULL_END
 @protocol BeatPluginAgentInstance
 - (void)updatePlugins:(NSRange)range;
 - (void)updatePluginsWithOutline:(NSArray* _Nonnull)outline changes:(OutlineChanges* _Nullable)changes;
+- (void)lineWasRemoved:(Line* _Nonnull)line;
 @end
 
 /// This is a protocol for the generic preview controller. Because of cross-framework mess, we can't use the actual controller here.
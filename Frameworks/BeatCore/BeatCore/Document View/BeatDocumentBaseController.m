@@ -355,6 +355,8 @@
 {
     if (_currentLine == line) _currentLine = nil;
     if (_previouslySelectedLine == line) _previouslySelectedLine = nil;
+    
+    [(id<BeatPluginAgentInstance>)self.pluginAgent lineWasRemoved:line];
 }
 
 
@@ -0,0 +1,27 @@
+//
+//  BeatAttributeBuffer.h
+//  BeatCore
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+/**
+ 
+ A scratch attributed string which holds the attributes for a single range of a larger text storage.
+ Formatting code can read and write attributes as if it was the actual text storage, but changes inside the range are only kept in the buffer.
+ When calling `commit`, the buffered attribute runs are compared to the ones in text storage, and only the runs which actually differ are written back.
+ 
+ Character replacements are passed straight to the text storage.
+ 
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface BeatAttributeBuffer : NSMutableAttributedString
+- (instancetype)initWithTextStorage:(NSMutableAttributedString*)textStorage range:(NSRange)range;
+/// Writes changed attribute runs to text storage in a single editing transaction. Returns the number of modified ranges.
+- (NSInteger)commit;
+@end
+
+NS_ASSUME_NONNULL_END
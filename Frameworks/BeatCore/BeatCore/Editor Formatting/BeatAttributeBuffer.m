@@ -0,0 +1,128 @@
+//
+//  BeatAttributeBuffer.m
+//  BeatCore
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+#import "BeatAttributeBuffer.h"
+
+@implementation BeatAttributeBuffer {
+    NSMutableAttributedString* _textStorage;
+    NSMutableAttributedString* _buffer;
+    NSRange _range;
+}
+
+- (instancetype)initWithTextStorage:(NSMutableAttributedString*)textStorage range:(NSRange)range
+{
+    self = [super init];
+    if (self) {
+        _textStorage = textStorage;
+        _range = range;
+        _buffer = [textStorage attributedSubstringFromRange:range].mutableCopy;
+    }
+    return self;
+}
+
+#pragma mark - Primitives
+
+- (NSString *)string
+{
+    return _textStorage.string;
+}
+
+- (NSDictionary<NSAttributedStringKey,id> *)attributesAtIndex:(NSUInteger)location effectiveRange:(NSRangePointer)range
+{
+    if (NSLocationInRange(location, _range)) {
+        NSRange localRange;
+        NSDictionary* attributes = [_buffer attributesAtIndex:location - _range.location effectiveRange:&localRange];
+        if (range != NULL) *range = NSMakeRange(localRange.location + _range.location, localRange.length);
+        return attributes;
+    }
+    
+    // Outside the buffered range we'll return the actual attributes, but don't let the run overlap the buffer
+    NSRange effectiveRange;
+    NSDictionary* attributes = [_textStorage attributesAtIndex:location effectiveRange:&effectiveRange];
+    
+    if (location < _range.location && NSMaxRange(effectiveRange) > _range.location) {
+        effectiveRange.length = _range.location - effectiveRange.location;
+    } else if (location >= NSMaxRange(_range) && effectiveRange.location < NSMaxRange(_range)) {
+        effectiveRange.length = NSMaxRange(effectiveRange) - NSMaxRange(_range);
+        effectiveRange.location = NSMaxRange(_range);
+    }
+    
+    if (range != NULL) *range = effectiveRange;
+    return attributes;
+}
+
+- (void)setAttributes:(NSDictionary<NSAttributedStringKey,id> *)attrs range:(NSRange)range
+{
+    NSRange bufferedRange = NSIntersectionRange(range, _range);
+    
+    if (bufferedRange.length > 0) {
+        [_buffer setAttributes:attrs range:NSMakeRange(bufferedRange.location - _range.location, bufferedRange.length)];
+    }
+    
+    // Anything outside the buffer goes directly to text storage
+    if (range.location < _range.location) {
+        [_textStorage setAttributes:attrs range:NSMakeRange(range.location, MIN(NSMaxRange(range), _range.location) - range.location)];
+    }
+    if (NSMaxRange(range) > NSMaxRange(_range)) {
+        NSUInteger location = MAX(range.location, NSMaxRange(_range));
+        [_textStorage setAttributes:attrs range:NSMakeRange(location, NSMaxRange(range) - location)];
+    }
+}
+
+- (void)replaceCharactersInRange:(NSRange)range withString:(NSString *)str
+{
+    [_textStorage replaceCharactersInRange:range withString:str];
+    
+    // Keep the buffer in sync when the change happens inside it
+    if (range.location >= _range.location && NSMaxRange(range) <= NSMaxRange(_range)) {
+        [_buffer replaceCharactersInRange:NSMakeRange(range.location - _range.location, range.length) withString:str];
+        _range.length = _range.length - range.length + str.length;
+    } else {
+        _buffer = [_textStorage attributedSubstringFromRange:_range].mutableCopy;
+    }
+}
+
+#pragma mark - Committing changes
+
+- (NSInteger)commit
+{
+    NSMutableArray<NSValue*>* ranges = NSMutableArray.new;
+    NSMutableArray<NSDictionary*>* attributes = NSMutableArray.new;
+    
+    NSMutableAttributedString* textStorage = _textStorage;
+    NSUInteger offset = _range.location;
+    
+    [_buffer enumerateAttributesInRange:NSMakeRange(0, _buffer.length) options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
+        NSRange globalRange = NSMakeRange(range.location + offset, range.length);
+        NSUInteger i = globalRange.location;
+        
+        // Compare each of the current runs inside this range
+        while (i < NSMaxRange(globalRange)) {
+            NSRange effectiveRange;
+            NSDictionary* current = [textStorage attributesAtIndex:i longestEffectiveRange:&effectiveRange inRange:globalRange];
+            
+            if (![current isEqualToDictionary:attrs]) {
+                [ranges addObject:[NSValue valueWithRange:effectiveRange]];
+                [attributes addObject:attrs];
+            }
+            
+            i = NSMaxRange(effectiveRange);
+        }
+    }];
+    
+    if (ranges.count == 0) return 0;
+    
+    [textStorage beginEditing];
+    for (NSInteger i = 0; i < ranges.count; i++) {
+        [textStorage setAttributes:attributes[i] range:ranges[i].rangeValue];
+    }
+    [textStorage endEditing];
+    
+    return ranges.count;
+}
+
+@end
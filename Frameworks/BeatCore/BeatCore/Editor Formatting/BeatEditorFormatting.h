@@ -38,6 +38,8 @@ extern NSString* const BeatRepresentedLineKey;
 
 /// Set this to use a static parser instead of delegate's parser
 @property (nonatomic) ContinuousFountainParser* staticParser;
+/// Set when formatting a detached copy of the text on a background thread. Editor UI and parser state won't be touched.
+@property (nonatomic) bool detached;
 
 - (instancetype)initWithTextStorage:(NSMutableAttributedString*)textStorage;
 
@@ -64,6 +66,13 @@ extern NSString* const BeatRepresentedLineKey;
 - (void)forceFormatChangesInRange:(NSRange)range;
 
 - (void)formatAllAsynchronously;
+/**
+ Formats the whole document without blocking main thread. Attributes are calculated on a background queue into a snapshot of the text, and applied to the editor on main thread in small slices. Lines in the given range are applied first.
+ @param range The range which should be styled first, usually the visible part of the editor
+ @param rangeFormatted Called on main thread once the lines in given range have been applied
+ @param completion Called on main thread after all lines have been applied
+ */
+- (void)formatAllLinesFromRange:(NSRange)range rangeFormatted:(void (^ _Nullable)(void))rangeFormatted completion:(void (^ _Nullable)(void))completion;
 
 /// Returns the font for current line
 - (BXFont*)fontForTyping;
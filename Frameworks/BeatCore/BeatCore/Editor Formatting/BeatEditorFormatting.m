@@ -23,6 +23,7 @@
 #import <BeatCore/BeatMeasure.h>
 
 #import "BeatEditorFormatting.h"
+#import "BeatAttributeBuffer.h"
 
 // Set character width
 #define CHR_WIDTH 7.25
@@ -33,6 +34,24 @@
 @property (nonatomic) NSMutableAttributedString* textStorage;
 @property (nonatomic) BeatFontSet* fonts;
 @property (nonatomic) NSMutableIndexSet* linesToFormat;
+/// Incremented whenever a new background formatting pass begins. Older passes stop when they notice the change.
+@property (atomic) NSInteger formattingGeneration;
+/// Attributes of the line being formatted are collected here before they are written to the editor
+@property (nonatomic) BeatAttributeBuffer* lineBuffer;
+
+/// Incremented whenever the editor text or its attributes change while background formatting is pending. Results calculated before the change are discarded.
+@property (atomic) NSInteger editCount;
+@property (nonatomic) bool applyingFormattedLines;
+@property (nonatomic, weak) NSTextStorage* observedTextStorage;
+
+/// Editor settings captured on main thread for detached formatting, so the worker never has to touch the delegate
+@property (nonatomic) BeatFontSet* detachedFonts;
+@property (nonatomic) BeatStylesheet* detachedStyles;
+@property (nonatomic) BeatPaperSize detachedPageSize;
+@property (nonatomic) CGFloat detachedFontScale;
+@property (nonatomic) bool detachedDisableFormatting;
+/// Character highlight colors as `{ NAME: color }`
+@property (nonatomic) NSDictionary<NSString*, NSString*>* detachedHighlightColors;
 @end
 
 @implementation BeatEditorFormatting
@@ -55,6 +74,7 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
 - (BeatFontSet *)fonts
 {
     if (_delegate != nil) return _delegate.fonts;
+    else if (_detachedFonts != nil) return _detachedFonts;
     else return BeatFontManager.shared.defaultFonts;
 }
 
@@ -62,6 +82,7 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
 
 - (ContinuousFountainParser*)parser
 {
+    if (_detached && _staticParser != nil) return _staticParser;
     if (_delegate != nil) return _delegate.parser;
     else return _staticParser;
 }
@@ -69,20 +90,45 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
 - (BeatStylesheet*)editorStyles
 {
     if (_delegate != nil) return _delegate.editorStyles;
+    if (_detachedStyles != nil) return _detachedStyles;
     return BeatStyles.shared.defaultEditorStyles;
 }
 
 - (BeatPaperSize)pageSize
 {
     if (_delegate != nil) return _delegate.pageSize;
+    if (_detached) return _detachedPageSize;
     return [BeatUserDefaults.sharedDefaults getInteger:BeatSettingDefaultPageSize];
 }
 
-- (BXFont*)regular { return (_delegate != nil) ? self.fonts.regular : BeatFontManager.shared.defaultFonts.regular; }
-- (BXFont*)bold { return (_delegate != nil) ? self.fonts.bold : BeatFontManager.shared.defaultFonts.bold; }
-- (BXFont*)italic { return (_delegate != nil) ? self.fonts.italic : BeatFontManager.shared.defaultFonts.italic; }
-- (BXFont*)boldItalic { return (_delegate != nil) ? self.fonts.boldItalic : BeatFontManager.shared.defaultFonts.boldItalic; }
-- (BXFont*)synopsisFont { return (_delegate != nil) ? self.fonts.synopsis : BeatFontManager.shared.defaultFonts.synopsis; }
+- (CGFloat)fontScale
+{
+    if (_delegate != nil) return _delegate.fontScale;
+    return (_detached) ? _detachedFontScale : 1.0;
+}
+
+- (bool)disableFormatting
+{
+    if (_delegate != nil) return _delegate.disableFormatting;
+    return (_detached) ? _detachedDisableFormatting : false;
+}
+
+- (BXFont*)regular { return self.fonts.regular; }
+- (BXFont*)bold { return self.fonts.bold; }
+- (BXFont*)italic { return self.fonts.italic; }
+- (BXFont*)boldItalic { return self.fonts.boldItalic; }
+- (BXFont*)synopsisFont { return self.fonts.synopsis; }
+
+/// Returns the highlight color stored for given character name
+- (NSString*)highlightColorForCharacter:(NSString*)name
+{
+    if (name.length == 0) return nil;
+    if (_detached) return _detachedHighlightColors[name.uppercaseString];
+    if (_delegate == nil) return nil;
+    
+    BeatCharacterData* cd = [BeatCharacterData.alloc initWithDelegate:self.delegate];
+    return [cd getCharacterWith:name].highlightColor;
+}
 
 
 #pragma mark - Formatting calls
@@ -137,7 +183,7 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
     RenderStyle* elementStyle = [styles forElement:(typeName != nil) ? typeName : @"action"];
     
     // Paragraph sizing
-    CGFloat width = [elementStyle widthWithPageSize:_delegate.pageSize];
+    CGFloat width = [elementStyle widthWithPageSize:paperSize];
     if (width == 0.0) width = [styles.page defaultWidthWithPageSize:paperSize];
     
     CGFloat leftMargin = elementStyle.marginLeft;
@@ -145,8 +191,8 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
     
 #if TARGET_OS_IOS
     if (is_Mobile) {
-        leftMargin *= self.delegate.fontScale;
-        rightMargin *= self.delegate.fontScale;
+        leftMargin *= self.fontScale;
+        rightMargin *= self.fontScale;
     }
 #endif
     
@@ -159,7 +205,7 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
     // In some cases we'll have to create different keys for lines that are of the same type but meet other conditions
     else if (elementStyle.unindentFreshParagraphs) {
         // Check the previous line
-        prevLine = [self.delegate.parser previousLine:line];
+        prevLine = [self.parser previousLine:line];
         if (prevLine.type != line.type) {
             type = type + 100;
         }
@@ -196,13 +242,13 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
         lineHeight = font.pointSize;
     }
     // Scale if needed
-    lineHeight *= self.delegate.fonts.scale;
+    lineHeight *= self.fonts.scale;
     
     style.minimumLineHeight = lineHeight;
     style.maximumLineHeight = lineHeight;
     
     style.lineHeightMultiple = (elementStyle.lineHeightMultiplier > 0) ? elementStyle.lineHeightMultiplier : styles.page.lineHeightMultiplier;
-    style.lineHeightMultiple *= self.delegate.fonts.scale; // We need to multiply *multiplier* on mobile mode... sigh.
+    style.lineHeightMultiple *= self.fonts.scale; // We need to multiply *multiplier* on mobile mode... sigh.
     style.alignment = elementStyle.textAlignment;
 
 	// Indents are used as left/right margins, and indents in stylesheet are appended to that
@@ -286,6 +332,182 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
     }
 }
 
+/// Formats all lines on a background queue and applies the results in slices, starting from given range
+- (void)formatAllLinesFromRange:(NSRange)range rangeFormatted:(void (^ _Nullable)(void))rangeFormatted completion:(void (^ _Nullable)(void))completion
+{
+    NSMutableAttributedString* textStorage = self.textStorage;
+    NSArray<Line*>* lines = self.parser.safeLines.copy;
+    
+    if (lines.count == 0 || textStorage == nil) {
+        if (rangeFormatted) rangeFormatted();
+        if (completion) completion();
+        return;
+    }
+    
+    NSInteger generation = self.formattingGeneration + 1;
+    self.formattingGeneration = generation;
+    self.paragraphStyles = NSMutableDictionary.new;
+    
+    // Lines in the requested range come first, then everything after it, and finally everything before it
+    NSInteger first = [self.parser lineIndexAtPosition:range.location];
+    NSInteger last = [self.parser lineIndexAtPosition:NSMaxRange(range)];
+    if (first == NSNotFound || first >= lines.count) first = 0;
+    if (last == NSNotFound || last >= lines.count) last = lines.count - 1;
+    if (last < first) last = first;
+    
+    NSMutableArray<NSValue*>* slices = NSMutableArray.new;
+    [slices addObject:[NSValue valueWithRange:NSMakeRange(first, last - first + 1)]];
+    
+    NSInteger sliceSize = 250;
+    for (NSInteger i = last + 1; i < lines.count; i += sliceSize) {
+        [slices addObject:[NSValue valueWithRange:NSMakeRange(i, MIN(sliceSize, lines.count - i))]];
+    }
+    for (NSInteger i = 0; i < first; i += sliceSize) {
+        [slices addObject:[NSValue valueWithRange:NSMakeRange(i, MIN(sliceSize, first - i))]];
+    }
+    
+    // Format a snapshot of the text. Revision attributes are carried over, so revision colors are calculated correctly.
+    NSMutableAttributedString* snapshot = textStorage.mutableCopy;
+    NSUInteger length = snapshot.length;
+    
+    // Lines are cloned into a snapshot parser, so that the live objects are only touched on main thread
+    NSMutableArray<Line*>* clones = [NSMutableArray arrayWithCapacity:lines.count];
+    for (Line* line in lines) [clones addObject:line.clone];
+    
+    ContinuousFountainParser* snapshotParser = ContinuousFountainParser.new;
+    snapshotParser.lines = clones;
+    
+    // The worker doesn't get a delegate. Everything it needs from the editor is captured here on main thread.
+    BeatEditorFormatting* worker = [BeatEditorFormatting.alloc initWithTextStorage:snapshot];
+    worker.staticParser = snapshotParser;
+    worker.detached = true;
+    worker.detachedFonts = self.fonts;
+    worker.detachedStyles = self.editorStyles;
+    worker.detachedPageSize = self.pageSize;
+    worker.detachedFontScale = self.fontScale;
+    worker.detachedDisableFormatting = self.disableFormatting;
+    worker.detachedHighlightColors = [self characterHighlightColors];
+    
+    // Any change to the text or its attributes (revisions, reviews etc.) will invalidate the results
+    [self observeEditsIn:textStorage];
+    NSInteger editCount = self.editCount;
+    
+    // Don't let the worker get too far ahead of main thread
+    dispatch_semaphore_t pending = dispatch_semaphore_create(2);
+    
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        for (NSInteger s = 0; s < slices.count; s++) {
+            if (self.formattingGeneration != generation) return;
+            NSRange slice = slices[s].rangeValue;
+            
+            NSMutableArray<Line*>* formatted = [NSMutableArray arrayWithCapacity:slice.length];
+            NSMutableArray<NSAttributedString*>* fragments = [NSMutableArray arrayWithCapacity:slice.length];
+            
+            for (NSInteger i = slice.location; i < NSMaxRange(slice); i++) { @autoreleasepool {
+                Line* line = clones[i];
+                [worker formatLine:line firstTime:true];
+                
+                NSRange lineRange = line.range;
+                if (NSMaxRange(lineRange) > length) lineRange.length = length - lineRange.location;
+                
+                [formatted addObject:line];
+                [fragments addObject:[snapshot attributedSubstringFromRange:lineRange]];
+            } }
+            
+            dispatch_semaphore_wait(pending, DISPATCH_TIME_FOREVER);
+            
+            dispatch_async(dispatch_get_main_queue(), ^{
+                dispatch_semaphore_signal(pending);
+                
+                if (self.formattingGeneration != generation) return;
+                
+                // The text was edited while formatting. Results are no longer valid, so we'll format the rest in place.
+                if (self.editCount != editCount || self.textStorage.length != length) {
+                    self.formattingGeneration += 1;
+                    [self formatAllAsynchronously];
+                    if (s == 0 && rangeFormatted) rangeFormatted();
+                    if (completion) completion();
+                    return;
+                }
+                
+                [self applyFormattedLines:formatted fragments:fragments liveLines:lines range:slice];
+                
+                if (s == 0 && rangeFormatted) rangeFormatted();
+                if (s == slices.count - 1) {
+                    [self.parser.changedIndices removeAllIndexes];
+                    [self.delegate ensureLayout];
+                    if (completion) completion();
+                }
+            });
+        }
+    });
+}
+
+/// Returns character highlight colors as `{ NAME: color }`. Has to be called on main thread.
+- (NSDictionary<NSString*, NSString*>*)characterHighlightColors
+{
+    if (_delegate == nil) return @{};
+    
+    NSMutableDictionary<NSString*, NSString*>* colors = NSMutableDictionary.new;
+    NSDictionary<NSString*, BeatCharacter*>* characters = [BeatCharacterData.alloc initWithDelegate:self.delegate].characters;
+    
+    for (NSString* name in characters) {
+        NSString* color = characters[name].highlightColor;
+        if (color.length > 0) colors[name.uppercaseString] = color;
+    }
+    
+    return colors;
+}
+
+/// Starts counting edits made to given text storage. Both character and attribute changes are counted, except for the ones made when applying background formatting results.
+- (void)observeEditsIn:(NSMutableAttributedString*)textStorage
+{
+    if (![textStorage isKindOfClass:NSTextStorage.class] || textStorage == self.observedTextStorage) return;
+    
+    if (self.observedTextStorage != nil) [NSNotificationCenter.defaultCenter removeObserver:self name:NSTextStorageDidProcessEditingNotification object:self.observedTextStorage];
+    [NSNotificationCenter.defaultCenter addObserver:self selector:@selector(textStorageDidProcessEditing:) name:NSTextStorageDidProcessEditingNotification object:textStorage];
+    
+    self.observedTextStorage = (NSTextStorage*)textStorage;
+}
+
+- (void)textStorageDidProcessEditing:(NSNotification*)notification
+{
+    if (!self.applyingFormattedLines) self.editCount += 1;
+}
+
+/// Applies attributes calculated on a background thread to the actual text
+- (void)applyFormattedLines:(NSArray<Line*>*)formatted fragments:(NSArray<NSAttributedString*>*)fragments liveLines:(NSArray<Line*>*)lines range:(NSRange)slice
+{
+    NSMutableAttributedString* textStorage = self.textStorage;
+    
+    bool alreadyEditing = _delegate.textStorage.isEditing;
+    self.applyingFormattedLines = true;
+    if (!alreadyEditing) [textStorage beginEditing];
+    
+    for (NSInteger i = 0; i < formatted.count; i++) {
+        Line* line = lines[slice.location + i];
+        Line* formattedLine = formatted[i];
+        NSAttributedString* fragment = fragments[i];
+        
+        NSUInteger location = formattedLine.position;
+        BeatWeakLine* representedLine = [BeatWeakLine withLine:line];
+        
+        [fragment enumerateAttributesInRange:NSMakeRange(0, fragment.length) options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
+            NSMutableDictionary* attributes = attrs.mutableCopy;
+            // Represented line points to the clone, so replace it with the actual line
+            if (attributes[BeatRepresentedLineKey] != nil) attributes[BeatRepresentedLineKey] = representedLine;
+            
+            [textStorage setAttributes:attributes range:NSMakeRange(location + range.location, range.length)];
+        }];
+        
+        line.formattedAs = formattedLine.formattedAs;
+        line.formattedString = formattedLine.formattedString;
+    }
+    
+    if (!alreadyEditing) [textStorage endEditing];
+    self.applyingFormattedLines = false;
+}
+
 /// Reapplies all paragraph styles
 - (void)resetSizing
 {
@@ -356,8 +578,32 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
 }
 
 /// Formats one line of screenplay.
-/// - note To support ahead-of-time rendering, we are using `NSMutableAttributedString` in place of  `NSTextStorage`, even when referring to the actual text storage (which is basically just a mutable attributed string subclass)
+/// When editing, the attributes are first calculated into a buffer and then diffed against the current ones, so only runs that actually changed are written to text storage. Retyping text in a long paragraph won't cause relayout when nothing visible changes.
 - (void)formatLine:(Line*)line firstTime:(bool)firstTime
+{
+    NSMutableAttributedString* textStorage = self.textStorage;
+    
+    // The last line doesn't have a line break
+    NSRange range = line.range;
+    if (NSMaxRange(range) > textStorage.length && range.location <= textStorage.length) range.length = textStorage.length - range.location;
+    
+    if (firstTime || _detached || _textStorage != nil || _lineBuffer != nil || textStorage == nil ||
+        line == nil || NSMaxRange(range) > textStorage.length || range.length == 0) {
+        [self formatLineAttributes:line firstTime:firstTime];
+        return;
+    }
+    
+    _lineBuffer = [BeatAttributeBuffer.alloc initWithTextStorage:textStorage range:range];
+    [self formatLineAttributes:line firstTime:firstTime];
+    
+    BeatAttributeBuffer* buffer = _lineBuffer;
+    _lineBuffer = nil;
+    [buffer commit];
+}
+
+/// Calculates and sets the attributes for given line.
+/// - note To support ahead-of-time rendering, we are using `NSMutableAttributedString` in place of  `NSTextStorage`, even when referring to the actual text storage (which is basically just a mutable attributed string subclass)
+- (void)formatLineAttributes:(Line*)line firstTime:(bool)firstTime
 { @autoreleasepool {
 	// SAFETY MEASURES:
     // Don't do anything if the line is null or we don't have a text storage, and don't go out of range when attached to an editor
@@ -373,10 +619,10 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
     NSMutableAttributedString *textStorage = self.textStorage;
     
     // Get editing status from delegate
-    bool alreadyEditing = _delegate.textStorage.isEditing;
+    bool alreadyEditing = (_detached) ? false : _delegate.textStorage.isEditing;
     if (!alreadyEditing) [textStorage beginEditing];
 	
-    NSRange selectedRange = _delegate.selectedRange;
+    NSRange selectedRange = (_detached) ? NSMakeRange(NSNotFound, 0) : _delegate.selectedRange;
 	NSRange range = line.textRange; // range without line break
 	NSRange fullRange = line.range; // range WITH line break
 	if (NSMaxRange(fullRange) > textStorage.length) fullRange.length -= 1;
@@ -416,7 +662,7 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
 	}
     
     // Do nothing else if formatting is disabled
-    if (self.delegate.disableFormatting) {
+    if (self.disableFormatting) {
         newAttributes[NSParagraphStyleAttributeName] = NSParagraphStyle.new;
         newAttributes[NSFontAttributeName] = self.fonts.regular;
         //newAttributes[NSBackgroundColorAttributeName] = BXColor.clearColor;
@@ -446,8 +692,10 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
 		if (!alreadyEditing) [textStorage endEditing];
 
         // Typing attributes are also used to draw system inline predictions, so they should always contain the correct font
-        if (attributes[NSFontAttributeName] == nil) attributes[NSFontAttributeName] = [self fontFamilyForLine:line];
-        [_delegate.getTextView setTypingAttributes:attributes];
+        if (!_detached) {
+            if (attributes[NSFontAttributeName] == nil) attributes[NSFontAttributeName] = [self fontFamilyForLine:line];
+            [_delegate.getTextView setTypingAttributes:attributes];
+        }
         
         self.lineBeingFormatted = nil;
         _formatting = false;
@@ -505,7 +753,7 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
 	// If we are editing a dialogue block at the end of the document, the line will be empty.
 	// If the line is empty, we need to set typing attributes too, to display correct positioning if this is a dialogue block.
     bool shouldSetTypingAttributes = false;
-	if (!firstTime && line.string.length == 0 && NSLocationInRange(self.delegate.selectedRange.location, line.range)) {
+	if (!firstTime && !_detached && line.string.length == 0 && NSLocationInRange(selectedRange.location, line.range)) {
 		Line* previousLine;
 		
         NSInteger lineIndex = [self.parser indexOfLine:line];
@@ -555,7 +803,7 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
 - (void)applyInlineFormatting:(Line*)line reset:(bool)reset textStorage:(NSMutableAttributedString*)textStorage
 {
     [BeatMeasure queue:@"format" startPhase:@"inline formatting"];
-    RenderStyle* style = [self.delegate.editorStyles forLine:line];
+    RenderStyle* style = [self.editorStyles forLine:line];
     
     /// We are optimizing the render time by double-checking if the calculated attributed string matches the stored one. This only includes inline formatting.
     /// Touching text storage and aqcuiring an attributed string is VERY expensive, and wouldn't do what we want, as it includes stuff like color etc.
@@ -628,7 +876,7 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
 {
 #if TARGET_OS_IOS
     // NSLayoutManager doesn't have traits on iOS. We need to do some trickery – and navigate around full width punctuation. I hate this.
-    NSInteger maxLength = self.delegate.text.length;
+    NSInteger maxLength = textStorage.length;
     if (NSMaxRange(range) <= maxLength && range.location != maxLength) {
         NSRange fontRange = range;
         unichar firstChar = [textStorage.string characterAtIndex:range.location];
@@ -649,8 +897,26 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
         [textStorage addAttribute:NSFontAttributeName value:newFont range:fontRange];
     }
 #else
-    // NSLayoutManager DOES have traits on macOS
-	[textStorage applyFontTraits:trait range:range];
+    if (_detached) {
+        // NSFontManager isn't thread-safe, so detached formatting converts the fonts using descriptors
+        if (trait == 0) return;
+        
+        NSMutableArray<NSValue*>* ranges = NSMutableArray.new;
+        NSMutableArray<BXFont*>* fonts = NSMutableArray.new;
+        [textStorage enumerateAttribute:NSFontAttributeName inRange:range options:0 usingBlock:^(id  _Nullable value, NSRange range, BOOL * _Nonnull stop) {
+            if (value == nil) return;
+            [ranges addObject:[NSValue valueWithRange:range]];
+            [fonts addObject:value];
+        }];
+        
+        for (NSInteger i = 0; i < ranges.count; i++) {
+            BXFont* font = [BeatFontSet fontWithTrait:fonts[i].fontDescriptor.symbolicTraits | (BXFontDescriptorSymbolicTraits)trait font:fonts[i]];
+            [textStorage addAttribute:NSFontAttributeName value:font range:ranges[i].rangeValue];
+        }
+    } else {
+        // NSLayoutManager DOES have traits on macOS
+        [textStorage applyFontTraits:trait range:range];
+    }
 #endif
 }
 
@@ -664,7 +930,7 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
     
     BXFont* font = [self fontFamilyForLine:currentLine];
         
-    RenderStyle* style = [self.delegate.editorStyles forLine:currentLine];
+    RenderStyle* style = [self.editorStyles forLine:currentLine];
 
     if (style != nil) {
         if (style.bold) font = font.bolded;
@@ -679,10 +945,10 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
     BXFont* font = self.regular;
     if (line == nil) return font;
     
-    RenderStyle* style = [self.delegate.editorStyles forLine:line];
+    RenderStyle* style = [self.editorStyles forLine:line];
     NSString* fontName = style.font;
         
-    CGFloat scale = self.delegate.fontScale;
+    CGFloat scale = self.fontScale;
     if (scale <= 0.0) scale = 1.0;
     CGFloat fontSize = scale * ((style.fontSize > 0) ? style.fontSize : 12.0);
     
@@ -692,7 +958,7 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
         if ([fontName isEqualToString:@"system"]) {
             font = [BXFont systemFontOfSize:fontSize];
         } else if ([fontName isEqualToString:@"default"]) {
-            font = self.delegate.fonts.regular;
+            font = self.fonts.regular;
         } else if ([fontName isEqualToString:@"courier"]) {
             font = [BeatFontManager.shared fontsWith:BeatFontTypeFixed scale:scale].regular;
             font = [BXFont fontWithName:font.fontName size:fontSize];
@@ -700,7 +966,7 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
             font = [BXFont fontWithName:fontName size:fontSize];
         }
         
-        if (font == nil) font = [BXFont fontWithName:self.delegate.fonts.regular.fontName size:fontSize];
+        if (font == nil) font = [BXFont fontWithName:self.fonts.regular.fontName size:fontSize];
     } else if (font != nil) {
         font = [BXFont fontWithName:font.fontName size:fontSize];
     }
@@ -820,24 +1086,25 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
 	else if (line.type == pageBreak) {
         [self setForegroundColor:themeManager.invisibleTextColor line:line range:NSMakeRange(0, line.length) textStorage:textStorage];
 	}
-    else if (line.isAnySortOfDialogue && self.delegate != nil) {
-        BeatCharacterData* cd = [BeatCharacterData.alloc initWithDelegate:self.delegate];
-        NSArray<Line*>* block = [self.delegate.parser blockFor:line];
+    else if (line.isAnySortOfDialogue && (self.delegate != nil || _detached)) {
+        NSArray<Line*>* block = [self.parser blockFor:line];
         
         Line* cue = block.firstObject;
-        NSString* chrName = cue.characterName;
-        BeatCharacter* c = [cd getCharacterWith:chrName];
+        NSString* highlightColor = [self highlightColorForCharacter:cue.characterName];
         
-        if (c.highlightColor.length > 0) {
-            BXColor* color = [BeatColors color:c.highlightColor];
+        if (highlightColor.length > 0) {
+            BXColor* color = [BeatColors color:highlightColor];
             if (color != nil) {
                 [self setForegroundColor:color line:line range:NSMakeRange(0, line.length) textStorage:textStorage];
                 
-                // Make sure the whole block gets the correct color
-                NSInteger idx = [self.delegate.parser indexOfLine:line];
-                if (idx+1 < self.delegate.parser.lines.count) {
-                    Line* nextLine = self.delegate.parser.lines[idx+1];
-                    if (nextLine.isAnySortOfDialogue && nextLine.length > 0) [self.delegate.parser.changedIndices addIndex:idx+1];
+                // Make sure the whole block gets the correct color (detached formatting goes through all lines anyway)
+                if (!_detached) {
+                    ContinuousFountainParser* parser = self.delegate.parser;
+                    NSInteger idx = [parser indexOfLine:line];
+                    if (idx != NSNotFound && idx+1 < parser.lines.count) {
+                        Line* nextLine = parser.lines[idx+1];
+                        if (nextLine.isAnySortOfDialogue && nextLine.length > 0) [parser.changedIndices addIndex:idx+1];
+                    }
                 }
             }
         }
@@ -953,6 +1220,7 @@ NSString* const BeatRepresentedLineKey = @"representedLine";
 #pragma mark - Get text storage
 
 -(NSMutableAttributedString *)textStorage {
+	if (_lineBuffer) return _lineBuffer;
 	if (_textStorage) return _textStorage;
 	else return _delegate.textStorage;
 }
@@ -11,6 +11,9 @@
 #import <BeatCore/BeatAutocomplete.h>
 
 @interface BeatAutocomplete ()
+/// Suggestions provided by plugins
+@property (nonatomic) NSArray<NSString*>* pluginCharacterNames;
+@property (nonatomic) NSArray<NSString*>* pluginSceneHeadings;
 @end
 
 @implementation BeatAutocomplete 
@@ -35,53 +38,46 @@
 	[_characterNames removeAllObjects];
     if (_characterNames == nil) _characterNames = NSMutableArray.new;
     
-    NSMutableArray *characterList = NSMutableArray.new;
-    NSMutableDictionary <NSString*, NSNumber*>* charactersAndLines = NSMutableDictionary.new;
-    
 	Line* currentLine = self.delegate.currentLine;
 	
+	// Collect character name suggestions from running plugins
+    NSMutableArray<NSString*>* pluginNames = NSMutableArray.new;
+#if !TARGET_OS_IOS
+	for (NSString* pluginName in _delegate.runningPlugins.allKeys) {
+		id<BeatAutocompletionProvider> plugin = (id<BeatAutocompletionProvider>)_delegate.runningPlugins[pluginName];
+		[pluginNames addObjectsFromArray:[plugin completionsForCharacters]];
+	}
+#endif
+    _pluginCharacterNames = pluginNames;
+    [_characterNames addObjectsFromArray:pluginNames];
+	
+	// Create an ordered list with all the character names.
+	// The one with the most lines will be the first suggestion.
+    BeatCompletionIndex* index = self.delegate.parser.characterIndex;
+    if (index != nil) {
+        [_characterNames addObjectsFromArray:[index keysByFrequencyExcludingLine:currentLine]];
+        return;
+    }
+    
+    // Parser has no index, so we'll need to count the cues ourselves
+    NSMutableDictionary <NSString*, NSNumber*>* charactersAndLines = NSMutableDictionary.new;
+    
 	for (Line *line in self.delegate.parser.lines) {
-		if ((line.isAnyCharacter) && line != currentLine
-			) {
+		if ((line.isAnyCharacter) && line != currentLine) {
 			// Character name, EXCLUDING any suffixes, such as (CONT'D), (V.O.') etc.
 			NSString *character = line.characterName;
 			// For some reason there are random misinterpretations of character cues, so skip empty lines
 			if (character.length == 0) continue;
 			
 			// Add the character + suffix into dict and calculate number of appearances
-			if (charactersAndLines[character] != nil) {
-				NSInteger lines = charactersAndLines[character].integerValue + 1;
-				charactersAndLines[character] = [NSNumber numberWithInteger:lines];
-			} else {
-				charactersAndLines[character] = [NSNumber numberWithInteger:1];
-			}
-			
-			// Add character to list
-			if (character && ![characterList containsObject:character]) {
-				[characterList addObject:character.copy]; // We're copying the string because I'm hunting memory leaks. Shouldn't be an issue here though.
-			}
+			charactersAndLines[character] = @(charactersAndLines[character].integerValue + 1);
 		}
 	}
 	
-	// Collect character name suggestions from running plugins
-#if !TARGET_OS_IOS
-	for (NSString* pluginName in _delegate.runningPlugins.allKeys) {
-		id<BeatAutocompletionProvider> plugin = (id<BeatAutocompletionProvider>)_delegate.runningPlugins[pluginName];
-		[_characterNames addObjectsFromArray:[plugin completionsForCharacters]];
-	}
-#endif
-	
-	// Create an ordered list with all the character names.
-	// The one with the most lines will be the first suggestion.
-	// Btw, I don't think this works :-)
-	NSArray *characters = [charactersAndLines keysSortedByValueUsingComparator:^NSComparisonResult(id obj1, id obj2){
-		// These keys are always integers
-		NSInteger val1 = ((NSString*)obj1).integerValue;
-		NSInteger val2 = ((NSString*)obj2).integerValue;
-		return val2 > val1;
+	NSArray *characters = [charactersAndLines keysSortedByValueUsingComparator:^NSComparisonResult(NSNumber* obj1, NSNumber* obj2){
+		return [obj2 compare:obj1];
 	}];
 	[_characterNames addObjectsFromArray:characters];
-
 }
 
 - (void)collectHeadings
@@ -90,22 +86,26 @@
     [_sceneHeadings removeAllObjects];
     
 	Line *currentLine = self.delegate.currentLine;
+	BeatCompletionIndex* index = self.delegate.parser.headingIndex;
+    
+    if (index != nil) {
+        [_sceneHeadings addObjectsFromArray:[index sortedKeysExcludingLine:currentLine]];
+    } else {
+        NSMutableSet<NSString*>* headings = NSMutableSet.new;
+        for (Line *line in self.delegate.parser.lines) {
+            if (line.type == heading && line != currentLine) [headings addObject:line.stripFormatting];
+        }
+        [_sceneHeadings addObjectsFromArray:headings.allObjects];
+    }
 	
-	for (Line *line in self.delegate.parser.lines) {
-		NSString *sceneHeading = line.stripFormatting;
-		
-		if (line.type == heading &&
-			line != currentLine &&
-			![_sceneHeadings containsObject:sceneHeading]) {
-			[_sceneHeadings addObject:sceneHeading];
-		}
-	}
-	
+    NSMutableArray<NSString*>* pluginHeadings = NSMutableArray.new;
 	for (NSString* pluginName in _delegate.runningPlugins.allKeys) {
         // Force cast required for conformance here.
 		id<BeatAutocompletionProvider> plugin = (id<BeatAutocompletionProvider>)_delegate.runningPlugins[pluginName];
-		[_sceneHeadings addObjectsFromArray:[plugin completionsForSceneHeadings]];
+		[pluginHeadings addObjectsFromArray:[plugin completionsForSceneHeadings]];
 	}
+    _pluginSceneHeadings = pluginHeadings;
+    [_sceneHeadings addObjectsFromArray:pluginHeadings];
 
     [_sceneHeadings sortUsingSelector:@selector(compare:)];
 }
@@ -151,15 +151,15 @@
     Line *currentLine = self.delegate.currentLine;
     if (currentLine.string == nil || NSMaxRange(charRange) > _delegate.text.length) return @[];
     
-    NSMutableArray *matches = NSMutableArray.new;
-    NSMutableArray *allSuggestions = NSMutableArray.new;
+    NSMutableOrderedSet *matches = NSMutableOrderedSet.new;
+    NSArray *allSuggestions = @[];
     
     NSString* stringToSearch = [_delegate.text substringWithRange:charRange].uppercaseString;
     NSString* prefix = @"";
     
     // Scene headings will ignore the prefix
     if (currentLine.type == heading) {
-        prefix = sceneHeadingPrefix(stringToSearch);
+        prefix = [ContinuousFountainParser sceneHeadingPrefix:stringToSearch];
         stringToSearch = [stringToSearch stringByReplacingOccurrencesOfString:prefix withString:@""].trim;
         
         // Add the dot for non-forced scene heading prefixes (INT will become INT.)
@@ -169,18 +169,24 @@
         }
     }
     
-    // Choose which array to search
-    if (currentLine.type == character) allSuggestions = _characterNames;
+    // Choose which array to search. When the parser has an index, we only need to go through plugin suggestions and the matches found in index.
+    BeatCompletionIndex* index = nil;
+    if (currentLine.type == character) index = self.delegate.parser.characterIndex;
+    else if (currentLine.type == heading) index = self.delegate.parser.headingIndex;
+    
+    if (index != nil) {
+        NSArray* pluginSuggestions = (currentLine.type == character) ? _pluginCharacterNames : _pluginSceneHeadings;
+        if (pluginSuggestions != nil) allSuggestions = pluginSuggestions;
+    }
+    else if (currentLine.type == character) allSuggestions = _characterNames;
     else if (currentLine.type == heading) allSuggestions = _sceneHeadings;
     
     // Find matching lines for the partially typed line
     for (NSString *string in allSuggestions) {
         NSString* suggestion = string.uppercaseString;
         
-        if (currentLine.type == heading) {
-            NSString* suggestionPrefix = sceneHeadingPrefix(suggestion);
-            suggestion = [suggestion stringByReplacingOccurrencesOfString:suggestionPrefix withString:@""].trim;
-        }
+        if (currentLine.type == heading) suggestion = [ContinuousFountainParser searchKeyForHeading:suggestion];
+        if (suggestion.length == 0) continue;
         
         bool found = false;
         if (stringToSearch.length == 0) {
@@ -191,7 +197,12 @@
         }
         
         NSString* fullSuggestion = [NSString stringWithFormat:@"%@%@", prefix, suggestion];
-        if (found && ![matches containsObject:fullSuggestion] && fullSuggestion.length > 0) [matches addObject:fullSuggestion];
+        if (found && fullSuggestion.length > 0) [matches addObject:fullSuggestion];
+    }
+    
+    // Indexed suggestions are already filtered, uppercase and without scene heading prefixes
+    for (NSString* suggestion in [index completionsForPrefix:stringToSearch excludingLine:currentLine]) {
+        [matches addObject:[NSString stringWithFormat:@"%@%@", prefix, suggestion]];
     }
     
     // If no matches were found and the line is a character cue, provide a list of extensions
@@ -213,7 +224,7 @@
         }
     }
     
-    return matches;
+    return matches.array;
 }
 
 - (NSArray<NSString*>*)characterExtensions
@@ -227,18 +238,4 @@
 }
 
 
-NSString *sceneHeadingPrefix(NSString *originalString)
-{
-    // Forced scene heading
-    if (originalString.length > 0 && [originalString characterAtIndex:0] == '.') {
-        return [originalString substringToIndex:1];
-    }
-    
-    if ([originalString containsString:@" "]) {
-        return [originalString substringToIndex:[originalString rangeOfString:@" "].location];
-    } else {
-        return originalString;
-    }
-}
-
 @end
@@ -152,7 +152,8 @@ import Foundation
                 let character = characters[realName]
                 character?.lines += 1
                 
-                if let currentScene, let character, !character.scenes.contains(currentScene) {
+                // Lines are in order, so a scene can only be the latest one added
+                if let currentScene, let character, character.scenes.last !== currentScene {
                     character.scenes.append(currentScene)
                 }
             }
@@ -146,6 +146,8 @@
 			if (textRange.length <= 0) continue;
 		}
 		
+		NSUInteger removalSuggestions = line.removalSuggestionRanges.count;
+		
 		@try { @autoreleasepool {
 			[string enumerateAttribute:BeatRevisions.attributeKey inRange:textRange options:0 usingBlock:^(id  _Nullable value, NSRange range, BOOL * _Nonnull stop) {
 				// Don't go out of range
@@ -183,6 +185,9 @@
 		@catch (NSException *e) {
 			NSLog(@"Bake attributes: Line out of range  (%lu/%lu) -  %@", textRange.location, textRange.length, line);
 		}
+		
+		// Removal suggestions were added in place
+		if (line.removalSuggestionRanges.count != removalSuggestions) [line invalidateContent];
 	}
 }
 
@@ -804,9 +809,15 @@
 
 - (void)addRevisions:(NSIndexSet*)indices generation:(NSInteger)generation
 {
+    // Everything is applied in a single editing transaction using the same revision item
+    NSUInteger length = self.delegate.text.length;
+    BeatRevisionItem* revision = [BeatRevisionItem type:RevisionAddition generation:generation];
+    if (revision == nil) return;
+    
     [self.delegate.textStorage beginEditing];
     [indices enumerateRangesUsingBlock:^(NSRange range, BOOL * _Nonnull stop) {
-        [self addRevision:range generation:generation];
+        if (NSMaxRange(range) > length) { *stop = true; return; }
+        [self.delegate addAttribute:REVISION_ATTR value:revision range:range];
     }];
     [self.delegate.textStorage endEditing];
 }
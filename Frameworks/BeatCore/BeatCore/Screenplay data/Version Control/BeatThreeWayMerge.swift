@@ -0,0 +1,518 @@
+//
+//  BeatThreeWayMerge.swift
+//  BeatCore
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+/**
+
+ Three-way merge for parallel drafts of the same screenplay.
+
+ Each document is split into __segments__ at outline elements (headings and sections). Segments are matched using the heading UUIDs stored in document settings. If any of the documents has no stored UUIDs (committed base texts never do), all documents are matched using the heading text and its occurrence count.
+
+ - Segments changed on only one side are merged automatically. This includes added, removed and moved scenes.
+ - When headings are matched by text, a segment which is missing on one side and replaced by a new segment in the same position is treated as renamed, so its content is merged instead of duplicated.
+ - If both sides changed the same segment, it is split into paragraph blocks (dialogue blocks, action paragraphs etc.) and merged using diff3.
+ - Edits which overlap are wrapped in Fountain notes, so the conflicts are visible in the editor and don't end up in print.
+
+ The base can be provided manually, or looked up from the version control history shared by both documents.
+
+ */
+
+import Foundation
+import BeatParsing
+
+@objc public class BeatMergeResult: NSObject {
+    /// Merged screenplay content without settings block
+    @objc public let text: String
+    /// Merged document with the settings block from `ours`
+    @objc public let document: String
+    /// Number of conflicts marked in the text
+    @objc public let conflicts: Int
+    /// Number of segments which were changed on both sides and merged without conflicts
+    @objc public let autoMerged: Int
+
+    init(text: String, document: String, conflicts: Int, autoMerged: Int) {
+        self.text = text
+        self.document = document
+        self.conflicts = conflicts
+        self.autoMerged = autoMerged
+    }
+}
+
+@objc public class BeatThreeWayMerge: NSObject {
+    /// Labels used in conflict notes
+    @objc public var oursLabel = "ours"
+    @objc public var theirsLabel = "theirs"
+
+    private let baseString: String
+    private let oursString: String
+    private let theirsString: String
+
+    /// Settings keys which contain ranges in the text and are invalid after merging
+    private static let rangeBasedSettings = [DocSettingRevisions, DocSettingTags, DocSettingReviews, DocSettingCaretPosition, DocSettingChangedIndices, DocSettingTextLengthAtSave]
+
+    /// All strings are raw document strings, settings block included
+    @objc public init(base: String, ours: String, theirs: String) {
+        self.baseString = base
+        self.oursString = ours
+        self.theirsString = theirs
+    }
+
+    /// Creates a merge using the latest commit which exists in version control history of both documents as the base. Returns `nil` if there is no common ancestor.
+    @objc public class func withCommonAncestor(ours: String, theirs: String) -> BeatThreeWayMerge? {
+        guard let base = commonAncestor(ours: ours, theirs: theirs) else { return nil }
+        return BeatThreeWayMerge(base: base, ours: ours, theirs: theirs)
+    }
+
+    /// Returns the text of the latest commit shared by both documents
+    @objc public class func commonAncestor(ours: String, theirs: String) -> String? {
+        let oursSettings = BeatDocumentSettings()
+        let theirsSettings = BeatDocumentSettings()
+        _ = oursSettings.readAndReturnRange(ours)
+        _ = theirsSettings.readAndReturnRange(theirs)
+
+        guard let oursVC = oursSettings.get(BeatVersionControl.settingKey()) as? [AnyHashable: Any],
+              let theirsVC = theirsSettings.get(BeatVersionControl.settingKey()) as? [AnyHashable: Any]
+        else { return nil }
+
+        let theirsTimestamps = Set(BeatVersionControl.commits(inVersionControl: theirsVC).compactMap { $0["timestamp"] as? String })
+        let shared = BeatVersionControl.commits(inVersionControl: oursVC).compactMap { $0["timestamp"] as? String }.last { theirsTimestamps.contains($0) }
+
+        if let shared, let text = BeatVersionControl.committedText(at: shared, versionControl: oursVC) {
+            return BeatVersionControl.textWithoutEncodedSettings(text)
+        }
+
+        // No shared commits, but the history might still start from the same text
+        if let oursBase = BeatVersionControl.committedText(at: "base", versionControl: oursVC),
+           let theirsBase = BeatVersionControl.committedText(at: "base", versionControl: theirsVC),
+           oursBase == theirsBase {
+            return BeatVersionControl.textWithoutEncodedSettings(oursBase)
+        }
+
+        return nil
+    }
+
+
+    // MARK: - Merging
+
+    @objc public func merge() -> BeatMergeResult {
+        // Parse all documents concurrently
+        let strings = [baseString, oursString, theirsString]
+        var documents = [MergeDocument?](repeating: nil, count: 3)
+        let lock = NSLock()
+
+        DispatchQueue.concurrentPerform(iterations: 3) { i in
+            let document = MergeDocument(string: strings[i])
+            lock.lock()
+            documents[i] = document
+            lock.unlock()
+        }
+
+        let base = documents[0]!, ours = documents[1]!, theirs = documents[2]!
+
+        // Committed base texts don't have a settings block, so UUIDs can only be used when every document has them
+        let useUUIDs = base.hasUUIDs && ours.hasUUIDs && theirs.hasUUIDs
+        for document in [base, ours, theirs] { document.index(useUUIDs: useUUIDs) }
+        if !useUUIDs { for document in [ours, theirs] { matchRenamedSegments(base: base, document: document) } }
+
+        var conflicts = 0
+        var autoMerged = 0
+        var pieces: [String] = []
+        var headingUUIDs: [[String: String]] = []
+
+        for key in mergedOrder(base: base, ours: ours, theirs: theirs) {
+            let b = base.segments[key], o = ours.segments[key], t = theirs.segments[key]
+            let resolved = resolve(base: b, ours: o, theirs: t)
+
+            if resolved.text.isEmpty { continue }
+
+            pieces.append(resolved.text)
+            conflicts += resolved.conflicts
+            if resolved.merged && resolved.conflicts == 0 { autoMerged += 1 }
+
+            if let segment = o ?? t, key != MergeDocument.preambleKey {
+                // Use the renamed heading if only their side changed it
+                let heading = (o != nil && o?.heading == b?.heading) ? (t ?? segment).heading : segment.heading
+                headingUUIDs.append(["uuid": segment.uuid ?? UUID().uuidString, "string": heading])
+            }
+        }
+
+        let text = Self.join(pieces)
+
+        // Settings are taken from our version, and anything tied to ranges in text is removed
+        var settingsString = ours.settings.getSettingsString(withAdditionalSettings: [DocSettingHeadingUUIDs: headingUUIDs], excluding: Self.rangeBasedSettings)
+        if text.count > 0 && !text.hasSuffix("\n") { settingsString = "\n" + settingsString }
+
+        return BeatMergeResult(text: text, document: text + settingsString, conflicts: conflicts, autoMerged: autoMerged)
+    }
+
+    /// Merges the order of segments. Both sides can add, remove and move scenes. If both sides reordered the same part of the document, our order is used.
+    private func mergedOrder(base: MergeDocument, ours: MergeDocument, theirs: MergeDocument) -> [String] {
+        var ids: [String: Int] = [:]
+        func id(_ key: String) -> Int {
+            if let i = ids[key] { return i }
+            ids[key] = ids.count
+            return ids.count - 1
+        }
+
+        let b = base.keys.map(id), o = ours.keys.map(id), t = theirs.keys.map(id)
+        let keys = Array(ids.keys.sorted { ids[$0]! < ids[$1]! })
+
+        var order: [Int] = []
+        var included = Set<Int>()
+
+        func append(_ values: ArraySlice<Int>) {
+            for value in values where !included.contains(value) {
+                order.append(value)
+                included.insert(value)
+            }
+        }
+
+        for chunk in diff3(base: b, ours: o, theirs: t) {
+            let bc = b[chunk.base], oc = o[chunk.ours], tc = t[chunk.theirs]
+
+            if chunk.stable || oc == tc || tc == bc { append(oc) }
+            else if oc == bc { append(tc) }
+            else {
+                append(oc)
+                append(tc)
+            }
+        }
+
+        // Segments removed on one side but modified on the other are kept, so the conflict can be resolved manually
+        for key in base.keys where !included.contains(id(key)) {
+            let original = base.segments[key]?.text
+            let survivor: MergeDocument
+
+            if let segment = ours.segments[key], segment.text != original { survivor = ours }
+            else if let segment = theirs.segments[key], segment.text != original { survivor = theirs }
+            else { continue }
+
+            // Insert after the nearest preceding segment in the version that still has it
+            var position = 0
+            if let index = survivor.keys.firstIndex(of: key) {
+                for previous in survivor.keys[..<index].reversed() {
+                    if let i = order.firstIndex(of: id(previous)) {
+                        position = i + 1
+                        break
+                    }
+                }
+            }
+
+            order.insert(id(key), at: position)
+            included.insert(id(key))
+        }
+
+        return order.map { keys[$0] }
+    }
+
+    /// Without UUIDs, a renamed heading looks like a removed segment and an added one. When base segments are missing in the document and new segments appear in their place, the new segments get the base keys, so they are merged with the other side.
+    private func matchRenamedSegments(base: MergeDocument, document: MergeDocument) {
+        var ids: [String: Int] = [:]
+        func id(_ key: String) -> Int {
+            if let i = ids[key] { return i }
+            ids[key] = ids.count
+            return ids.count - 1
+        }
+
+        let b = base.keys.map(id), d = document.keys.map(id)
+        let matches = lcsMatches(b, d)
+        var renames: [(key: String, baseKey: String)] = []
+        var i = 0, j = 0
+
+        while i <= b.count {
+            // Find the next base segment which exists in the same order in the document
+            var s = i
+            while s < b.count, matches[s] == nil { s += 1 }
+            let next = (s < b.count) ? matches[s]! : d.count
+
+            // Segments that were moved elsewhere aren't renamed
+            let removed = base.keys[i..<s].filter { document.segments[$0] == nil }
+            let added = document.keys[j..<next].filter { base.segments[$0] == nil }
+            for (baseKey, key) in zip(removed, added) { renames.append((key, baseKey)) }
+
+            i = s + 1
+            j = next + 1
+        }
+
+        for rename in renames { document.rename(rename.key, to: rename.baseKey) }
+    }
+
+    /// Resolves the content of a single segment
+    private func resolve(base: MergeSegment?, ours: MergeSegment?, theirs: MergeSegment?) -> (text: String, conflicts: Int, merged: Bool) {
+        let b = base?.text, o = ours?.text, t = theirs?.text
+
+        if o == t { return (o ?? "", 0, false) }
+        if o == b { return (t ?? "", 0, false) }
+        if t == b { return (o ?? "", 0, false) }
+
+        // Removed on one side, modified on the other
+        guard let ours, let theirs else {
+            return (conflictNote(ours: o ?? "", theirs: t ?? ""), 1, false)
+        }
+
+        // Both modified the segment, merge paragraph by paragraph
+        return mergeBlocks(base: base?.mergeBlocks ?? [], ours: ours.mergeBlocks, theirs: theirs.mergeBlocks)
+    }
+
+    private func mergeBlocks(base: [String], ours: [String], theirs: [String]) -> (text: String, conflicts: Int, merged: Bool) {
+        var ids: [String: Int] = [:]
+        func id(_ block: String) -> Int {
+            if let i = ids[block] { return i }
+            ids[block] = ids.count
+            return ids.count - 1
+        }
+
+        let b = base.map(id), o = ours.map(id), t = theirs.map(id)
+
+        var pieces: [String] = []
+        var conflicts = 0
+
+        for chunk in diff3(base: b, ours: o, theirs: t) {
+            let bc = b[chunk.base], oc = o[chunk.ours], tc = t[chunk.theirs]
+
+            if chunk.stable || oc == tc || tc == bc {
+                pieces.append(contentsOf: ours[chunk.ours])
+            } else if oc == bc {
+                pieces.append(contentsOf: theirs[chunk.theirs])
+            } else {
+                pieces.append(conflictNote(ours: Self.join(Array(ours[chunk.ours])), theirs: Self.join(Array(theirs[chunk.theirs]))))
+                conflicts += 1
+            }
+        }
+
+        return (Self.join(pieces), conflicts, true)
+    }
+
+    /// Conflicting versions are separated using notes. An empty side means the content was removed.
+    private func conflictNote(ours: String, theirs: String) -> String {
+        let oursTitle = ours.isEmpty ? "\(oursLabel) (removed)" : oursLabel
+        let theirsTitle = theirs.isEmpty ? "\(theirsLabel) (removed)" : theirsLabel
+
+        return Self.join([
+            "[[MERGE CONFLICT: \(oursTitle)]]\n\n",
+            ours,
+            "[[MERGE CONFLICT: \(theirsTitle)]]\n\n",
+            theirs,
+            "[[END OF MERGE CONFLICT]]\n\n"
+        ])
+    }
+
+    /// Joins text pieces. If a piece was the last one in its original document and lacks a line break, a paragraph break is added so it won't be glued to the next element.
+    private static func join(_ pieces: [String]) -> String {
+        var result = ""
+        for (i, piece) in pieces.enumerated() where !piece.isEmpty {
+            result += piece
+            if i < pieces.count - 1 && !piece.hasSuffix("\n") { result += "\n\n" }
+        }
+        return result
+    }
+}
+
+
+// MARK: - Documents and segments
+
+fileprivate struct MergeSegment {
+    let uuid: String?
+    let heading: String
+    /// Paragraph blocks. Each block contains its trailing empty lines, so joining the blocks returns the original text.
+    let blocks: [String]
+    let text: String
+
+    /// Blocks used for merging. The heading line is split into its own block, so a renamed heading doesn't conflict with edits in the rest of its paragraph.
+    var mergeBlocks: [String] {
+        guard !heading.isEmpty, let first = blocks.first, let newline = first.firstIndex(of: "\n") else { return blocks }
+
+        let rest = String(first[first.index(after: newline)...])
+        return [String(first[...newline])] + (rest.isEmpty ? [] : [rest]) + blocks.dropFirst()
+    }
+}
+
+fileprivate final class MergeDocument {
+    static let preambleKey = "preamble"
+
+    let settings = BeatDocumentSettings()
+    var keys: [String] = []
+    var segments: [String: MergeSegment] = [:]
+
+    /// `true` if the document has heading UUIDs stored in its settings
+    private(set) var hasUUIDs = false
+    /// Segments in order, with keys based on both UUID and heading text
+    private var entries: [(uuidKey: String?, headingKey: String, segment: MergeSegment)] = []
+
+    /// Moves a segment to the key of its base version, after its heading was changed
+    func rename(_ key: String, to baseKey: String) {
+        guard let segment = segments.removeValue(forKey: key), let i = keys.firstIndex(of: key) else { return }
+        keys[i] = baseKey
+        segments[baseKey] = segment
+    }
+
+    /// Creates the segment lookup, using either UUID or heading text keys
+    func index(useUUIDs: Bool) {
+        keys = []
+        segments = [:]
+
+        for entry in entries {
+            let key = (useUUIDs ? entry.uuidKey : nil) ?? entry.headingKey
+            keys.append(key)
+            segments[key] = entry.segment
+        }
+    }
+
+    init(string: String) {
+        let parser = ContinuousFountainParser(staticParsingWith: string, settings: settings)
+        guard let lines = parser.lines as? [Line] else { return }
+
+        // Only UUIDs which were actually stored in the file can be used to match scenes across documents
+        let storedUUIDs = Set((settings.get(DocSettingHeadingUUIDs) as? [[String: String]] ?? []).compactMap { $0["uuid"]?.uppercased() })
+        hasUUIDs = storedUUIDs.count > 0
+        var occurrences: [String: Int] = [:]
+
+        var key = MergeDocument.preambleKey
+        var uuidKey: String? = nil
+        var uuid: String? = nil
+        var heading = ""
+        var blocks: [String] = []
+        var block = ""
+        var trailingEmptyLines = false
+
+        func closeBlock() {
+            if !block.isEmpty { blocks.append(block) }
+            block = ""
+            trailingEmptyLines = false
+        }
+
+        func closeSegment() {
+            closeBlock()
+            if !blocks.isEmpty {
+                let segment = MergeSegment(uuid: uuid, heading: heading, blocks: blocks, text: blocks.joined())
+                entries.append((uuidKey: uuidKey, headingKey: key, segment: segment))
+            }
+            blocks = []
+        }
+
+        for (i, line) in lines.enumerated() {
+            let string = line.string ?? ""
+            let text = (i < lines.count - 1) ? string + "\n" : string
+
+            if line.isOutlineElement() {
+                closeSegment()
+
+                let lineUUID = line.uuidString()?.uppercased() ?? ""
+                uuid = storedUUIDs.contains(lineUUID) ? lineUUID : nil
+                uuidKey = (uuid != nil) ? "uuid:" + lineUUID : nil
+
+                let normalized = string.trimmingCharacters(in: .whitespaces).uppercased()
+                let n = occurrences[normalized, default: 0]
+                occurrences[normalized] = n + 1
+
+                key = "heading:\(normalized):\(n)"
+                heading = string
+            }
+
+            if string.isEmpty {
+                trailingEmptyLines = true
+            } else if trailingEmptyLines {
+                closeBlock()
+            }
+
+            block += text
+        }
+
+        closeSegment()
+    }
+}
+
+
+// MARK: - diff3
+
+fileprivate struct Diff3Chunk {
+    let stable: Bool
+    let base: Range<Int>
+    let ours: Range<Int>
+    let theirs: Range<Int>
+}
+
+/// Splits three sequences into stable chunks (same on every side) and unstable chunks between them
+fileprivate func diff3(base: [Int], ours: [Int], theirs: [Int]) -> [Diff3Chunk] {
+    let oursMatches = lcsMatches(base, ours)
+    let theirsMatches = lcsMatches(base, theirs)
+
+    var chunks: [Diff3Chunk] = []
+    var i = 0, j = 0, k = 0
+
+    while true {
+        // Find next base element which is matched on both sides
+        var s = i
+        while s < base.count, oursMatches[s] == nil || theirsMatches[s] == nil { s += 1 }
+
+        guard s < base.count, let oj = oursMatches[s], let tk = theirsMatches[s] else {
+            if i < base.count || j < ours.count || k < theirs.count {
+                chunks.append(Diff3Chunk(stable: false, base: i..<base.count, ours: j..<ours.count, theirs: k..<theirs.count))
+            }
+            break
+        }
+
+        if s > i || oj > j || tk > k {
+            chunks.append(Diff3Chunk(stable: false, base: i..<s, ours: j..<oj, theirs: k..<tk))
+        }
+        chunks.append(Diff3Chunk(stable: true, base: s..<s+1, ours: oj..<oj+1, theirs: tk..<tk+1))
+
+        i = s + 1
+        j = oj + 1
+        k = tk + 1
+    }
+
+    return chunks
+}
+
+/// Returns the index of matching element in `b` for each element in `a`, based on the longest common subsequence
+fileprivate func lcsMatches(_ a: [Int], _ b: [Int]) -> [Int?] {
+    var result = [Int?](repeating: nil, count: a.count)
+
+    // Common prefix and suffix
+    var prefix = 0
+    while prefix < a.count, prefix < b.count, a[prefix] == b[prefix] {
+        result[prefix] = prefix
+        prefix += 1
+    }
+
+    var suffix = 0
+    while suffix < a.count - prefix, suffix < b.count - prefix, a[a.count - 1 - suffix] == b[b.count - 1 - suffix] {
+        result[a.count - 1 - suffix] = b.count - 1 - suffix
+        suffix += 1
+    }
+
+    // Very large unmatched middle sections are treated as fully changed
+    let n = a.count - prefix - suffix, m = b.count - prefix - suffix
+    guard n > 0, m > 0, n * m <= 4_000_000 else { return result }
+
+    let width = m + 1
+    var table = [UInt16](repeating: 0, count: (n + 1) * width)
+
+    for i in stride(from: n - 1, through: 0, by: -1) {
+        for j in stride(from: m - 1, through: 0, by: -1) {
+            if a[prefix + i] == b[prefix + j] {
+                table[i * width + j] = table[(i + 1) * width + j + 1] + 1
+            } else {
+                table[i * width + j] = max(table[(i + 1) * width + j], table[i * width + j + 1])
+            }
+        }
+    }
+
+    var i = 0, j = 0
+    while i < n, j < m {
+        if a[prefix + i] == b[prefix + j] {
+            result[prefix + i] = prefix + j
+            i += 1
+            j += 1
+        } else if table[(i + 1) * width + j] >= table[i * width + j + 1] {
+            i += 1
+        } else {
+            j += 1
+        }
+    }
+
+    return result
+}
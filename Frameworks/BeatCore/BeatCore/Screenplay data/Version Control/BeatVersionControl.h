@@ -53,6 +53,12 @@ NS_ASSUME_NONNULL_BEGIN
 - (NSDictionary* _Nullable)getCommitWithTimestamp:(NSString*)timestamp;
 /// Returns an array of all commits
 - (NSArray<NSDictionary*>*)commits;
+/// Returns commit metadata from a version control dictionary, regardless of storage format
++ (NSArray<NSDictionary*>*)commitsInVersionControl:(NSDictionary*)versionControl;
+/// Returns committed text from a version control dictionary without touching any document. Committed text contains encoded settings, see `textWithoutEncodedSettings:`.
++ (NSString* _Nullable)committedTextAt:(NSString* _Nullable)timestamp versionControl:(NSDictionary*)versionControl;
+/// Strips the encoded settings block from committed text
++ (NSString*)textWithoutEncodedSettings:(NSString*)text;
 /// Returns the FULL, mutable version control dictionary
 - (NSMutableDictionary*)versionControlDictionary;
 
@@ -61,6 +67,15 @@ NS_ASSUME_NONNULL_BEGIN
 /// Automatically generates revised ranges in current document based on the given text
 - (void)generateRevisedRangesFromText:(NSString *)oldText generation:(NSInteger)generation;
 
+/// Generates revised ranges based on the given timestamp on a background thread. Ranges are applied in one batch on main thread once the diff is done. Returned progress can be observed and cancelled.
+/// - note: `applied` is `false` if the operation was cancelled or the document was edited while generating.
+- (NSProgress*)generateRevisedRangesFrom:(NSString*)timestamp generation:(NSInteger)generation completion:(void (^ _Nullable)(bool applied))completion;
+/// Generates revised ranges based on the given text on a background thread. See `generateRevisedRangesFrom:generation:completion:`.
+- (NSProgress*)generateRevisedRangesFromText:(NSString*)oldText generation:(NSInteger)generation completion:(void (^ _Nullable)(bool applied))completion;
+
+/// Returns indices in `newText` which were added or changed compared to `oldText`. Returns `nil` if the progress was cancelled.
++ (NSIndexSet* _Nullable)revisedIndicesFrom:(NSString*)oldText to:(NSString*)newText progress:(NSProgress* _Nullable)progress;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -11,9 +11,14 @@
 #import <BeatCore/NSString+Compression.h>
 #import <BeatCore/BeatRevisions.h>
 #import <BeatCore/DiffMatchPatch.h>
+#import <BeatCore/BeatVersionControlArchive.h>
 #import <CommonCrypto/CommonDigest.h>
 
-@implementation BeatVersionControl
+@implementation BeatVersionControl {
+    /// Decoded archive and the encoded string it was created from
+    BeatVersionControlArchive* _archive;
+    NSString* _archiveSource;
+}
 static NSString* dateFormat = @"yyyy-MM-dd HH:mm:ss";
 static NSString* key = @"VersionControl";
 static NSString* settingSeparator = @"<__SETTINGS__>";
@@ -80,10 +85,96 @@ static NSString* settingSeparator = @"<__SETTINGS__>";
 
 - (NSArray<NSDictionary*>*)commits
 {
+    BeatVersionControlArchive* archive = self.archive;
+    if (archive != nil) return archive.commits;
+    
     NSArray* commits = self.versionControlDictionary[@"commits"];
     return (commits != nil) ? commits : @[];
 }
 
++ (NSArray<NSDictionary*>*)commitsInVersionControl:(NSDictionary*)versionControl
+{
+    NSString* encoded = versionControl[@"archive"];
+    if ([BeatVersionControlArchive isArchive:encoded]) {
+        NSArray* commits = [BeatVersionControlArchive archiveWithEncodedString:encoded].commits;
+        return (commits != nil) ? commits : @[];
+    }
+    
+    NSArray* commits = versionControl[@"commits"];
+    return (commits != nil) ? commits : @[];
+}
+
+
+#pragma mark - Compact archive
+
+/// Returns `true` if the history is stored in the compact archive format
+- (bool)usesArchive
+{
+    return [BeatVersionControlArchive isArchive:self.versionControlDictionary[@"archive"]];
+}
+
+/// Returns the decoded archive, or `nil` if the document uses the legacy format. Decoded archive is cached until the stored string changes.
+- (BeatVersionControlArchive* _Nullable)archive
+{
+    NSString* encoded = self.versionControlDictionary[@"archive"];
+    if (![BeatVersionControlArchive isArchive:encoded]) return nil;
+    
+    if (_archive == nil || (encoded != _archiveSource && ![encoded isEqualToString:_archiveSource])) {
+        _archive = [BeatVersionControlArchive archiveWithEncodedString:encoded];
+        _archiveSource = encoded;
+        
+        if (_archive == nil) NSLog(@"🆘 WARNING: Version control archive could not be decoded.");
+    }
+    
+    return _archive;
+}
+
+/// Stores the archive in version control dictionary. Any legacy keys are removed.
+- (void)storeArchive:(BeatVersionControlArchive*)archive
+{
+    NSMutableDictionary* versionControl = self.versionControlDictionary;
+    if (versionControl == nil) versionControl = NSMutableDictionary.new;
+    
+    NSString* encoded = archive.encodedString;
+    
+    versionControl[@"archive"] = encoded;
+    [versionControl removeObjectForKey:@"base"];
+    [versionControl removeObjectForKey:@"commits"];
+    
+    _archive = archive;
+    _archiveSource = encoded;
+    
+    [self.delegate.documentSettings set:BeatVersionControl.settingKey as:versionControl];
+}
+
+/// Converts legacy patch-based history into the compact archive. Legacy patches are replayed once and each version is stored as line operations.
+- (BeatVersionControlArchive* _Nullable)convertLegacyHistory
+{
+    NSDictionary* versionControl = self.versionControlDictionary;
+    NSString* baseText = ((NSString*)versionControl[@"base"]).gzipDecompressedString;
+    if (baseText == nil) return nil;
+    
+    DiffMatchPatch *dmp = [[DiffMatchPatch alloc] init];
+    NSString* currentText = baseText;
+    NSMutableArray* versions = NSMutableArray.new;
+    
+    for (NSDictionary* commit in versionControl[@"commits"]) {
+        NSError* error;
+        NSArray *patches = [dmp patch_fromText:commit[@"patch"] error:&error];
+        if (error) {
+            NSLog(@"Error parsing patch: %@", error.localizedDescription);
+            continue;
+        }
+        currentText = [dmp patch_apply:patches toString:currentText][0];
+        
+        NSMutableDictionary* version = @{ @"text": currentText, @"timestamp": commit[@"timestamp"] }.mutableCopy;
+        if (commit[@"message"] != nil) version[@"message"] = commit[@"message"];
+        [versions addObject:version];
+    }
+    
+    return [BeatVersionControlArchive archiveWithBaseText:baseText versions:versions];
+}
+
 
 #pragma mark - Version control dictinoary health check
 
@@ -169,7 +260,24 @@ static NSString* settingSeparator = @"<__SETTINGS__>";
 
 /// Returns the __committed__ text at given timestamp. Committed text has the settings block gzipped. If you want to get the actual, readable text, use `textAt:`.
 - (NSString*)committedTextAt:(NSString* _Nullable)timestamp {
-    NSDictionary* versionControl = self.versionControlDictionary;
+    if (self.usesArchive) return [self.archive textAt:timestamp];
+    return [BeatVersionControl legacyCommittedTextAt:timestamp versionControl:self.versionControlDictionary];
+}
+
+/// Returns committed text from a version control dictionary without touching the document. Safe to call from a background thread when given a copy of the dictionary.
++ (NSString* _Nullable)committedTextAt:(NSString* _Nullable)timestamp versionControl:(NSDictionary*)versionControl
+{
+    NSString* encoded = versionControl[@"archive"];
+    if ([BeatVersionControlArchive isArchive:encoded]) {
+        return [[BeatVersionControlArchive archiveWithEncodedString:encoded] textAt:timestamp];
+    }
+    
+    return [self legacyCommittedTextAt:timestamp versionControl:versionControl];
+}
+
+/// Replays legacy patches on top of the gzipped base text
++ (NSString*)legacyCommittedTextAt:(NSString* _Nullable)timestamp versionControl:(NSDictionary*)versionControl
+{
     NSString* baseText = ((NSString*)versionControl[@"base"]).gzipDecompressedString;
     
     if (![timestamp isEqualToString:@"base"] && baseText != nil) {
@@ -223,13 +331,16 @@ static NSString* settingSeparator = @"<__SETTINGS__>";
 
 - (void)createInitialCommit
 {
-    NSString *text = self.textToCommit.gzipCompressedString;
+    BeatVersionControlArchive* archive = [BeatVersionControlArchive.alloc initWithBaseText:self.textToCommit];
+    NSString* encoded = archive.encodedString;
     NSDictionary* intialVersionControl = @{
-        @"base": text,
-        @"timestamp": self.currentTimestamp,
-        @"commits": @[]
+        @"archive": encoded,
+        @"timestamp": self.currentTimestamp
     };
     
+    _archive = archive;
+    _archiveSource = encoded;
+    
     [self.delegate.documentSettings set:BeatVersionControl.settingKey as:intialVersionControl];
 }
 
@@ -240,29 +351,16 @@ static NSString* settingSeparator = @"<__SETTINGS__>";
 
 - (void)addCommitWithMessage:(NSString* _Nullable)message
 {
-    NSMutableDictionary* versionControl = self.versionControlDictionary;
-    
-    NSString* text = self.textToCommit;
-    NSString* latestText = [self committedTextAt:self.latestTimestamp];
-    
-    // Create new patch
-    DiffMatchPatch *dmp = [[DiffMatchPatch alloc] init];
-    NSMutableArray *patches = [dmp patch_makeFromOldString:latestText andNewString:text];
-    NSString *patchText = [dmp patch_toText:patches];
-    
-    // Add commit to the array
-    NSMutableArray *commits = ((NSArray*)versionControl[@"commits"]).mutableCopy;
-    NSMutableDictionary *commit = @{
-        @"timestamp": self.currentTimestamp,
-        @"patch": patchText
-    }.mutableCopy;
-    // Add message if provided
-    if (message != nil && message.length > 0) commit[@"message"] = message;
+    // Legacy histories are converted to the compact format when a new commit is added
+    BeatVersionControlArchive* archive = (self.usesArchive) ? self.archive : self.convertLegacyHistory;
+    if (archive == nil) {
+        NSLog(@"🆘 WARNING: Could not read version control history. Commit was not added.");
+        return;
+    }
     
-    [commits addObject:commit];
-    versionControl[@"commits"] = commits;
+    [archive addCommitWithText:self.textToCommit timestamp:self.currentTimestamp message:message];
     
-    [self.delegate.documentSettings set:BeatVersionControl.settingKey as:versionControl];
+    [self storeArchive:archive];
     [self storeChecksum:nil];
 }
 
@@ -281,31 +379,20 @@ static NSString* settingSeparator = @"<__SETTINGS__>";
 
 - (NSString* _Nullable)revertTo:(NSString*)timestamp
 {
-    NSMutableArray* commits = self.commits.mutableCopy;
     NSString* result = [self textAt:timestamp];
     
-    bool found = false;
-    // If the timestamp is nil, we'll delete ALL commits and just spare the base
-    if (timestamp == nil || [timestamp isEqualToString:@"base"]) found = true;
-    
-    // Delete all timestamps after this one
-    for (NSDictionary* commit in commits.copy) {
-        if (found) {
-            [commits removeObject:commit];
-            continue;
-        }
-        
-        NSString* commitTime = commit[@"timestamp"];
-        if ([commitTime isEqualToString:timestamp]) found = true;
-    }
-    
-    // The stored deltas DO NOT have version control data, so we need to reconstruct that.
     // 1) First save the truncated commits
+    BeatVersionControlArchive* archive = (self.usesArchive) ? self.archive : self.convertLegacyHistory;
+    if (archive != nil) {
+        [archive removeCommitsAfter:timestamp];
+        [self storeArchive:archive];
+    } else {
+        [self truncateLegacyCommitsAfter:timestamp];
+    }
     NSMutableDictionary* vc = self.versionControlDictionary;
-    vc[@"commits"] = commits;
-    [self.delegate.documentSettings set:BeatVersionControl.settingKey as:vc];
-
-    // 2) Read the settings block from restored text to a setting object and store current version control data (up to selected point)
+    
+    // 2) The stored deltas DO NOT have version control data, so we need to reconstruct that.
+    // Read the settings block from restored text to a setting object and store current version control data (up to selected point)
     BeatDocumentSettings* settings = BeatDocumentSettings.new;
     NSRange settingsRange = [settings readSettingsAndReturnRange:result];
     // Remove the old settings (if applicable)
@@ -313,8 +400,8 @@ static NSString* settingSeparator = @"<__SETTINGS__>";
         result = [result substringToIndex:settingsRange.location];
     }
     
-    
     // Inject version control data
+    [vc removeObjectForKey:@"checksum"];
     NSString* checksum = [BeatVersionControl checksumForDictionary:vc];
     vc[@"checksum"] = checksum;
     [settings set:BeatVersionControl.settingKey as:vc];
@@ -326,6 +413,31 @@ static NSString* settingSeparator = @"<__SETTINGS__>";
     return result;
 }
 
+/// Removes legacy commits after given timestamp. Only used if the legacy history can't be converted.
+- (void)truncateLegacyCommitsAfter:(NSString* _Nullable)timestamp
+{
+    NSMutableArray* commits = self.commits.mutableCopy;
+    
+    bool found = false;
+    // If the timestamp is nil, we'll delete ALL commits and just spare the base
+    if (timestamp == nil || [timestamp isEqualToString:@"base"]) found = true;
+    
+    // Delete all timestamps after this one
+    for (NSDictionary* commit in commits.copy) {
+        if (found) {
+            [commits removeObject:commit];
+            continue;
+        }
+        
+        NSString* commitTime = commit[@"timestamp"];
+        if ([commitTime isEqualToString:timestamp]) found = true;
+    }
+    
+    NSMutableDictionary* vc = self.versionControlDictionary;
+    vc[@"commits"] = commits;
+    [self.delegate.documentSettings set:BeatVersionControl.settingKey as:vc];
+}
+
 
 #pragma mark - Get commit metadata
 
@@ -333,9 +445,7 @@ static NSString* settingSeparator = @"<__SETTINGS__>";
 {
     if (timestamp == nil) return nil;
     
-    NSDictionary* versionControl = self.versionControlDictionary;
-    NSArray* commits = versionControl[@"commits"];
-    for (NSDictionary* commit in commits) {
+    for (NSDictionary* commit in self.commits) {
         NSString* commitTime = commit[@"timestamp"];
         if ([commitTime isEqualToString:timestamp]) return commit;
     }
@@ -345,10 +455,9 @@ static NSString* settingSeparator = @"<__SETTINGS__>";
 
 - (NSArray<NSString*>*)timestamps
 {
-    NSDictionary* versionControl = self.versionControlDictionary;
     NSMutableArray<NSString*>* commits = NSMutableArray.new;
     
-    for (NSDictionary* commit in versionControl[@"commits"]) {
+    for (NSDictionary* commit in self.commits) {
         NSString* timestamp = commit[@"timestamp"];
         if (timestamp != nil) [commits addObject:timestamp];
     }
@@ -382,29 +491,17 @@ static NSString* settingSeparator = @"<__SETTINGS__>";
 
 - (void)generateRevisedRangesFromText:(NSString *)oldText generation:(NSInteger)generation
 {
-    NSString* currentText = self.delegate.text;
-    
-    NSArray<Diff*>* diffs = [self diffsFrom:currentText with:oldText];
-    
-    // Go through the changed indices and calculate their positions
-    NSMutableIndexSet *changedIndices = NSMutableIndexSet.new;
-    NSInteger i = 0;
-
-    for (Diff* d in diffs) {
-        if (d.operation == DIFF_EQUAL) {
-            i += d.text.length;
-        } else if (d.operation == DIFF_INSERT) {
-            [changedIndices addIndexesInRange:NSMakeRange(i, d.text.length)];
-            i += d.text.length;
-        }
-    }
-    
+    NSIndexSet* changedIndices = [BeatVersionControl revisedIndicesFrom:oldText to:self.delegate.text progress:nil];
     [self.delegate.revisionTracking addRevisions:changedIndices generation:generation];
 }
 
 - (NSString*)textWithoutEncodedSettingsAt:(NSString*)timestamp
 {
-    NSString* text = [self committedTextAt:timestamp];
+    return [BeatVersionControl textWithoutEncodedSettings:[self committedTextAt:timestamp]];
+}
+
++ (NSString*)textWithoutEncodedSettings:(NSString*)text
+{
     NSInteger settingLocation = [text rangeOfString:BeatVersionControl.settingSeparator].location;
     if (settingLocation != NSNotFound) {
         text = [text substringToIndex:settingLocation];
@@ -413,11 +510,125 @@ static NSString* settingSeparator = @"<__SETTINGS__>";
     return text;
 }
 
-- (NSArray*)diffsFrom:(NSString*)newString with:(NSString*)oldString {
+
+#pragma mark - Generate revisions in background
+
+- (NSProgress*)generateRevisedRangesFrom:(NSString*)timestamp generation:(NSInteger)generation completion:(void (^ _Nullable)(bool applied))completion
+{
+    // Copy the dictionary on main thread, the actual text is reconstructed in background
+    NSDictionary* versionControl = self.versionControlDictionary.copy;
+    
+    return [self generateRevisedRangesInBackground:^NSString *{
+        return [BeatVersionControl textWithoutEncodedSettings:[BeatVersionControl committedTextAt:timestamp versionControl:versionControl]];
+    } generation:generation completion:completion];
+}
+
+- (NSProgress*)generateRevisedRangesFromText:(NSString*)oldText generation:(NSInteger)generation completion:(void (^ _Nullable)(bool applied))completion
+{
+    NSString* text = oldText.copy;
+    return [self generateRevisedRangesInBackground:^NSString *{ return text; } generation:generation completion:completion];
+}
+
+/// Runs the diff over an immutable snapshot of current text on a background queue and applies the resulting ranges in one batch on main thread.
+/// If the document was edited while the diff was running, the results are discarded because the ranges would no longer match.
+- (NSProgress*)generateRevisedRangesInBackground:(NSString* (^)(void))oldTextProvider generation:(NSInteger)generation completion:(void (^ _Nullable)(bool applied))completion
+{
+    NSProgress* progress = [NSProgress progressWithTotalUnitCount:100];
+    progress.cancellable = true;
+    
+    NSString* snapshot = self.delegate.text.copy;
+    __weak typeof(self) weakSelf = self;
+    
+    dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+        NSString* oldText = oldTextProvider();
+        progress.completedUnitCount = 10;
+        
+        NSIndexSet* indices = (oldText != nil && !progress.cancelled) ? [BeatVersionControl revisedIndicesFrom:oldText to:snapshot progress:progress] : nil;
+        
+        dispatch_async(dispatch_get_main_queue(), ^{
+            BeatVersionControl* vc = weakSelf;
+            bool applied = false;
+            
+            if (vc != nil && indices != nil && !progress.cancelled && [vc.delegate.text isEqualToString:snapshot]) {
+                [vc.delegate.revisionTracking addRevisions:indices generation:generation];
+                applied = true;
+            }
+            
+            progress.completedUnitCount = progress.totalUnitCount;
+            if (completion) completion(applied);
+        });
+    });
+    
+    return progress;
+}
+
+/// Returns indices in `newText` which were added or changed compared to `oldText`.
+/// The texts are first diffed line by line, and only the changed hunks are diffed character by character. This lets us report progress and bail out early if the progress is cancelled, in which case `nil` is returned.
++ (NSIndexSet* _Nullable)revisedIndicesFrom:(NSString*)oldText to:(NSString*)newText progress:(NSProgress* _Nullable)progress
+{
     DiffMatchPatch *dmp = DiffMatchPatch.new;
-    NSMutableArray *diffs = [dmp diff_mainOfOldString:oldString andNewString:newString];
-    [dmp diff_cleanupSemantic:diffs];
-    return diffs;
+    
+    // Line-level pass
+    NSArray *lineData = [dmp diff_linesToCharsForFirstString:oldText andSecondString:newText];
+    NSMutableArray<Diff*>* lineDiffs = [dmp diff_mainOfOldString:lineData[0] andNewString:lineData[1] checkLines:NO];
+    [dmp diff_chars:lineDiffs toLines:lineData[2]];
+    
+    if (progress.cancelled) return nil;
+    
+    // Progress is reported in the remaining units relative to position in new text
+    int64_t startUnit = progress.completedUnitCount;
+    int64_t units = progress.totalUnitCount - startUnit - 1;
+    NSUInteger length = MAX(newText.length, 1);
+    
+    NSMutableIndexSet* changedIndices = NSMutableIndexSet.new;
+    NSMutableString* deleted = NSMutableString.new;
+    NSMutableString* inserted = NSMutableString.new;
+    __block NSUInteger i = 0;
+    
+    // Character-level pass for each changed hunk
+    bool (^processHunk)(void) = ^bool {
+        if (inserted.length == 0) {
+            [deleted setString:@""];
+            return true;
+        }
+        
+        if (deleted.length == 0) {
+            [changedIndices addIndexesInRange:NSMakeRange(i, inserted.length)];
+        } else {
+            NSMutableArray<Diff*>* diffs = [dmp diff_mainOfOldString:deleted andNewString:inserted checkLines:NO];
+            [dmp diff_cleanupSemantic:diffs];
+            
+            NSUInteger p = i;
+            for (Diff* d in diffs) {
+                if (d.operation == DIFF_INSERT) [changedIndices addIndexesInRange:NSMakeRange(p, d.text.length)];
+                if (d.operation != DIFF_DELETE) p += d.text.length;
+            }
+        }
+        
+        i += inserted.length;
+        [deleted setString:@""];
+        [inserted setString:@""];
+        
+        if (progress != nil) {
+            if (progress.cancelled) return false;
+            progress.completedUnitCount = startUnit + (int64_t)((double)units * i / length);
+        }
+        return true;
+    };
+    
+    for (Diff* d in lineDiffs) {
+        if (d.operation == DIFF_DELETE) {
+            [deleted appendString:d.text];
+        } else if (d.operation == DIFF_INSERT) {
+            [inserted appendString:d.text];
+        } else {
+            if (!processHunk()) return nil;
+            i += d.text.length;
+        }
+    }
+    if (!processHunk()) return nil;
+    
+    return changedIndices;
 }
 
 @end
@@ -0,0 +1,66 @@
+//
+//  BeatVersionControlArchive.h
+//  BeatCore
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+/**
+
+ Compact binary storage for version control history.
+
+ The legacy format stores the base text as a gzipped base64 string and every commit as a `patch_toText:` string. Both are
+ URL-encoded and end up in the settings JSON, which bloats the file and makes opening slower.
+
+ The archive stores __line-level__ operations instead. Every unique line (including its line break) is stored once in a shared
+ string pool, and each commit is a list of varint-encoded keep/delete/insert operations against the previous version.
+ Commit metadata (timestamp and message) lives in an index, so listing commits doesn't require decoding any operations.
+ The whole payload is compressed as a single zlib stream and base64-encoded for the settings block.
+
+ Payload layout (before compression):
+ ```
+ [pool count] ([byte length] [UTF-8 bytes])...
+ [base line count] [pool index]...
+ [commit count] ([timestamp index] [message index + 1 or 0] [op offset] [op length])...
+ [op bytes]
+ ```
+ Each op is `(count << 2) | kind` followed by `count` pool indices for insertions.
+
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface BeatVersionControlArchive : NSObject
+
+/// Returns `true` if the string looks like an encoded archive
++ (bool)isArchive:(NSString* _Nullable)string;
+
+/// Creates a new archive with the given base text and no commits
+- (instancetype)initWithBaseText:(NSString*)baseText;
+/// Decodes an archive from its base64 representation. Returns `nil` if the data is corrupted.
++ (instancetype _Nullable)archiveWithEncodedString:(NSString*)string;
+/// Builds an archive from legacy data: base text and an ordered array of commit dictionaries with full committed text in `text` key.
++ (instancetype)archiveWithBaseText:(NSString*)baseText versions:(NSArray<NSDictionary*>*)versions;
+
+/// Returns the base64-encoded, compressed archive
+- (NSString*)encodedString;
+
+/// The base text
+- (NSString*)baseText;
+/// Commit metadata (`timestamp` and optional `message`) in the same format as legacy commit dictionaries
+- (NSArray<NSDictionary<NSString*, NSString*>*>*)commits;
+/// Number of commits
+- (NSUInteger)commitCount;
+
+/// Returns committed text at given timestamp. `"base"` returns base text, `nil` or an unknown timestamp returns the latest version.
+- (NSString*)textAt:(NSString* _Nullable)timestamp;
+
+/// Appends a new commit. Operations are calculated against the latest version.
+- (void)addCommitWithText:(NSString*)text timestamp:(NSString*)timestamp message:(NSString* _Nullable)message;
+/// Removes every commit after the given timestamp. `nil` or `"base"` removes all commits. Strings which were only used by the removed commits are dropped, too.
+- (void)removeCommitsAfter:(NSString* _Nullable)timestamp;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,655 @@
+//
+//  BeatVersionControlArchive.m
+//  BeatCore
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+#import "BeatVersionControlArchive.h"
+#import <BeatCore/DiffMatchPatch.h>
+#import <zlib.h>
+
+static const char archiveMagic[4] = { 'B', 'V', 'C', 'A' };
+static const uint8_t archiveVersion = 1;
+
+typedef NS_ENUM(uint8_t, BeatArchiveOp) {
+    BeatArchiveOpKeep = 0,
+    BeatArchiveOpDelete = 1,
+    BeatArchiveOpInsert = 2
+};
+
+
+#pragma mark - Varint helpers
+
+static void writeVarint(NSMutableData* data, uint64_t value)
+{
+    uint8_t buffer[10];
+    NSInteger i = 0;
+
+    while (value >= 0x80) {
+        buffer[i++] = (uint8_t)(value | 0x80);
+        value >>= 7;
+    }
+    buffer[i++] = (uint8_t)value;
+
+    [data appendBytes:buffer length:i];
+}
+
+/// Reads a varint from the buffer and advances position. Returns `false` if the buffer ends prematurely.
+static bool readVarint(const uint8_t* bytes, NSUInteger length, NSUInteger* position, uint64_t* value)
+{
+    uint64_t result = 0;
+    NSInteger shift = 0;
+
+    while (*position < length && shift < 64) {
+        uint8_t byte = bytes[(*position)++];
+        result |= (uint64_t)(byte & 0x7F) << shift;
+
+        if ((byte & 0x80) == 0) {
+            *value = result;
+            return true;
+        }
+        shift += 7;
+    }
+
+    return false;
+}
+
+
+#pragma mark - Commit item
+
+@interface BeatVersionControlArchiveCommit : NSObject
+@property (nonatomic) uint32_t timestamp;
+/// Pool index for message, `-1` if there's no message
+@property (nonatomic) NSInteger message;
+@property (nonatomic) NSData* ops;
+@end
+
+@implementation BeatVersionControlArchiveCommit
+@end
+
+
+#pragma mark - Archive
+
+@implementation BeatVersionControlArchive {
+    NSMutableArray<NSString*>* _pool;
+    NSMutableDictionary<NSString*, NSNumber*>* _poolIndex;
+    /// Base text as an array of `uint32_t` pool indices
+    NSMutableData* _baseLines;
+    NSMutableArray<BeatVersionControlArchiveCommit*>* _commits;
+}
+
++ (bool)isArchive:(NSString* _Nullable)string
+{
+    // Magic bytes "BVCA" encode to "QlZDQ" in base64
+    return [string hasPrefix:@"QlZDQ"];
+}
+
+- (instancetype)initEmpty
+{
+    self = [super init];
+    if (self) {
+        _pool = NSMutableArray.new;
+        _poolIndex = NSMutableDictionary.new;
+        _baseLines = NSMutableData.new;
+        _commits = NSMutableArray.new;
+    }
+    return self;
+}
+
+- (instancetype)initWithBaseText:(NSString*)baseText
+{
+    self = [self initEmpty];
+    if (self) {
+        _baseLines = [self linesForText:baseText];
+    }
+    return self;
+}
+
++ (instancetype)archiveWithBaseText:(NSString*)baseText versions:(NSArray<NSDictionary*>*)versions
+{
+    BeatVersionControlArchive* archive = [BeatVersionControlArchive.alloc initWithBaseText:baseText];
+
+    for (NSDictionary* version in versions) {
+        NSString* text = version[@"text"];
+        NSString* timestamp = version[@"timestamp"];
+        if (text == nil || timestamp == nil) continue;
+
+        [archive addCommitWithText:text timestamp:timestamp message:version[@"message"]];
+    }
+
+    return archive;
+}
+
+
+#pragma mark - String pool
+
+- (uint32_t)poolIndexFor:(NSString*)string
+{
+    NSNumber* index = _poolIndex[string];
+    if (index != nil) return index.unsignedIntValue;
+
+    uint32_t i = (uint32_t)_pool.count;
+    [_pool addObject:string];
+    _poolIndex[string] = @(i);
+
+    return i;
+}
+
+/// Splits text into lines (line breaks are included in each line) and returns their pool indices as an `uint32_t` array
+- (NSMutableData*)linesForText:(NSString*)text
+{
+    NSMutableData* lines = NSMutableData.new;
+    NSUInteger location = 0;
+    NSUInteger length = text.length;
+
+    while (location < length) {
+        NSRange lineBreak = [text rangeOfString:@"\n" options:NSLiteralSearch range:NSMakeRange(location, length - location)];
+        NSUInteger end = (lineBreak.location == NSNotFound) ? length : NSMaxRange(lineBreak);
+
+        uint32_t index = [self poolIndexFor:[text substringWithRange:NSMakeRange(location, end - location)]];
+        [lines appendBytes:&index length:sizeof(uint32_t)];
+
+        location = end;
+    }
+
+    return lines;
+}
+
+- (NSString*)textForLines:(NSData*)lines
+{
+    const uint32_t* indices = lines.bytes;
+    NSUInteger count = lines.length / sizeof(uint32_t);
+
+    NSUInteger capacity = 0;
+    for (NSUInteger i = 0; i < count; i++) capacity += _pool[indices[i]].length;
+
+    NSMutableString* text = [NSMutableString stringWithCapacity:capacity];
+    for (NSUInteger i = 0; i < count; i++) [text appendString:_pool[indices[i]]];
+
+    return text;
+}
+
+
+#pragma mark - Replaying commits
+
+/// Applies encoded operations to given lines. Returns `nil` if the operations are corrupted.
+- (NSMutableData* _Nullable)applyOps:(NSData*)ops toLines:(NSData*)lines
+{
+    const uint32_t* source = lines.bytes;
+    NSUInteger sourceCount = lines.length / sizeof(uint32_t);
+    NSUInteger s = 0;
+
+    const uint8_t* bytes = ops.bytes;
+    NSUInteger length = ops.length;
+    NSUInteger position = 0;
+
+    NSMutableData* result = [NSMutableData dataWithCapacity:lines.length];
+
+    while (position < length) {
+        uint64_t op;
+        if (!readVarint(bytes, length, &position, &op)) return nil;
+
+        uint64_t count = op >> 2;
+        BeatArchiveOp kind = op & 0x3;
+
+        if (kind == BeatArchiveOpKeep) {
+            if (s + count > sourceCount) return nil;
+            [result appendBytes:source + s length:count * sizeof(uint32_t)];
+            s += count;
+        } else if (kind == BeatArchiveOpDelete) {
+            if (s + count > sourceCount) return nil;
+            s += count;
+        } else if (kind == BeatArchiveOpInsert) {
+            for (uint64_t i = 0; i < count; i++) {
+                uint64_t index;
+                if (!readVarint(bytes, length, &position, &index) || index >= _pool.count) return nil;
+                uint32_t value = (uint32_t)index;
+                [result appendBytes:&value length:sizeof(uint32_t)];
+            }
+        } else {
+            return nil;
+        }
+    }
+
+    // Anything left over is kept as-is
+    if (s < sourceCount) [result appendBytes:source + s length:(sourceCount - s) * sizeof(uint32_t)];
+
+    return result;
+}
+
+/// Returns line indices after applying commits up to (and including) given index. `-1` returns base lines.
+- (NSData*)linesAtCommitIndex:(NSInteger)commitIndex
+{
+    NSData* lines = _baseLines;
+
+    for (NSInteger i = 0; i <= commitIndex && i < _commits.count; i++) {
+        NSData* result = [self applyOps:_commits[i].ops toLines:lines];
+        if (result == nil) {
+            NSLog(@"🆘 Version control archive: corrupted operations in commit %ld", i);
+            break;
+        }
+        lines = result;
+    }
+
+    return lines;
+}
+
+- (NSInteger)commitIndexForTimestamp:(NSString* _Nullable)timestamp
+{
+    if (timestamp == nil) return NSNotFound;
+
+    NSNumber* poolIndex = _poolIndex[timestamp];
+    if (poolIndex == nil) return NSNotFound;
+
+    for (NSInteger i = 0; i < _commits.count; i++) {
+        if (_commits[i].timestamp == poolIndex.unsignedIntValue) return i;
+    }
+
+    return NSNotFound;
+}
+
+- (NSString*)baseText
+{
+    return [self textForLines:_baseLines];
+}
+
+- (NSString*)textAt:(NSString* _Nullable)timestamp
+{
+    if ([timestamp isEqualToString:@"base"]) return self.baseText;
+
+    NSInteger index = [self commitIndexForTimestamp:timestamp];
+    if (index == NSNotFound) index = (NSInteger)_commits.count - 1;
+
+    return [self textForLines:[self linesAtCommitIndex:index]];
+}
+
+
+#pragma mark - Commit metadata
+
+- (NSUInteger)commitCount
+{
+    return _commits.count;
+}
+
+- (NSArray<NSDictionary<NSString*, NSString*>*>*)commits
+{
+    NSMutableArray* commits = [NSMutableArray arrayWithCapacity:_commits.count];
+
+    for (BeatVersionControlArchiveCommit* commit in _commits) {
+        NSMutableDictionary* dict = [NSMutableDictionary dictionaryWithObject:_pool[commit.timestamp] forKey:@"timestamp"];
+        if (commit.message >= 0) dict[@"message"] = _pool[commit.message];
+        [commits addObject:dict];
+    }
+
+    return commits;
+}
+
+
+#pragma mark - Adding and removing commits
+
+- (void)addCommitWithText:(NSString*)text timestamp:(NSString*)timestamp message:(NSString* _Nullable)message
+{
+    NSData* oldLines = [self linesAtCommitIndex:(NSInteger)_commits.count - 1];
+    NSData* newLines = [self linesForText:text];
+
+    BeatVersionControlArchiveCommit* commit = BeatVersionControlArchiveCommit.new;
+    commit.timestamp = [self poolIndexFor:timestamp];
+    commit.message = (message.length > 0) ? [self poolIndexFor:message] : -1;
+    commit.ops = [self opsFrom:oldLines to:newLines];
+
+    [_commits addObject:commit];
+}
+
+- (void)removeCommitsAfter:(NSString* _Nullable)timestamp
+{
+    NSInteger index = -1;
+    if (timestamp != nil && ![timestamp isEqualToString:@"base"]) {
+        index = [self commitIndexForTimestamp:timestamp];
+        if (index == NSNotFound) return;
+    }
+
+    NSInteger first = index + 1;
+    if (first >= _commits.count) return;
+    
+    [_commits removeObjectsInRange:NSMakeRange(first, _commits.count - first)];
+    
+    // Strings used only by the removed commits would otherwise stay in the document forever
+    [self compactPool];
+}
+
+/// Calls the block for each pool index inserted by given operations. Returns `false` if the operations are corrupted.
+static bool enumerateInsertedIndices(NSData* ops, void (^block)(uint64_t index))
+{
+    const uint8_t* bytes = ops.bytes;
+    NSUInteger length = ops.length;
+    NSUInteger position = 0;
+    
+    while (position < length) {
+        uint64_t op;
+        if (!readVarint(bytes, length, &position, &op)) return false;
+        if ((op & 0x3) != BeatArchiveOpInsert) continue;
+        
+        for (uint64_t i = 0; i < (op >> 2); i++) {
+            uint64_t index;
+            if (!readVarint(bytes, length, &position, &index)) return false;
+            block(index);
+        }
+    }
+    
+    return true;
+}
+
+/// Drops strings which are no longer referenced by base lines or any commit, and remaps the indices
+- (void)compactPool
+{
+    NSUInteger poolCount = _pool.count;
+    NSMutableIndexSet* used = NSMutableIndexSet.new;
+    
+    const uint32_t* base = _baseLines.bytes;
+    NSUInteger baseCount = _baseLines.length / sizeof(uint32_t);
+    for (NSUInteger i = 0; i < baseCount; i++) [used addIndex:base[i]];
+    
+    __block bool valid = true;
+    for (BeatVersionControlArchiveCommit* commit in _commits) {
+        [used addIndex:commit.timestamp];
+        if (commit.message >= 0) [used addIndex:commit.message];
+        
+        if (!enumerateInsertedIndices(commit.ops, ^(uint64_t index) {
+            if (index < poolCount) [used addIndex:(NSUInteger)index];
+            else valid = false;
+        })) valid = false;
+        
+        // Don't touch anything if we can't be sure what's in use
+        if (!valid) return;
+    }
+    
+    if (used.count == poolCount) return;
+    
+    // Old index → new index
+    uint32_t* remap = malloc(MAX(poolCount, 1) * sizeof(uint32_t));
+    NSMutableArray<NSString*>* pool = [NSMutableArray arrayWithCapacity:used.count];
+    NSMutableDictionary<NSString*, NSNumber*>* poolIndex = [NSMutableDictionary dictionaryWithCapacity:used.count];
+    
+    [used enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL * _Nonnull stop) {
+        remap[idx] = (uint32_t)pool.count;
+        poolIndex[self->_pool[idx]] = @(pool.count);
+        [pool addObject:self->_pool[idx]];
+    }];
+    
+    uint32_t* lines = _baseLines.mutableBytes;
+    for (NSUInteger i = 0; i < baseCount; i++) lines[i] = remap[lines[i]];
+    
+    for (BeatVersionControlArchiveCommit* commit in _commits) {
+        commit.timestamp = remap[commit.timestamp];
+        if (commit.message >= 0) commit.message = remap[commit.message];
+        commit.ops = [self ops:commit.ops remappedWith:remap];
+    }
+    
+    free(remap);
+    
+    _pool = pool;
+    _poolIndex = poolIndex;
+}
+
+/// Re-encodes operations with remapped pool indices. Operations have to be valid.
+- (NSData*)ops:(NSData*)ops remappedWith:(const uint32_t*)remap
+{
+    const uint8_t* bytes = ops.bytes;
+    NSUInteger length = ops.length;
+    NSUInteger position = 0;
+    
+    NSMutableData* result = [NSMutableData dataWithCapacity:length];
+    
+    while (position < length) {
+        uint64_t op;
+        readVarint(bytes, length, &position, &op);
+        writeVarint(result, op);
+        if ((op & 0x3) != BeatArchiveOpInsert) continue;
+        
+        for (uint64_t i = 0; i < (op >> 2); i++) {
+            uint64_t index;
+            readVarint(bytes, length, &position, &index);
+            writeVarint(result, remap[index]);
+        }
+    }
+    
+    return result;
+}
+
+
+#pragma mark - Line diffing
+
+static void appendOp(NSMutableData* ops, BeatArchiveOp kind, NSUInteger count)
+{
+    if (count > 0) writeVarint(ops, ((uint64_t)count << 2) | kind);
+}
+
+/// Calculates line-level operations between two line index arrays
+- (NSData*)opsFrom:(NSData*)oldData to:(NSData*)newData
+{
+    const uint32_t* old = oldData.bytes;
+    const uint32_t* neu = newData.bytes;
+    NSUInteger oldCount = oldData.length / sizeof(uint32_t);
+    NSUInteger newCount = newData.length / sizeof(uint32_t);
+
+    // Trim common prefix and suffix first. Most commits only touch a small part of the document.
+    NSUInteger prefix = 0;
+    while (prefix < oldCount && prefix < newCount && old[prefix] == neu[prefix]) prefix++;
+
+    NSUInteger suffix = 0;
+    while (suffix < oldCount - prefix && suffix < newCount - prefix && old[oldCount - 1 - suffix] == neu[newCount - 1 - suffix]) suffix++;
+
+    NSMutableData* ops = NSMutableData.new;
+    appendOp(ops, BeatArchiveOpKeep, prefix);
+
+    const uint32_t* oldMiddle = old + prefix;
+    const uint32_t* newMiddle = neu + prefix;
+    NSUInteger oldMiddleCount = oldCount - prefix - suffix;
+    NSUInteger newMiddleCount = newCount - prefix - suffix;
+
+    __block NSUInteger n = 0;
+    void (^insert)(NSUInteger) = ^(NSUInteger count) {
+        appendOp(ops, BeatArchiveOpInsert, count);
+        for (NSUInteger i = 0; i < count; i++) writeVarint(ops, newMiddle[n + i]);
+        n += count;
+    };
+
+    NSArray<Diff*>* diffs = [self lineDiffsFrom:oldMiddle count:oldMiddleCount to:newMiddle count:newMiddleCount];
+
+    if (diffs == nil) {
+        // Too many unique lines to diff, replace the whole middle section
+        appendOp(ops, BeatArchiveOpDelete, oldMiddleCount);
+        insert(newMiddleCount);
+    } else {
+        for (Diff* diff in diffs) {
+            NSUInteger count = diff.text.length;
+
+            if (diff.operation == DIFF_EQUAL) {
+                appendOp(ops, BeatArchiveOpKeep, count);
+                n += count;
+            } else if (diff.operation == DIFF_DELETE) {
+                appendOp(ops, BeatArchiveOpDelete, count);
+            } else if (diff.operation == DIFF_INSERT) {
+                insert(count);
+            }
+        }
+    }
+
+    // Trailing lines are kept implicitly
+    return ops;
+}
+
+/// Maps lines to single characters and diffs them using DMP. Returns `nil` if there are too many unique lines to map.
+- (NSArray<Diff*>* _Nullable)lineDiffsFrom:(const uint32_t*)old count:(NSUInteger)oldCount to:(const uint32_t*)neu count:(NSUInteger)newCount
+{
+    if (oldCount == 0 && newCount == 0) return @[];
+
+    NSMutableDictionary<NSNumber*, NSNumber*>* map = NSMutableDictionary.new;
+    // Character 0 is avoided and surrogate range is out of bounds
+    const NSUInteger maxCharacter = 0xD7FF;
+
+    unichar* (^encode)(const uint32_t*, NSUInteger) = ^unichar*(const uint32_t* lines, NSUInteger count) {
+        unichar* chars = malloc(MAX(count, 1) * sizeof(unichar));
+        for (NSUInteger i = 0; i < count; i++) {
+            NSNumber* c = map[@(lines[i])];
+            if (c == nil) {
+                if (map.count + 1 > maxCharacter) { free(chars); return NULL; }
+                c = @(map.count + 1);
+                map[@(lines[i])] = c;
+            }
+            chars[i] = c.unsignedShortValue;
+        }
+        return chars;
+    };
+
+    unichar* oldChars = encode(old, oldCount);
+    if (oldChars == NULL) return nil;
+    unichar* newChars = encode(neu, newCount);
+    if (newChars == NULL) { free(oldChars); return nil; }
+
+    NSString* oldString = [NSString.alloc initWithCharactersNoCopy:oldChars length:oldCount freeWhenDone:YES];
+    NSString* newString = [NSString.alloc initWithCharactersNoCopy:newChars length:newCount freeWhenDone:YES];
+
+    DiffMatchPatch* dmp = DiffMatchPatch.new;
+    return [dmp diff_mainOfOldString:oldString andNewString:newString checkLines:NO];
+}
+
+
+#pragma mark - Encoding
+
+- (NSString*)encodedString
+{
+    NSMutableData* payload = NSMutableData.new;
+
+    // String pool
+    writeVarint(payload, _pool.count);
+    for (NSString* string in _pool) {
+        NSData* data = [string dataUsingEncoding:NSUTF8StringEncoding];
+        writeVarint(payload, data.length);
+        [payload appendData:data];
+    }
+
+    // Base lines
+    const uint32_t* base = _baseLines.bytes;
+    NSUInteger baseCount = _baseLines.length / sizeof(uint32_t);
+    writeVarint(payload, baseCount);
+    for (NSUInteger i = 0; i < baseCount; i++) writeVarint(payload, base[i]);
+
+    // Commit index
+    writeVarint(payload, _commits.count);
+    NSUInteger offset = 0;
+    for (BeatVersionControlArchiveCommit* commit in _commits) {
+        writeVarint(payload, commit.timestamp);
+        writeVarint(payload, commit.message + 1);
+        writeVarint(payload, offset);
+        writeVarint(payload, commit.ops.length);
+        offset += commit.ops.length;
+    }
+
+    // Operations
+    for (BeatVersionControlArchiveCommit* commit in _commits) [payload appendData:commit.ops];
+
+    // Compress as a single stream
+    uLongf compressedLength = compressBound(payload.length);
+    NSMutableData* compressed = [NSMutableData dataWithLength:compressedLength];
+    if (compress2(compressed.mutableBytes, &compressedLength, payload.bytes, payload.length, Z_BEST_COMPRESSION) != Z_OK) {
+        NSLog(@"🆘 Version control archive: compression failed");
+        return @"";
+    }
+    compressed.length = compressedLength;
+
+    NSMutableData* archive = NSMutableData.new;
+    [archive appendBytes:archiveMagic length:sizeof(archiveMagic)];
+    [archive appendBytes:&archiveVersion length:1];
+    writeVarint(archive, payload.length);
+    [archive appendData:compressed];
+
+    return [archive base64EncodedStringWithOptions:0];
+}
+
+
+#pragma mark - Decoding
+
++ (instancetype _Nullable)archiveWithEncodedString:(NSString*)string
+{
+    NSData* archive = [NSData.alloc initWithBase64EncodedString:string options:0];
+    if (archive.length < sizeof(archiveMagic) + 2 || memcmp(archive.bytes, archiveMagic, sizeof(archiveMagic)) != 0) return nil;
+
+    const uint8_t* header = archive.bytes;
+    if (header[sizeof(archiveMagic)] > archiveVersion) {
+        NSLog(@"🆘 Version control archive was created with a newer version of Beat");
+        return nil;
+    }
+
+    NSUInteger position = sizeof(archiveMagic) + 1;
+    uint64_t payloadLength;
+    if (!readVarint(header, archive.length, &position, &payloadLength)) return nil;
+
+    NSMutableData* payload = [NSMutableData dataWithLength:(NSUInteger)payloadLength];
+    uLongf length = (uLongf)payloadLength;
+    if (uncompress(payload.mutableBytes, &length, header + position, archive.length - position) != Z_OK || length != payloadLength) return nil;
+
+    BeatVersionControlArchive* result = [BeatVersionControlArchive.alloc initEmpty];
+    return [result decodePayload:payload] ? result : nil;
+}
+
+- (bool)decodePayload:(NSData*)payload
+{
+    const uint8_t* bytes = payload.bytes;
+    NSUInteger length = payload.length;
+    NSUInteger p = 0;
+    uint64_t count, value;
+
+    // String pool
+    if (!readVarint(bytes, length, &p, &count)) return false;
+    for (uint64_t i = 0; i < count; i++) {
+        if (!readVarint(bytes, length, &p, &value) || p + value > length) return false;
+
+        NSString* string = [NSString.alloc initWithBytes:bytes + p length:(NSUInteger)value encoding:NSUTF8StringEncoding];
+        if (string == nil) return false;
+
+        [_pool addObject:string];
+        _poolIndex[string] = @(i);
+        p += value;
+    }
+
+    // Base lines
+    if (!readVarint(bytes, length, &p, &count)) return false;
+    _baseLines = [NSMutableData dataWithCapacity:(NSUInteger)count * sizeof(uint32_t)];
+    for (uint64_t i = 0; i < count; i++) {
+        if (!readVarint(bytes, length, &p, &value) || value >= _pool.count) return false;
+        uint32_t index = (uint32_t)value;
+        [_baseLines appendBytes:&index length:sizeof(uint32_t)];
+    }
+
+    // Commit index
+    if (!readVarint(bytes, length, &p, &count)) return false;
+    NSMutableArray<NSValue*>* opRanges = [NSMutableArray arrayWithCapacity:(NSUInteger)count];
+
+    for (uint64_t i = 0; i < count; i++) {
+        uint64_t timestamp, message, offset, opLength;
+        if (!readVarint(bytes, length, &p, &timestamp) || !readVarint(bytes, length, &p, &message) ||
+            !readVarint(bytes, length, &p, &offset) || !readVarint(bytes, length, &p, &opLength)) return false;
+        if (timestamp >= _pool.count || message > _pool.count) return false;
+
+        BeatVersionControlArchiveCommit* commit = BeatVersionControlArchiveCommit.new;
+        commit.timestamp = (uint32_t)timestamp;
+        commit.message = (NSInteger)message - 1;
+        [_commits addObject:commit];
+        [opRanges addObject:[NSValue valueWithRange:NSMakeRange((NSUInteger)offset, (NSUInteger)opLength)]];
+    }
+
+    // Operations follow the index
+    for (NSInteger i = 0; i < _commits.count; i++) {
+        NSRange range = opRanges[i].rangeValue;
+        range.location += p;
+        if (NSMaxRange(range) > length) return false;
+
+        _commits[i].ops = [payload subdataWithRange:range];
+    }
+
+    return true;
+}
+
+@end
@@ -14,6 +14,7 @@ FOUNDATION_EXPORT const unsigned char BeatFileExportVersionString[];
 
 #import <BeatFileExport/BeatFDXExport.h>
 #import <BeatFileExport/OutlineExtractor.h>
+#import <BeatFileExport/BeatXMLStreamWriter.h>
 
 #import <BeatFileExport/BeatImportModule.h>
 #import <BeatFileExport/HighlandImport.h>
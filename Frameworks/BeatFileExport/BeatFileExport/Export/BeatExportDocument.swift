@@ -0,0 +1,166 @@
+//
+//  BeatExportDocument.swift
+//  BeatFileExport
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+/**
+
+ Shared preprocessing stage for exports. The document takes a snapshot of parsed lines with tags and revisions baked in,
+ and creates the printable screenplay (macros resolved, invisible elements filtered, scene numbers applied) on first request.
+
+ Export sinks read the document and write their format into a stream. Because the stages are cached, exporting the same draft
+ into several formats only preprocesses it once. Sinks can iterate the document directly to get printable elements, or read
+ `lines` if they need the full (but baked) line array. Neither should be mutated — clone a line before modifying it.
+
+ */
+
+import Foundation
+import BeatCore
+
+/// Writes the given document into an open stream. Return `false` if writing failed.
+public typealias BeatExportSink = (_ document:BeatExportDocument, _ stream:OutputStream) -> Bool
+
+@objc public class BeatExportDocument:NSObject, Sequence {
+    @objc public let documentSettings:BeatDocumentSettings
+    @objc public let exportSettings:BeatExportSettings
+    @objc public let styles:BeatStylesheet
+    @objc public let fileName:String
+    @objc public let paperSize:BeatPaperSize
+
+    /// Copy of the settings this document was created with, used to check if the cached document is still valid
+    private let sourceSettings:BeatExportSettings
+
+    private let titlePage:[[String:[String]]]
+    private let titlePageContent:[[String:[Line]]]
+
+    private let lock = NSRecursiveLock()
+
+    /// Baked copies of all parsed lines
+    @objc public let lines:[Line]
+
+    private var _screenplay:BeatScreenplay?
+    /// Printable screenplay. Created lazily.
+    @objc public var screenplay:BeatScreenplay {
+        lock.lock()
+        defer { lock.unlock() }
+
+        if let _screenplay { return _screenplay }
+
+        let screenplay = BeatScreenplay()
+        screenplay.titlePage = titlePage
+        screenplay.titlePageContent = titlePageContent
+        screenplay.lines = ContinuousFountainParser.preprocessForPrinting(withLines: lines, documentSettings: documentSettings, exportSettings: exportSettings, screenplay: nil)
+
+        _screenplay = screenplay
+        return screenplay
+    }
+
+    /// Printable elements
+    public func makeIterator() -> IndexingIterator<[Line]> {
+        return (screenplay.lines ?? []).makeIterator()
+    }
+
+    /// Creates an export document from an open editor. Tags and revisions are baked into the cloned lines, so the editor lines are left untouched.
+    @objc public convenience init(delegate:BeatEditorDelegate) {
+        self.init(parser: delegate.parser,
+                  exportSettings: delegate.exportSettings,
+                  styles: delegate.styles,
+                  fileName: delegate.fileNameString() ?? "")
+
+        let string = delegate.attributedString()
+        BeatTagging.bakeAllTags(in: string, to: lines)
+        BeatRevisions.bakeRevisions(into: lines, text: string)
+    }
+
+    /// Creates an export document from a parser. Use this when there is no editor, ie. for headless export.
+    @objc public init(parser:ContinuousFountainParser, exportSettings:BeatExportSettings, styles:BeatStylesheet?, fileName:String) {
+        let styles = styles ?? BeatStyles.shared.defaultStyles
+
+        // Make sure that elements visible in this style survive preprocessing. The caller's settings are left untouched.
+        let settings = exportSettings.copy() as! BeatExportSettings
+        var types = IndexSet(IndexPath(indexes: exportSettings.additionalTypes))
+        for element in styles.document._visibleElements { types.insert(Int(element.rawValue)) }
+        settings.additionalTypes = types
+
+        self.documentSettings = parser.documentSettings ?? exportSettings.documentSettings
+        self.exportSettings = settings
+        self.styles = styles
+        self.fileName = fileName
+        self.paperSize = exportSettings.paperSize
+        self.sourceSettings = exportSettings.copy() as! BeatExportSettings
+
+        let lines = parser.safeLines() as? [Line] ?? []
+        self.lines = lines.map { $0.clone() }
+
+        self.titlePage = ContinuousFountainParser.titlePage(for: parser.titlePageAsString()) as? [[String:[String]]] ?? []
+        self.titlePageContent = parser.parseTitlePage() ?? []
+
+        super.init()
+    }
+
+    /// Checks if this document was created using the same styles and settings as the editor. Text changes are tracked by the caller.
+    func matches(_ delegate:BeatEditorDelegate) -> Bool {
+        return styles === delegate.styles && BeatExportDocument.settingsMatch(sourceSettings, delegate.exportSettings)
+    }
+
+    /// Export settings are recreated on each request, so we'll compare every value which preprocessing, pagination or rendering reads
+    class func settingsMatch(_ a:BeatExportSettings, _ b:BeatExportSettings) -> Bool {
+        return a.operation == b.operation &&
+            a.header == b.header &&
+            a.headerAlignment == b.headerAlignment &&
+            a.invisibleElements == b.invisibleElements &&
+            a.printNotes == b.printNotes &&
+            a.printSceneNumbers == b.printSceneNumbers &&
+            a.hidePageNumbers == b.hidePageNumbers &&
+            a.additionalTypes == b.additionalTypes &&
+            a.revisions == b.revisions &&
+            a.paperSize == b.paperSize &&
+            a.simpleSceneHeadings == b.simpleSceneHeadings &&
+            a.printSceneHeadingColors == b.printSceneHeadingColors &&
+            a.customCSS == b.customCSS &&
+            a.customStyles == b.customStyles &&
+            a.firstPageNumber == b.firstPageNumber &&
+            a.revisionHighlightMode == b.revisionHighlightMode &&
+            (a.styles as AnyObject?) === (b.styles as AnyObject?) &&
+            a.documentSettings === b.documentSettings
+    }
+
+    /// Writes the document into a file using given sink
+    @objc public func write(to url:URL, sink:@escaping BeatExportSink) -> Bool {
+        guard let stream = OutputStream(url: url, append: false) else { return false }
+        stream.open()
+        defer { stream.close() }
+
+        return sink(self, stream)
+    }
+
+    /// Returns the output of given sink as data
+    public func data(sink:BeatExportSink) -> Data? {
+        let stream = OutputStream.toMemory()
+        stream.open()
+        defer { stream.close() }
+
+        guard sink(self, stream) else { return nil }
+        return stream.property(forKey: .dataWrittenToMemoryStreamKey) as? Data
+    }
+}
+
+extension OutputStream {
+    /// Writes all of the given data, returns `false` if the stream failed
+    @objc(writeData:) public func write(_ data:Data) -> Bool {
+        guard data.count > 0 else { return true }
+
+        return data.withUnsafeBytes { (buffer:UnsafeRawBufferPointer) -> Bool in
+            guard let base = buffer.bindMemory(to: UInt8.self).baseAddress else { return false }
+
+            var written = 0
+            while written < data.count {
+                let result = self.write(base + written, maxLength: data.count - written)
+                if result <= 0 { return false }
+                written += result
+            }
+            return true
+        }
+    }
+}
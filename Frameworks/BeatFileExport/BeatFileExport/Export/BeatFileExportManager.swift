@@ -17,6 +17,40 @@ struct BeatFileExportHandlerInfo {
 	var fileTypes:[String]
 	var supportedStyles:[String]
 	var handler:((_ delegate:BeatEditorDelegate) -> Any?)
+	/// Modules which consume the shared export document write straight into a stream
+	var sink:BeatExportSink?
+}
+
+fileprivate var exportCacheKey = 0
+
+/// Preprocessed document for a single editor. The cache lives as long as the text storage it observes, so it's released with the document.
+fileprivate class BeatExportDocumentCache:NSObject {
+	/// Incremented on every edit in the text storage, including attribute-only changes such as revisions and tags
+	var changeCount = 0
+	var document:BeatExportDocument?
+	var documentChangeCount = 0
+	
+	init(textStorage:NSTextStorage) {
+		super.init()
+		NotificationCenter.default.addObserver(self, selector: #selector(textStorageDidProcessEditing), name: NSTextStorage.didProcessEditingNotification, object: textStorage)
+	}
+	
+	deinit {
+		NotificationCenter.default.removeObserver(self)
+	}
+	
+	@objc func textStorageDidProcessEditing(_ notification:Notification) {
+		changeCount += 1
+	}
+	
+	/// Returns the cache for given text storage, creating it if needed
+	class func cache(for textStorage:NSTextStorage) -> BeatExportDocumentCache {
+		if let cache = objc_getAssociatedObject(textStorage, &exportCacheKey) as? BeatExportDocumentCache { return cache }
+		
+		let cache = BeatExportDocumentCache(textStorage: textStorage)
+		objc_setAssociatedObject(textStorage, &exportCacheKey, cache, .OBJC_ASSOCIATION_RETAIN_NONATOMIC)
+		return cache
+	}
 }
 
 @objc public class BeatFileExportManager:NSObject {
@@ -42,6 +76,51 @@ struct BeatFileExportHandlerInfo {
 		registeredHandlers.append(handler)
 	}
 	
+	/// Registers an export sink. Sinks receive the shared, preprocessed document and write their output into a stream.
+	@objc public func registerSink(for format:String, fileTypes:[String], supportedStyles:[String], sink:@escaping BeatExportSink) {
+		var info = BeatFileExportHandlerInfo(format: format, fileTypes: fileTypes, supportedStyles: supportedStyles, handler: { [unowned self] delegate in
+			return self.document(for: delegate).data(sink: sink)
+		})
+		info.sink = sink
+		registeredHandlers.append(info)
+	}
+	
+	/// Returns a preprocessed export document for the editor. Exporting the same draft into multiple formats reuses the previous document as long as the text and settings stay the same.
+	@objc public func document(for delegate:BeatEditorDelegate) -> BeatExportDocument {
+		let cache = BeatExportDocumentCache.cache(for: delegate.textStorage())
+		
+		if let document = cache.document, cache.documentChangeCount == cache.changeCount, document.matches(delegate) {
+			return document
+		}
+		
+		let document = BeatExportDocument(delegate: delegate)
+		cache.document = document
+		cache.documentChangeCount = cache.changeCount
+		return document
+	}
+	
+	/// Exports the document into all given formats in one job. Preprocessing is only done once.
+	/// - returns Dictionary of `format: URL` for successfully written files
+	@objc public func export(document:BeatExportDocument, formats:[String], directory:URL, fileName:String) -> [String:URL] {
+		var results:[String:URL] = [:]
+		
+		for format in formats {
+			guard let exporter = handlerForFormat(format), let sink = exporter.sink else {
+				print("No export sink for format:", format)
+				continue
+			}
+			
+			let url = directory.appendingPathComponent(fileName).appendingPathExtension(exporter.fileTypes.first ?? "")
+			if document.write(to: url, sink: sink) {
+				results[format] = url
+			} else {
+				print("Could not export", format, "to", url)
+			}
+		}
+		
+		return results
+	}
+	
 	/// Returns the export handler for given format type
 	func handlerForFormat(_ format:String) -> BeatFileExportHandlerInfo? {
 		for handler in registeredHandlers {
@@ -82,15 +161,20 @@ struct BeatFileExportHandlerInfo {
 				  let url = savePanel.url
 			else { return }
 			
-			if let data = exporter.handler(delegate) {
+			if let sink = exporter.sink {
+				if self.document(for: delegate).write(to: url, sink: sink) { resultURL = url }
+			} else if let data = exporter.handler(delegate) {
 				resultURL = self.handleData(data, url: url)
 			}
 		}
         
         return resultURL
 #else
-        if let data = exporter.handler(delegate) {
-            let url = BeatPaths.urlForTemporaryFile(name: delegate.fileNameString(), pathExtension: exporter.fileTypes.first ?? "")
+        let url = BeatPaths.urlForTemporaryFile(name: delegate.fileNameString(), pathExtension: exporter.fileTypes.first ?? "")
+        
+        if let sink = exporter.sink {
+            return self.document(for: delegate).write(to: url, sink: sink) ? url : nil
+        } else if let data = exporter.handler(delegate) {
             return self.handleData(data, url: url)
         }
         
@@ -102,7 +186,7 @@ struct BeatFileExportHandlerInfo {
 	func handleData(_ value:Any, url:URL) -> URL? {
 		if let data = value as? NSData {
 			// This is data
-			data.write(to: url, atomically: true)
+			if data.write(to: url, atomically: true) { return url }
 		} else if let string = value as? String {
 			// String
 			do {
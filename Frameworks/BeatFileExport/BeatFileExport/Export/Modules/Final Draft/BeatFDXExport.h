@@ -18,7 +18,15 @@ NS_ASSUME_NONNULL_BEGIN
 + (NSString*)tagNameForFDXCategoryId:(NSString*)categoryId;
 
 - (instancetype)initWithString:(NSString*)string attributedString:(NSAttributedString*)attrString includeTags:(bool)includeTags includeRevisions:(bool)includeRevisions paperSize:(BeatPaperSize)paperSize;
+/// Creates an export from already parsed lines, ie. from `BeatExportDocument`. Tags and revisions have to be baked beforehand. The lines are not modified.
+- (instancetype)initWithLines:(NSArray<Line*>*)lines paperSize:(BeatPaperSize)paperSize;
 - (NSString*)fdxString;
+/// UTF-8 encoded FDX document
+- (NSData*)fdxData;
+/// Streams the document directly to a file without building it in memory
+- (bool)writeToURL:(NSURL*)url;
+/// Writes the document to an open stream. Returns `false` if writing failed.
+- (bool)writeToStream:(NSOutputStream*)stream;
 @end
 
 NS_ASSUME_NONNULL_END
@@ -86,6 +86,7 @@
 #import <BeatParsing/BeatParsing.h>
 #import <BeatCore/BeatCore.h>
 #import "BeatFDXExport.h"
+#import "BeatXMLStreamWriter.h"
 #import <BeatFileExport/BeatFileExport-Swift.h>
 
 #define format(s, ...) [NSString stringWithFormat:s, ##__VA_ARGS__]
@@ -99,20 +100,30 @@
 #define BOLD_PATTERN_LENGTH 2
 #define ITALIC_UNDERLINE_PATTERN_LENGTH 1
 
+/// Checks for Devanagari block without creating substrings or regexes
+static bool containsDevanagari(NSString* string, NSRange range)
+{
+    if (string == nil || range.length == 0) return false;
+    
+    CFStringInlineBuffer buffer;
+    CFStringInitInlineBuffer((CFStringRef)string, &buffer, CFRangeMake(range.location, range.length));
+    
+    for (CFIndex i = 0; i < range.length; i++) {
+        UniChar c = CFStringGetCharacterFromInlineBuffer(&buffer, i);
+        if (c >= 0x0900 && c <= 0x097F) return true;
+    }
+    
+    return false;
+}
+
 @interface BeatFDXExport ()
-@property (nonatomic) ContinuousFountainParser *parser;
-@property (nonatomic) NSString *result;
+/// Source lines with tags and revisions baked in. These can be shared with other exports, so don't modify them.
+@property (nonatomic) NSArray<Line*>* lines;
 @property (nonatomic) NSArray *preprocessedLines;
 
-@property (nonatomic) NSMutableDictionary *tagData;
-
-@property (nonatomic) NSMutableArray *tagDefinitions;
-@property (nonatomic) NSMutableArray *tagItems;
-
-@property (nonatomic) NSMutableString *tagDefinitionsStr;
-@property (nonatomic) NSMutableString *tagIds;
-@property (nonatomic) NSMutableString *tagsStr;
-@property (nonatomic) NSInteger tagNumber;
+@property (nonatomic) NSMutableArray<BeatTag*> *tagItems;
+/// Maps tag objects (by identity) to their FDX tag numbers
+@property (nonatomic) NSMutableDictionary<NSValue*, NSNumber*> *tagNumbers;
 
 @property (nonatomic) bool inDualDialogue;
 @property (nonatomic) NSInteger dualDialogueCueCount;
@@ -123,6 +134,9 @@
 
 @property (nonatomic) NSMutableDictionary<NSValue*, BeatNoteData*>* notes;
 
+@property (nonatomic) BeatXMLStreamWriter* writer;
+@property (nonatomic) NSData* data;
+
 @end
 
 @implementation BeatFDXExport
@@ -130,10 +144,9 @@
 + (void)register:(BeatFileExportManager*)manager
 {
 	// Register as export handler
-	[manager registerHandlerFor:@"FDX" fileTypes:@[@"fdx"] supportedStyles:@[@"Screenplay"] handler:^id _Nullable(id<BeatEditorDelegate> _Nonnull delegate) {
-
-		BeatFDXExport* export = [BeatFDXExport.alloc initWithString:delegate.text attributedString:delegate.attributedString includeTags:true includeRevisions:true paperSize:delegate.pageSize];
-		return export.fdxString;
+	[manager registerSinkFor:@"FDX" fileTypes:@[@"fdx"] supportedStyles:@[@"Screenplay"] sink:^BOOL(BeatExportDocument * _Nonnull document, NSOutputStream * _Nonnull stream) {
+		BeatFDXExport* export = [BeatFDXExport.alloc initWithLines:document.lines paperSize:document.paperSize];
+		return [export writeToStream:stream];
 	}];
 }
 
@@ -185,27 +198,29 @@
 
 - (instancetype)initWithString:(NSString*)string attributedString:(NSAttributedString*)attrString includeTags:(bool)includeTags includeRevisions:(bool)includeRevisions paperSize:(BeatPaperSize)paperSize
 {
-	self = [super init];
-		
-	self.parser = [[ContinuousFountainParser alloc] initWithString:string];
+	ContinuousFountainParser* parser = [[ContinuousFountainParser alloc] initWithString:string];
 	
 	if (attrString) {
 		// Bake tags and revisions
-		[BeatTagging bakeAllTagsInString:attrString toLines:self.parser.lines];
-        [BeatRevisions bakeRevisionsIntoLines:self.parser.lines text:attrString];
+		[BeatTagging bakeAllTagsInString:attrString toLines:parser.lines];
+        [BeatRevisions bakeRevisionsIntoLines:parser.lines text:attrString];
 	}
 	
+	return [self initWithLines:parser.lines paperSize:paperSize];
+}
+
+- (instancetype)initWithLines:(NSArray<Line*>*)lines paperSize:(BeatPaperSize)paperSize
+{
+	self = [super init];
+	
+	self.lines = lines;
 	self.paperSize = paperSize;
 	
-	self.tagData = NSMutableDictionary.new;
-
 	self.tagItems = NSMutableArray.new;
-	self.tagDefinitions = NSMutableArray.new;
-	
-	self.tagDefinitionsStr = NSMutableString.new;
-	self.tagsStr = NSMutableString.new;
+	self.tagNumbers = NSMutableDictionary.new;
 	
-	[self createFDX];
+	// Preprocessing joins lines, so it can only be done once
+	self.preprocessedLines = [self preprocessLines];
 	
 	return self;
 }
@@ -263,46 +278,111 @@
 
 - (NSString*)fdxString
 {
-	return self.result;
+	NSData* data = self.fdxData;
+	return (data != nil) ? [NSString.alloc initWithData:data encoding:NSUTF8StringEncoding] : @"";
 }
 
-- (NSString*)createFDX
+- (NSData*)fdxData
 {
-	return [self createFDXwithRevisions:YES tags:YES];
+	if (_data == nil) {
+		NSOutputStream* stream = [NSOutputStream outputStreamToMemory];
+		[stream open];
+		if ([self writeToStream:stream]) _data = [stream propertyForKey:NSStreamDataWrittenToMemoryStreamKey];
+		[stream close];
+	}
+	
+	return _data;
 }
 
-- (NSString*)createFDXwithRevisions:(bool)includeRevisions tags:(bool)includeTags
+- (bool)writeToURL:(NSURL*)url
 {
-	if (self.parser.lines.count == 0) return @"";
-    
-    NSURL *url = [[NSBundle bundleForClass:self.class] URLForResource:@"Final Draft Template" withExtension:@"xml"];
-    NSString* template = [NSString stringWithContentsOfURL:url encoding:NSUTF8StringEncoding error:nil];
-    
-    _preprocessedLines = [self preprocessLines];
+	NSOutputStream* stream = [NSOutputStream outputStreamWithURL:url append:false];
+	[stream open];
+	bool success = [self writeToStream:stream];
+	[stream close];
+	
+	return success;
+}
+
+
+#pragma mark - Writing the document
+
+/// The template is split at `%%PLACEHOLDER%%` markers. Even items are literal XML, odd items are placeholder names.
++ (NSArray<NSString*>*)templateParts
+{
+	static NSArray<NSString*>* parts;
+	static dispatch_once_t onceToken;
+	dispatch_once(&onceToken, ^{
+		NSURL *url = [[NSBundle bundleForClass:self] URLForResource:@"Final Draft Template" withExtension:@"xml"];
+		NSString* template = [NSString stringWithContentsOfURL:url encoding:NSUTF8StringEncoding error:nil];
+		parts = (template != nil) ? [template componentsSeparatedByString:@"%%"] : @[];
+	});
+	
+	return parts;
+}
+
+- (bool)writeToStream:(NSOutputStream*)stream
+{
+	if (self.lines.count == 0) return true;
+	
+	// Reset state from any previous run
+	[_tagItems removeAllObjects];
+	[_tagNumbers removeAllObjects];
+	_notes = nil;
+	_characterIndex = 0;
 	_inDualDialogue = NO;
-	    
-    NSString* titlePage = self.titlePage;
-    CGSize pageSize = self.FDXPageSize;
+	
+	_writer = [BeatXMLStreamWriter.alloc initWithOutputStream:stream];
+	
+	// Tags and notes are collected while writing content, so content has to come first in the template
+	NSArray<NSString*>* parts = BeatFDXExport.templateParts;
+	for (NSInteger i = 0; i < parts.count; i++) {
+		if (i % 2 == 0) [_writer write:parts[i]];
+		else [self writePlaceholder:parts[i]];
+	}
+	
+	bool success = [_writer flush];
+	_writer = nil;
+	
+	return success;
+}
 
-    NSMutableString* content = NSMutableString.new;
-	for (int i = 0; i < _preprocessedLines.count; i++) {
-		[content appendString:[self lineToFDXAtIndex:i]];
+- (void)writePlaceholder:(NSString*)placeholder
+{
+	if ([placeholder isEqualToString:@"CONTENT"]) {
+		for (NSInteger i = 0; i < _preprocessedLines.count; i++) {
+			[self writeLineAtIndex:i];
+		}
 	}
-		    
-    // Notes
-    NSMutableString* scriptNotes = NSMutableString.new;
+	else if ([placeholder isEqualToString:@"TITLE_PAGE"]) [self writeTitlePage];
+	else if ([placeholder isEqualToString:@"REVISIONS"]) [self writeRevisions];
+	else if ([placeholder isEqualToString:@"TAG_CATEGORIES"]) [_writer write:self.createCategories];
+	else if ([placeholder isEqualToString:@"TAG_DEFINITIONS"]) [self writeTagDefinitions];
+	else if ([placeholder isEqualToString:@"TAGS"]) [self writeTags];
+	else if ([placeholder isEqualToString:@"SCRIPT_NOTES"]) [self writeScriptNotes];
+	else if ([placeholder isEqualToString:@"PAGE_WIDTH"]) [_writer writeFloat:self.FDXPageSize.width];
+	else if ([placeholder isEqualToString:@"PAGE_HEIGHT"]) [_writer writeFloat:self.FDXPageSize.height];
+	else NSLog(@"🆘 Unknown FDX template placeholder: %@", placeholder);
+}
+
+- (void)writeScriptNotes
+{
     for (NSValue* r in self.notes.allKeys) {
         BeatNoteData* note = self.notes[r];
         NSRange range = r.rangeValue;
         NSString* color = [BeatColors colorWith16bitHex:@"yellow"];
         if (note.color.length > 0) color = [BeatColors colorWith16bitHex:note.color];
         
-        [scriptNotes appendFormat:@"    <ScriptNote Range='%lu,%lu' Color='#%@'>\n", range.location, range.length + range.location, color];
-        [scriptNotes appendFormat:@"      <Paragraph>%@</Paragraph>\n", [self textBlockFor:note.content]];
-        [scriptNotes appendFormat:@"    </ScriptNote>\n"];
+        [_writer write:format(@"    <ScriptNote Range='%lu,%lu' Color='#%@'>\n", range.location, range.length + range.location, color)];
+        [_writer write:@"      <Paragraph>"];
+        [self writeTextBlock:note.content];
+        [_writer write:@"</Paragraph>\n"];
+        [_writer write:@"    </ScriptNote>\n"];
     }
-    
-    NSMutableString* revisions = NSMutableString.new;
+}
+
+- (void)writeRevisions
+{
     for (NSInteger i=0; i<BeatRevisions.revisionGenerations.count; i++) {
         BeatRevisionGeneration* gen = BeatRevisions.revisionGenerations[i];
         NSString* revName = [NSString stringWithFormat:@"revision.%lu", i];
@@ -312,21 +392,8 @@
                                     gen.marker,
                                     NSLocalizedString(revName, "Revision name")
                              );
-        [revisions appendString:revision];
+        [_writer write:revision];
     }
-    
-    template = [template stringByReplacingOccurrencesOfString:@"%%CONTENT%%" withString:content];
-    template = [template stringByReplacingOccurrencesOfString:@"%%TITLE_PAGE%%" withString:titlePage];
-    template = [template stringByReplacingOccurrencesOfString:@"%%TAG_CATEGORIES%%" withString:self.createCategories];
-    template = [template stringByReplacingOccurrencesOfString:@"%%TAG_DEFINITIONS%%" withString:self.tagDefinitionsStr];
-    template = [template stringByReplacingOccurrencesOfString:@"%%TAGS%%" withString:self.tagsStr];
-    template = [template stringByReplacingOccurrencesOfString:@"%%SCRIPT_NOTES%%" withString:scriptNotes];
-    template = [template stringByReplacingOccurrencesOfString:@"%%PAGE_WIDTH%%" withString:[NSString stringWithFormat:@"%f", pageSize.width]];
-    template = [template stringByReplacingOccurrencesOfString:@"%%PAGE_HEIGHT%%" withString:[NSString stringWithFormat:@"%f", pageSize.height]];
-    template = [template stringByReplacingOccurrencesOfString:@"%%REVISIONS%%" withString:revisions];
-    
-    _result = template;
-	return _result;
 }
 
 - (CGSize)FDXPageSize
@@ -340,7 +407,10 @@
     NSMutableArray<Line*>* lines = NSMutableArray.new;
 	
 	Line *previousLine;
-	for (Line* line in self.parser.lines) {
+	for (Line* sourceLine in self.lines) {
+		// Lines are joined and modified, so we need our own copies
+		Line* line = sourceLine.clone;
+		
 		// Fix a weird bug
 		if (line.type == empty && line.string.length > 0 && !line.string.containsOnlyWhitespace) line.type = action;
 		        
@@ -379,35 +449,25 @@
 	return  lines;
 }
 
-- (NSString*)lineToFDXAtIndex:(NSUInteger)index
+- (void)writeLineAtIndex:(NSUInteger)index
 {
-    NSMutableString* result = NSMutableString.new;
 	NSArray *lines = self.preprocessedLines;
 	Line* line = lines[index];
 		
 	NSString* paragraphType = [self typeAsFDXString:line.type];
-    if (paragraphType.length == 0) return @""; // Ignore this line if no FDX type is available
+    if (paragraphType.length == 0) return; // Ignore this line if no FDX type is available
     
-	// Add section depth for outline elements
-	if (line.type == section) {
-		paragraphType = format(@"%@ %lu", paragraphType, line.sectionDepth);
-	}
-	
     // Adjust current character index in FDX.
     NSString *attrStr = line.stripFormatting;
     self.characterIndex += attrStr.length;
 
     // Note content
     [self collectScriptNotesOn:line];
-    
-	NSMutableArray<NSString*>* additionalTags = NSMutableArray.new;
-	NSMutableArray<NSString*>* paragraphStyles = NSMutableArray.new;
-	[paragraphStyles addObject:[NSString stringWithFormat:@"Type=\"%@\"", paragraphType]];
 	
 	// Create dual dialogue block.
 	if (line.type == character && line.nextElementIsDualDialogue && !_inDualDialogue) {
-		[result appendString:@"    <Paragraph>\n"];
-		[result appendString:@"      <DualDialogue>\n"];
+		[_writer write:@"    <Paragraph>\n"];
+		[_writer write:@"      <DualDialogue>\n"];
 		
 		_inDualDialogue = YES;
 		_dualDialogueCueCount = 1;
@@ -418,39 +478,46 @@
 	else if (_inDualDialogue && line.type == character) {
 		_inDualDialogue = NO;
 		_dualDialogueCueCount = 0;
-		[result appendString:@"      </DualDialogue>\n"];
-		[result appendString:@"    </Paragraph>\n"];
+		[_writer write:@"      </DualDialogue>\n"];
+		[_writer write:@"    </Paragraph>\n"];
 	}
 	
+	[_writer write:@"    <Paragraph Type=\""];
+	[_writer write:paragraphType];
+	// Add section depth for outline elements
+	if (line.type == section) {
+		[_writer write:@" "];
+		[_writer writeInteger:line.sectionDepth];
+	}
+	[_writer write:@"\""];
+	
+	NSString* sceneProperties;
+	
 	// Handle scene headings
 	if (line.type == heading) {
-		[paragraphStyles addObject:[NSString stringWithFormat:@"Number=\"%@\"", line.sceneNumber]];
+		[_writer write:@" Number=\""];
+		[_writer writeEscaped:line.sceneNumber];
+		[_writer write:@"\""];
 		
 		if (line.color) {
 			NSString* color = [BeatColors colorWith16bitHex:line.color];
 			if (color != nil) {
-				NSString* sceneProperties = format(@"      <SceneProperties Color=\"#%@\" Title=\"\">\n        <SceneArcBeats />\n      </SceneProperties>\n", color);
-				[additionalTags addObject:sceneProperties];
+				sceneProperties = format(@"      <SceneProperties Color=\"#%@\" Title=\"\">\n        <SceneArcBeats />\n      </SceneProperties>\n", color);
 			}
 		}
 	}
     // Handle any other types
     else if (line.type == centered) {
-        [paragraphStyles addObject: @"Alignment=\"Centered\""];
+        [_writer write:@" Alignment=\"Centered\""];
     }
-		
+	
+	[_writer write:@">\n"];
+	if (sceneProperties != nil) [_writer write:sceneProperties];
+	
     // Actual XML content
-    NSString *string = [self lineToXML:line];
-    
-    // Add full paragraph
-	[result appendFormat:@"    <Paragraph %@>\n\
-            %@\
-            %@\
-        </Paragraph>\n",
-        [paragraphStyles componentsJoinedByString:@" "],
-        [additionalTags componentsJoinedByString:@""],
-        (string.length > 0) ? string : @""
-    ];
+	[_writer write:@"      "];
+	[self writeContentOfLine:line];
+	[_writer write:@"\n    </Paragraph>\n"];
 		
 	// If a double dialogue is currently in action, check wether it needs to be closed after this
 	// This is a duct-tape fix, this has to be cleaned up ASAP.
@@ -460,21 +527,10 @@
         // If the following line doesn't have anything to do with dialogue or is nil (we're at the end of document), end double dialogue
 		if ((nextLine.type != empty && !nextLine.isAnySortOfDialogue && nextLine.length > 0) || nextLine == nil) {
             _inDualDialogue = NO;
-            [result appendString:@"      </DualDialogue>\n"];
-            [result appendString:@"    </Paragraph>\n"];
+            [_writer write:@"      </DualDialogue>\n"];
+            [_writer write:@"    </Paragraph>\n"];
         }
 	}
-	
-    return result;
-}
-
-- (void)escapeString:(NSMutableString*)string
-{
-	[string replaceOccurrencesOfString:@"&"  withString:@"&amp;"  options:NSLiteralSearch range:NSMakeRange(0, string.length)];
-	[string replaceOccurrencesOfString:@"\"" withString:@"&quot;" options:NSLiteralSearch range:NSMakeRange(0, string.length)];
-	[string replaceOccurrencesOfString:@"'"  withString:@"&#x27;" options:NSLiteralSearch range:NSMakeRange(0, string.length)];
-	[string replaceOccurrencesOfString:@">"  withString:@"&gt;"   options:NSLiteralSearch range:NSMakeRange(0, string.length)];
-	[string replaceOccurrencesOfString:@"<"  withString:@"&lt;"   options:NSLiteralSearch range:NSMakeRange(0, string.length)];
 }
 
 - (NSString*)typeAsFDXString:(LineType)type
@@ -535,16 +591,15 @@
 	}
 }
 
-- (NSString*)titlePage
+- (void)writeTitlePage
 {
 	/*
 	 TODO: Rewrite this to support the new static Title Page parsing.
 	 */
 	
-    NSMutableString* result = NSMutableString.new;
 	bool hasTitlePage = NO;
 	
-	Line* firstLine = _parser.lines[0];
+	Line* firstLine = _lines.firstObject;
 	if (firstLine.type == titlePageTitle ||
 		firstLine.type == titlePageAuthor ||
 		firstLine.type == titlePageCredit ||
@@ -554,93 +609,82 @@
 		hasTitlePage = YES;
 	}
 	
-	if (!hasTitlePage) return @"";
-	
-	NSMutableString* title = [[self stringByRemovingKey:@"title:" fromString:[self firstStringForLineType:titlePageTitle]] mutableCopy];
-	NSMutableString* credit = [[self stringByRemovingKey:@"credit:" fromString:[self firstStringForLineType:titlePageCredit]] mutableCopy];
-	NSMutableString* author = [[self stringByRemovingKey:@"author:" fromString:[self firstStringForLineType:titlePageAuthor]] mutableCopy];
-	NSMutableString* source = [[self stringByRemovingKey:@"source:" fromString:[self firstStringForLineType:titlePageSource]] mutableCopy];
-	NSMutableString* draftDate = [[self stringByRemovingKey:@"draft date:" fromString:[self firstStringForLineType:titlePageDraftDate]] mutableCopy];
-	NSMutableString* contact = [[self stringByRemovingKey:@"contact:" fromString:[self firstStringForLineType:titlePageContact]] mutableCopy];
+	if (!hasTitlePage) return;
 	
-	[self escapeString:title];
-	[self escapeString:credit];
-	[self escapeString:author];
-	[self escapeString:source];
-	[self escapeString:draftDate];
-	[self escapeString:contact];
+	NSString* title = [self stringByRemovingKey:@"title:" fromString:[self firstStringForLineType:titlePageTitle]];
+	NSString* credit = [self stringByRemovingKey:@"credit:" fromString:[self firstStringForLineType:titlePageCredit]];
+	NSString* author = [self stringByRemovingKey:@"author:" fromString:[self firstStringForLineType:titlePageAuthor]];
+	NSString* source = [self stringByRemovingKey:@"source:" fromString:[self firstStringForLineType:titlePageSource]];
+	NSString* draftDate = [self stringByRemovingKey:@"draft date:" fromString:[self firstStringForLineType:titlePageDraftDate]];
+	NSString* contact = [self stringByRemovingKey:@"contact:" fromString:[self firstStringForLineType:titlePageContact]];
 	
-	[result appendString:@"  <TitlePage>\n"];
-	[result appendString:@"    <Content>\n"];
+	[_writer write:@"  <TitlePage>\n"];
+	[_writer write:@"    <Content>\n"];
 	
 	NSUInteger lineCount = 0;
 	
 	for (int i = 0; i < LINES_BEFORE_CENTER; i++) {
-		[result appendString:[self titlePageLineWithString:@"" center:NO]];
+		[self writeTitlePageLine:@"" center:NO];
 		lineCount++;
 	}
 	
 	if (title) {
-        [result appendString:[self titlePageLineWithString:title center:YES]];
+		[self writeTitlePageLine:title center:YES];
 		lineCount++;
 	}
 	
 	if (credit) {
 		for (int i = 0; i < LINES_BEFORE_CREDIT; i++) {
-            [result appendString:[self titlePageLineWithString:@"" center:YES]];
+			[self writeTitlePageLine:@"" center:YES];
 			lineCount++;
 		}
-        [result appendString:[self titlePageLineWithString:credit center:YES]];
+		[self writeTitlePageLine:credit center:YES];
 	}
 	
 	if (author) {
 		for (int i = 0; i < LINES_BEFORE_AUTHOR; i++) {
-            [result appendString:[self titlePageLineWithString:@"" center:YES]];
+			[self writeTitlePageLine:@"" center:YES];
 			lineCount++;
 		}
-        [result appendString:[self titlePageLineWithString:author center:YES]];
+		[self writeTitlePageLine:author center:YES];
 	}
 	
 	if (source) {
 		for (int i = 0; i < LINES_BEFORE_SOURCE; i++) {
-            [result appendString:[self titlePageLineWithString:@"" center:YES]];
+			[self writeTitlePageLine:@"" center:YES];
 			lineCount++;
 		}
-        [result appendString:[self titlePageLineWithString:source center:YES]];
+		[self writeTitlePageLine:source center:YES];
 	}
 	
 	while (lineCount < LINES_PER_PAGE - 2) {
-        [result appendString:[self titlePageLineWithString:@"" center:NO]];
+		[self writeTitlePageLine:@"" center:NO];
 		lineCount++;
 	}
 	
 	if (draftDate) {
-        [result appendString:[self titlePageLineWithString:draftDate center:NO]];
+		[self writeTitlePageLine:draftDate center:NO];
 	}
 	
 	if (contact) {
-        [result appendString:[self titlePageLineWithString:contact center:NO]];
+		[self writeTitlePageLine:contact center:NO];
 	}
 	
-	[result appendString:@"    </Content>\n"];
-	[result appendString:@"  </TitlePage>\n"];
-    
-    return result;
+	[_writer write:@"    </Content>\n"];
+	[_writer write:@"  </TitlePage>\n"];
 }
 
-- (NSString*)titlePageLineWithString:(NSString*)string center:(bool)center
+- (void)writeTitlePageLine:(NSString*)string center:(bool)center
 {
-    return [NSString stringWithFormat:@"      <Paragraph%@>\n"
-                                       "         %@\n"
-                                       "      </Paragraph>\n",
-            (center) ? @" Alignment=\"Center\"" : @"",
-            [self textBlockFor:string]
-    ];
+	[_writer write:(center) ? @"      <Paragraph Alignment=\"Center\">\n" : @"      <Paragraph>\n"];
+	[_writer write:@"         "];
+	[self writeTextBlock:string];
+	[_writer write:@"\n      </Paragraph>\n"];
 }
 
 - (NSString*)firstStringForLineType:(LineType)type
 {
-	for (Line* line in _parser.lines) {
+	for (Line* line in _lines) {
 		if (line.type == type) {
 			return line.string;
 		}
@@ -661,113 +705,145 @@
 	return string;
 }
 
-- (NSString*)lineToXML:(Line*)line
+/// Writes the content of a line as `<Text>` blocks. Adjacent content ranges with identical attributes are written as a single block.
+- (void)writeContentOfLine:(Line*)line
 {
 	NSAttributedString *string = line.attributedStringForFDX;
-	NSMutableAttributedString *result = NSMutableAttributedString.new;
-	[line.contentRanges enumerateRangesUsingBlock:^(NSRange range, BOOL * _Nonnull stop) {
-		[result appendAttributedString:[string attributedSubstringFromRange:range]];
-	}];
+	NSString* text = string.string;
 	
-	NSMutableString *xmlString = [NSMutableString string];
-	__block NSString* styleString = @"";
+	__block NSDictionary* runAttributes;
+	NSMutableArray<NSValue*>* runRanges = NSMutableArray.new;
 	
-	[result enumerateAttributesInRange:(NSRange){0, result.length} options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
-		NSMutableString* text = [[result.string substringWithRange:range] mutableCopy];
-		
-		// Get stylization in the current attribute range
-		NSMutableSet* styles = attrs[@"Style"];
-		NSString* additionalStyles = @"";
-		
-		// Add revisions
-		NSNumber* revisionValue = attrs[BeatRevisions.attributeKey];
-		if (revisionValue != nil) {
-			// Get color for revision.
-			NSInteger level = revisionValue.integerValue;
-			BeatRevisionGeneration* generation = BeatRevisions.revisionGenerations[level];
+	[line.contentRanges enumerateRangesUsingBlock:^(NSRange contentRange, BOOL * _Nonnull stop) {
+		[string enumerateAttributesInRange:contentRange options:0 usingBlock:^(NSDictionary<NSAttributedStringKey,id> * _Nonnull attrs, NSRange range, BOOL * _Nonnull stop) {
+			if (runAttributes != nil && ![runAttributes isEqualToDictionary:attrs]) {
+				[self writeTextRun:runRanges inString:text attributes:runAttributes line:line];
+				[runRanges removeAllObjects];
+			}
 			
-			NSString *highlightColor = [BeatColors colorWith16bitHex:generation.color];
-			NSInteger revisionNumber = generation.level + 1; // + 1 as arrays begin from 0
-			additionalStyles = [additionalStyles stringByAppendingFormat:@" Color=\"#%@\" RevisionID=\"%lu\"", highlightColor.uppercaseString, revisionNumber];
-		}
+			runAttributes = attrs;
+			[runRanges addObject:[NSValue valueWithRange:range]];
+		}];
+	}];
+	
+	if (runRanges.count > 0) [self writeTextRun:runRanges inString:text attributes:runAttributes line:line];
+}
+
+- (void)writeTextRun:(NSArray<NSValue*>*)ranges inString:(NSString*)text attributes:(NSDictionary*)attrs line:(Line*)line
+{
+	// Get stylization in the current attribute range. The set is copied, because the original belongs to the line.
+	NSMutableSet* styles = [attrs[@"Style"] mutableCopy];
+	NSMutableString* additionalStyles = NSMutableString.new;
+	
+	// Add revisions
+	NSNumber* revisionValue = attrs[BeatRevisions.attributeKey];
+	if (revisionValue != nil) {
+		// Get color for revision.
+		NSInteger level = revisionValue.integerValue;
+		BeatRevisionGeneration* generation = BeatRevisions.revisionGenerations[level];
 		
-		if (styles.count > 0) {
-			// Highlighting, Addition and Removal do not conform to FDX styles
-			if ([styles containsObject:@"Highlight"]) {
-				[styles removeObject:@"Highlight"];
-				NSString *highlightColor = [BeatColors colorWith16bitHex:@"blue"];
-				additionalStyles = [additionalStyles stringByAppendingFormat:@" Color=\"#%@\"", highlightColor.uppercaseString];
-			}
-			if ([styles containsObject:@"RemovalSuggestion"]) {
-				[styles removeObject:@"RemovalSuggestion"];
-				[styles addObject:@"Strikeout"];
-				NSString *highlightColor = [BeatColors colorWith16bitHex:@"fdxRemoval"];
-				additionalStyles = [additionalStyles stringByAppendingFormat:@" Background=\"#%@\"", highlightColor.uppercaseString];
-			}
+		NSString *highlightColor = [BeatColors colorWith16bitHex:generation.color];
+		NSInteger revisionNumber = generation.level + 1; // + 1 as arrays begin from 0
+		[additionalStyles appendFormat:@" Color=\"#%@\" RevisionID=\"%lu\"", highlightColor.uppercaseString, revisionNumber];
+	}
+	
+	if (styles.count > 0) {
+		// Highlighting, Addition and Removal do not conform to FDX styles
+		if ([styles containsObject:@"Highlight"]) {
+			[styles removeObject:@"Highlight"];
+			NSString *highlightColor = [BeatColors colorWith16bitHex:@"blue"];
+			[additionalStyles appendFormat:@" Color=\"#%@\"", highlightColor.uppercaseString];
 		}
-				
-		NSString *styleClasses = @"";
-		// Set stylization for action, dialogue and dual dialogue elements.
-		// Ignore other blocks, because Final Draft doesn't like additional styles in those.
-		if (styles.count > 0 &&
-			(line.type == action || line.type == dialogue || line.type == dualDialogue))
-			styleClasses = [NSString stringWithFormat:@"Style=\"%@\"", [styles.allObjects componentsJoinedByString:@"+"]];
-		
-		styleString = [NSString stringWithFormat:@" %@%@", styleClasses, additionalStyles];
-		
-		// Tags for the current range
-        BeatTag *tag = attrs[BeatTagging.attributeKey];
-		NSString *tagAttribute = @"";
-		
-		if (tag) {
-			NSInteger number = [self addFDXTag:tag];
-			tagAttribute = format(@" TagNumber=\"%lu\"", number);
+		if ([styles containsObject:@"RemovalSuggestion"]) {
+			[styles removeObject:@"RemovalSuggestion"];
+			[styles addObject:@"Strikeout"];
+			NSString *highlightColor = [BeatColors colorWith16bitHex:@"fdxRemoval"];
+			[additionalStyles appendFormat:@" Background=\"#%@\"", highlightColor.uppercaseString];
 		}
-		
-		// Escape quotes etc.
-		[self escapeString:text];
-		
-		// Remove old-style carriage returns (just in case)
-		// NSString* c = [NSString stringWithFormat:@"%c", 0x03];
-		
-		// Remove unwanted characters
-		NSArray* l = [text componentsSeparatedByCharactersInSet:NSCharacterSet.badControlCharacters];
-		[text setString:[l componentsJoinedByString:@""]];
-		
-		// Append snippet to paragraph
-        [xmlString appendString:[self textBlockFor:text attributes:@[styleString, tagAttribute]]];
-		//[xmlString appendString:[NSString stringWithFormat:@"      <Text%@%@>%@</Text>\n", styleString, tagAttribute, text]];
-	}];
+	}
+	
+	[_writer write:@"<Text"];
+	
+	// Set stylization for action, dialogue and dual dialogue elements.
+	// Ignore other blocks, because Final Draft doesn't like additional styles in those.
+	if (styles.count > 0 &&
+		(line.type == action || line.type == dialogue || line.type == dualDialogue)) {
+		[_writer write:@" Style=\""];
+		[_writer write:[styles.allObjects componentsJoinedByString:@"+"]];
+		[_writer write:@"\""];
+	}
+	
+	[_writer write:additionalStyles];
+	
+	// Tags for the current range
+	BeatTag *tag = attrs[BeatTagging.attributeKey];
+	if (tag) {
+		[_writer write:@" TagNumber=\""];
+		[_writer writeInteger:[self addFDXTag:tag]];
+		[_writer write:@"\""];
+	}
 	
-	return xmlString;
+	for (NSValue* range in ranges) {
+		if (containsDevanagari(text, range.rangeValue)) {
+			[_writer write:self.hindiClass];
+			break;
+		}
+	}
+	
+	[_writer write:@">"];
+	
+	// Escape quotes etc. and remove unwanted characters
+	for (NSValue* range in ranges) {
+		[_writer writeEscaped:text range:range.rangeValue skipping:NSCharacterSet.badControlCharacters];
+	}
+	
+	[_writer write:@"</Text>"];
 }
 
 - (NSInteger)addFDXTag:(BeatTag*)tag {
-	if (![_tagItems containsObject:tag]) {
+	NSValue* key = [NSValue valueWithNonretainedObject:tag];
+	NSNumber* number = _tagNumbers[key];
+	
+	if (number == nil) {
 		[_tagItems addObject:tag];
-		[_tagDefinitions addObject:tag.definition];
-		NSInteger number = [_tagItems indexOfObject:tag] + 1;
-		
-		// Add definition
-        NSString* key = tag.key;
-        NSDictionary* fdxTag = [self getFDXTagForKey:key];
+		number = @(_tagItems.count);
+		_tagNumbers[key] = number;
+	}
 	
-		NSString* definition = [NSString stringWithFormat:@"      <TagDefinition CatId=\"%@\" Id=\"%@\" Label=\"%@\" Number=\"%lu\"/>\n", fdxTag[@"id"], tag.defId.lowercaseString, tag.definition.name, number];
-		[_tagDefinitionsStr appendString:definition];
+	// Return the number for to be used in the script
+	return number.integerValue;
+}
+
+- (void)writeTagDefinitions
+{
+	for (NSInteger i = 0; i < _tagItems.count; i++) {
+		BeatTag* tag = _tagItems[i];
+		NSDictionary* fdxTag = [self getFDXTagForKey:tag.key];
 		
-		// Add the tag itself
-		NSString *tagStr = [NSString stringWithFormat:
-						 @"      <Tag Number=\"%lu\">\n"
-						 @"        <DefId>%@</DefId>\n"
-						 @"      </Tag>\n",
-						 number, tag.defId.lowercaseString
-						];
-		[_tagsStr appendString:tagStr];
+		[_writer write:@"      <TagDefinition CatId=\""];
+		[_writer writeEscaped:fdxTag[@"id"]];
+		[_writer write:@"\" Id=\""];
+		[_writer writeEscaped:tag.defId.lowercaseString];
+		[_writer write:@"\" Label=\""];
+		[_writer writeEscaped:tag.definition.name];
+		[_writer write:@"\" Number=\""];
+		[_writer writeInteger:i + 1];
+		[_writer write:@"\"/>\n"];
+	}
+}
+
+- (void)writeTags
+{
+	for (NSInteger i = 0; i < _tagItems.count; i++) {
+		BeatTag* tag = _tagItems[i];
 		
-		// Return the number for to be used in the script
-		return number;
-	} else {
-		return [_tagItems indexOfObject:tag] + 1;
+		[_writer write:@"      <Tag Number=\""];
+		[_writer writeInteger:i + 1];
+		[_writer write:@"\">\n"];
+		[_writer write:@"        <DefId>"];
+		[_writer writeEscaped:tag.defId.lowercaseString];
+		[_writer write:@"</DefId>\n"];
+		[_writer write:@"      </Tag>\n"];
 	}
 }
 
@@ -797,26 +873,14 @@
     }
 }
 
-/// Returns a single `<Text></Text>` block for a paragraph.
-- (NSString*)textBlockFor:(NSString*)string
+/// Writes a single, escaped `<Text></Text>` block for a paragraph. Takes care of possible different font for Hindi lines.
+- (void)writeTextBlock:(NSString*)string
 {
-    return [self textBlockFor:string attributes:@[]];
-}
-
-/// Returns a single `<Text></Text>` block for a paragraph with additional attributes. Takes care of possible different font for Hindi lines.
-/// @param attrs An array of attributes for the text tag. NOTE: You need to prefix all of these with a space because I didn't feel like refactoring the whole thing, ie. `[" Style='Italic'", " TagAttribute='1'"]`
-- (NSString*)textBlockFor:(NSString*)string attributes:(NSArray<NSString*>*)attrs
-{
-    NSMutableString *additionalClasses = NSMutableString.new;
-    for (NSString* attr in attrs) {
-        [additionalClasses appendString:attr];
-    }
-    
-    if (string.containsHindi) {
-        [additionalClasses appendString:self.hindiClass];
-    }
-    
-    return [NSString stringWithFormat:@"<Text%@>%@</Text>", additionalClasses, string];
+    [_writer write:@"<Text"];
+    if (containsDevanagari(string, NSMakeRange(0, string.length))) [_writer write:self.hindiClass];
+    [_writer write:@">"];
+    [_writer writeEscaped:string];
+    [_writer write:@"</Text>"];
 }
 
 - (NSString*)hindiClass
@@ -0,0 +1,41 @@
+//
+//  BeatXMLStreamWriter.h
+//  BeatFileExport
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+/**
+
+ Buffered UTF-8 writer for XML output. Strings are read as UTF-16 chunks and encoded (and escaped if needed) straight into
+ a fixed-size byte buffer, which is flushed to the output stream when full. No intermediate strings are created, so memory use
+ doesn't grow with the document.
+
+ */
+
+#import <Foundation/Foundation.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface BeatXMLStreamWriter : NSObject
+/// Set if writing to the stream failed. Any subsequent writes are ignored.
+@property (nonatomic, readonly, nullable) NSError* error;
+
+/// The stream has to be opened by the caller
+- (instancetype)initWithOutputStream:(NSOutputStream*)stream;
+
+/// Writes markup as is
+- (void)write:(NSString*)string;
+/// Writes text content or attribute value, escaping XML entities
+- (void)writeEscaped:(NSString* _Nullable)string;
+/// Writes the given range of text, escaping XML entities. Characters in `skippedCharacters` are left out.
+- (void)writeEscaped:(NSString*)string range:(NSRange)range skipping:(NSCharacterSet* _Nullable)skippedCharacters;
+- (void)writeInteger:(NSInteger)value;
+/// Writes a floating point value using `%f`
+- (void)writeFloat:(double)value;
+
+/// Writes any buffered bytes to the stream. Returns `false` if writing failed at any point.
+- (bool)flush;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,184 @@
+//
+//  BeatXMLStreamWriter.m
+//  BeatFileExport
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+#import "BeatXMLStreamWriter.h"
+
+#define XML_BUFFER_SIZE 65536
+#define XML_CHUNK_SIZE 512
+/// Longest possible output for a single UTF-16 unit: a replacement character (3 bytes) for a preceding lone surrogate, followed by an escaped entity (`&quot;`)
+#define XML_MAX_UNIT_LENGTH (3 + 6)
+
+@implementation BeatXMLStreamWriter {
+	NSOutputStream* _stream;
+	uint8_t _buffer[XML_BUFFER_SIZE];
+	NSUInteger _length;
+}
+
+- (instancetype)initWithOutputStream:(NSOutputStream*)stream
+{
+	self = [super init];
+	if (self) {
+		_stream = stream;
+	}
+	return self;
+}
+
+/// Writes the buffer out and empties it. After a failed write, the buffer is just discarded so callers never append past its end.
+- (bool)flush
+{
+	if (_error != nil) {
+		_length = 0;
+		return false;
+	}
+
+	NSUInteger written = 0;
+	while (written < _length) {
+		NSInteger result = [_stream write:_buffer + written maxLength:_length - written];
+		if (result <= 0) {
+			_error = (_stream.streamError != nil) ? _stream.streamError : [NSError errorWithDomain:NSPOSIXErrorDomain code:EIO userInfo:nil];
+			NSLog(@"🆘 XML stream writer failed: %@", _error);
+			break;
+		}
+		written += result;
+	}
+
+	_length = 0;
+	return (_error == nil);
+}
+
+static inline void appendByte(BeatXMLStreamWriter* writer, uint8_t byte)
+{
+	writer->_buffer[writer->_length++] = byte;
+}
+
+static inline void appendBytes(BeatXMLStreamWriter* writer, const char* bytes, NSUInteger length)
+{
+	memcpy(writer->_buffer + writer->_length, bytes, length);
+	writer->_length += length;
+}
+
+/// Encodes a code point as UTF-8. Buffer has to have room for at least four bytes.
+static inline void appendCodePoint(BeatXMLStreamWriter* writer, uint32_t c)
+{
+	if (c < 0x80) {
+		appendByte(writer, c);
+	} else if (c < 0x800) {
+		appendByte(writer, 0xC0 | (c >> 6));
+		appendByte(writer, 0x80 | (c & 0x3F));
+	} else if (c < 0x10000) {
+		appendByte(writer, 0xE0 | (c >> 12));
+		appendByte(writer, 0x80 | ((c >> 6) & 0x3F));
+		appendByte(writer, 0x80 | (c & 0x3F));
+	} else {
+		appendByte(writer, 0xF0 | (c >> 18));
+		appendByte(writer, 0x80 | ((c >> 12) & 0x3F));
+		appendByte(writer, 0x80 | ((c >> 6) & 0x3F));
+		appendByte(writer, 0x80 | (c & 0x3F));
+	}
+}
+
+/// Encodes the given range of UTF-16 units. Surrogate pairs are allowed to span chunk boundaries.
+- (void)appendString:(NSString*)string range:(NSRange)range escape:(bool)escape skipping:(NSCharacterSet*)skipped
+{
+	if (_error != nil || string.length == 0) return;
+
+	unichar chunk[XML_CHUNK_SIZE];
+	unichar highSurrogate = 0;
+
+	NSUInteger end = NSMaxRange(range);
+	for (NSUInteger location = range.location; location < end; location += XML_CHUNK_SIZE) {
+		NSUInteger count = MIN(XML_CHUNK_SIZE, end - location);
+		[string getCharacters:chunk range:NSMakeRange(location, count)];
+
+		for (NSUInteger i = 0; i < count; i++) {
+			if (_length > XML_BUFFER_SIZE - XML_MAX_UNIT_LENGTH && ![self flush]) return;
+
+			unichar c = chunk[i];
+
+			// Complete a surrogate pair
+			if (highSurrogate != 0) {
+				if (CFStringIsSurrogateLowCharacter(c)) {
+					appendCodePoint(self, CFStringGetLongCharacterForSurrogatePair(highSurrogate, c));
+					highSurrogate = 0;
+					continue;
+				}
+				appendCodePoint(self, 0xFFFD);
+				highSurrogate = 0;
+			}
+
+			// Plain ASCII is the most common case
+			if (c >= 0x20 && c < 0x7F) {
+				if (escape) {
+					switch (c) {
+						case '&': appendBytes(self, "&amp;", 5); continue;
+						case '<': appendBytes(self, "&lt;", 4); continue;
+						case '>': appendBytes(self, "&gt;", 4); continue;
+						case '"': appendBytes(self, "&quot;", 6); continue;
+						case '\'': appendBytes(self, "&#x27;", 6); continue;
+					}
+				}
+				appendByte(self, c);
+				continue;
+			}
+
+			if (skipped != nil && [skipped characterIsMember:c]) continue;
+
+			if (CFStringIsSurrogateHighCharacter(c)) {
+				highSurrogate = c;
+			} else if (CFStringIsSurrogateLowCharacter(c)) {
+				appendCodePoint(self, 0xFFFD);
+			} else {
+				appendCodePoint(self, c);
+			}
+		}
+	}
+
+	if (highSurrogate != 0) {
+		if (_length > XML_BUFFER_SIZE - XML_MAX_UNIT_LENGTH && ![self flush]) return;
+		appendCodePoint(self, 0xFFFD);
+	}
+}
+
+- (void)write:(NSString*)string
+{
+	[self appendString:string range:NSMakeRange(0, string.length) escape:false skipping:nil];
+}
+
+- (void)writeEscaped:(NSString*)string
+{
+	if (string == nil) return;
+	[self appendString:string range:NSMakeRange(0, string.length) escape:true skipping:nil];
+}
+
+- (void)writeEscaped:(NSString*)string range:(NSRange)range skipping:(NSCharacterSet*)skippedCharacters
+{
+	[self appendString:string range:range escape:true skipping:skippedCharacters];
+}
+
+- (void)writeInteger:(NSInteger)value
+{
+	char number[32];
+	int length = snprintf(number, sizeof(number), "%ld", (long)value);
+	[self writeBytes:number length:length];
+}
+
+- (void)writeFloat:(double)value
+{
+	char number[64];
+	int length = snprintf(number, sizeof(number), "%f", value);
+	[self writeBytes:number length:MIN(length, (int)sizeof(number) - 1)];
+}
+
+- (void)writeBytes:(const char*)bytes length:(NSUInteger)length
+{
+	if (_error != nil) return;
+	if (_length + length > XML_BUFFER_SIZE && ![self flush]) return;
+	if (length > XML_BUFFER_SIZE) return;
+	appendBytes(self, bytes, length);
+}
+
+@end
@@ -9,7 +9,9 @@
 #import <Foundation/Foundation.h>
 
 @class ContinuousFountainParser;
+@class Line;
 @interface OutlineExtractor : NSObject
 + (void)register:(id)manager;
 + (NSString*)outlineFromParse:(ContinuousFountainParser*)parser;
++ (NSString*)outlineFromLines:(NSArray<Line*>*)lines;
 @end
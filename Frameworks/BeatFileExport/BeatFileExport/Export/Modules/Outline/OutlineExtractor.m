@@ -15,19 +15,24 @@
 
 + (void)register:(BeatFileExportManager*)manager
 {
-	// Register as export handler
-	[manager registerHandlerFor:@"Outline" fileTypes:@[@"fountain", @"txt"] supportedStyles:@[@"Screenplay"] handler:^id _Nullable(id<BeatEditorDelegate> _Nonnull delegate) {
-
-		return [OutlineExtractor outlineFromParse:delegate.parser];
+	// Register as export sink
+	[manager registerSinkFor:@"Outline" fileTypes:@[@"fountain", @"txt"] supportedStyles:@[@"Screenplay"] sink:^BOOL(BeatExportDocument * _Nonnull document, NSOutputStream * _Nonnull stream) {
+		NSString* outline = [OutlineExtractor outlineFromLines:document.lines];
+		return [stream writeData:[outline dataUsingEncoding:NSUTF8StringEncoding]];
 	}];
 }
 
 + (NSString*)outlineFromParse:(ContinuousFountainParser*)parser
+{
+	return [self outlineFromLines:parser.lines];
+}
+
++ (NSString*)outlineFromLines:(NSArray<Line*>*)lines
 {
     NSMutableString* result = [[NSMutableString alloc] init];
     
     Line* lastLine = nil;
-    for (Line* line in parser.lines) {
+    for (Line* line in lines) {
         if (line.type == section || line.type == synopse || line.type == heading) {
             //To put empty lines in between types, we compare to the last lines type
             if (lastLine && (line.type == heading || lastLine.type != line.type)) {
@@ -0,0 +1,498 @@
+//
+//  BeatDocumentWriter.swift
+//  BeatFileExport
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+/**
+
+ Direct RTF and Office Open XML writers. Paragraph styles are derived from `RenderStyle` and written into the style table once,
+ after which each printable line is written as a paragraph with run-level inline formatting.
+
+ RTF is streamed straight into the output, so only one paragraph is kept in memory at a time. DOCX body is built in a single
+ pass and zipped with `BeatZipWriter`.
+
+ */
+
+import Foundation
+import CoreGraphics
+import BeatCore
+
+/// A run of text with inline formatting
+struct BeatTextRun {
+	var text:String
+	var bold = false
+	var italic = false
+	var underline = false
+	var note = false
+}
+
+/// Paragraph formatting derived from `RenderStyle`. Paragraphs with equal formatting share an entry in the style table.
+struct BeatParagraphStyle:Hashable {
+	var name:String
+	var font:Int
+	var fontSize:CGFloat
+	var bold:Bool
+	var italic:Bool
+	var underline:Bool
+	var alignment:NSTextAlignment
+	var leftIndent:CGFloat
+	/// First line indent relative to left indent
+	var firstLineIndent:CGFloat
+	var rightIndent:CGFloat
+	var spaceBefore:CGFloat
+	var spaceAfter:CGFloat
+	/// Index in color table, `0` is black
+	var color:Int
+}
+
+class BeatDocumentWriter {
+	let document:BeatExportDocument
+	let settings:BeatExportSettings
+	let fontSet:BeatFontSet
+
+	/// Style table, collected before anything is written
+	private(set) var paragraphStyles:[BeatParagraphStyle] = []
+	private var styleIndices:[BeatParagraphStyle:Int] = [:]
+
+	/// Font family names
+	private(set) var fonts:[String] = []
+	/// Colors as hex values (`RRGGBB`). Black is always the first one.
+	private(set) var colors:[String] = ["000000"]
+
+	/// Color index for notes
+	private(set) var noteColor = 0
+
+	/// Printable lines and their style indices
+	private var items:[(line:Line, style:RenderStyle, index:Int)] = []
+
+	init(document:BeatExportDocument) {
+		self.document = document
+		self.settings = document.exportSettings
+
+		// Match the fonts used by renderer
+		var fontType = document.styles.page().fontType
+		if fontType == .fixed && BeatUserDefaults.shared().getInteger(BeatSettingFontStyle) == 2 { fontType = .fixedNew }
+		self.fontSet = BeatFontManager.shared.fonts(for: fontType) ?? BeatFontManager.shared.defaultFonts
+
+		let noteStyle = document.styles.forElement("note")
+		noteColor = colorIndex(!noteStyle.color.isEmpty ? noteStyle.color : "gray")
+
+		collectStyles()
+	}
+
+	/// Resolves styles for all printable lines
+	private func collectStyles() {
+		for line in document {
+			let style = renderStyle(for: line)
+			let paragraphStyle = self.paragraphStyle(for: style)
+
+			var index = styleIndices[paragraphStyle]
+			if index == nil {
+				index = paragraphStyles.count
+				paragraphStyles.append(paragraphStyle)
+				styleIndices[paragraphStyle] = index
+			}
+
+			items.append((line, style, index!))
+		}
+	}
+
+	/// Dual dialogue is not laid out in columns, so those lines use the normal dialogue styles, as in renderer
+	private func renderStyle(for line:Line) -> RenderStyle {
+		if line.isDualDialogue() {
+			switch line.type {
+			case .dualDialogueCharacter: return document.styles.forElement(Line.typeName(.character))
+			case .dualDialogueParenthetical: return document.styles.forElement(Line.typeName(.parenthetical))
+			case .dualDialogue: return document.styles.forElement(Line.typeName(.dialogue))
+			default: break
+			}
+		}
+		return document.styles.forLine(line)
+	}
+
+	private func paragraphStyle(for style:RenderStyle) -> BeatParagraphStyle {
+		var fontSize = (style.fontSize > 0) ? style.fontSize : 12.0
+		if style.font == "system" && style.fontSize <= 0 { fontSize = 11.0 }
+
+		return BeatParagraphStyle(
+			name: style.name,
+			font: fontIndex(for: style),
+			fontSize: fontSize,
+			bold: style.bold,
+			italic: style.italic,
+			underline: style.underline,
+			alignment: style.textAlignment,
+			leftIndent: style.marginLeft,
+			firstLineIndent: style.firstLineIndent,
+			rightIndent: style.marginRight,
+			spaceBefore: style.marginTop,
+			spaceAfter: style.marginBottom,
+			color: colorIndex(style.color)
+		)
+	}
+
+	private func fontIndex(for style:RenderStyle) -> Int {
+		var name:String
+		if style.font.isEmpty || style.font == "default" {
+			let family:String? = fontSet.regular.familyName
+			name = family ?? fontSet.regular.fontName
+		} else if style.font == "system" {
+			name = "Helvetica"
+		} else {
+			name = style.font
+		}
+
+		if let i = fonts.firstIndex(of: name) { return i }
+		fonts.append(name)
+		return fonts.count - 1
+	}
+
+	private func colorIndex(_ name:String) -> Int {
+		guard let hex = BeatDocumentWriter.hexColor(name) else { return 0 }
+		if let i = colors.firstIndex(of: hex) { return i }
+		colors.append(hex)
+		return colors.count - 1
+	}
+
+	class func hexColor(_ name:String) -> String? {
+		guard !name.isEmpty,
+			  let color = BeatColors.color(name),
+			  let sRGB = CGColorSpace(name: CGColorSpace.sRGB),
+			  let components = color.cgColor.converted(to: sRGB, intent: .defaultIntent, options: nil)?.components,
+			  components.count >= 3
+		else { return nil }
+
+		let values = components.prefix(3).map { Int(($0 * 255.0).rounded()) }
+		return String(format: "%02X%02X%02X", values[0], values[1], values[2])
+	}
+
+	/// Enumerates paragraphs in document order. Return `false` from the handler to stop.
+	func enumerateParagraphs(_ handler:(_ style:Int, _ runs:[BeatTextRun], _ pageBreakBefore:Bool) -> Bool) -> Bool {
+		var pageBreak = false
+
+		for item in items {
+			if item.style.beginsPage { pageBreak = true }
+			if item.line.type == .pageBreak { continue }
+
+			guard handler(item.index, runs(for: item.line, style: item.style), pageBreak) else { return false }
+			pageBreak = false
+		}
+
+		return true
+	}
+
+	/// Splits the printable content of a line into formatted runs
+	func runs(for line:Line, style:RenderStyle) -> [BeatTextRun] {
+		// Empty character cues are written as empty paragraphs
+		if line.isAnyCharacter() && line.stripFormatting().isEmpty && line.numberOfPrecedingFormattingCharacters == 1 {
+			return []
+		}
+
+		if let content = style.content {
+			return [BeatTextRun(text: content)]
+		}
+
+		let attrStr = line.attributedStringForOutput(with: settings)
+		let string = attrStr.string as NSString
+		var runs:[BeatTextRun] = []
+
+		attrStr.enumerateAttribute(NSAttributedString.Key("Style"), in: NSMakeRange(0, attrStr.length)) { value, range, _ in
+			let styleNames = value as? Set<String> ?? []
+			var text = string.substring(with: range)
+			if style.uppercase { text = text.uppercased() }
+
+			runs.append(BeatTextRun(text: text,
+									bold: styleNames.contains("Bold"),
+									italic: styleNames.contains("Italic"),
+									underline: styleNames.contains("Underline"),
+									note: styleNames.contains("Note")))
+		}
+
+		if style.trim, runs.count > 0 {
+			runs[0].text = String(runs[0].text.drop(while: { $0 == " " || $0 == "\t" }))
+			runs[runs.count - 1].text = String(runs[runs.count - 1].text.reversed().drop(while: { $0 == " " || $0 == "\t" }).reversed())
+		}
+
+		return runs
+	}
+
+	/// Points to twentieths of a point
+	func twips(_ value:CGFloat) -> Int {
+		return Int((value * 20.0).rounded())
+	}
+
+	/// Page size in twips
+	var pageSize:(width:Int, height:Int) {
+		return (document.paperSize == .A4) ? (11906, 16838) : (12240, 15840)
+	}
+}
+
+
+// MARK: - RTF
+
+final class BeatRTFWriter:BeatDocumentWriter {
+	/// Output is flushed into the stream after it grows over this size
+	private let bufferSize = 64 * 1024
+
+	func write(to stream:OutputStream) -> Bool {
+		var buffer = ""
+
+		func flush() -> Bool {
+			guard !buffer.isEmpty else { return true }
+			let result = stream.write(Data(buffer.utf8))
+			buffer.removeAll(keepingCapacity: true)
+			return result
+		}
+
+		let page = pageSize
+		let styleFormatting = paragraphStyles.map { formatting(for: $0) }
+
+		// Header, font, color and style tables
+		buffer += "{\\rtf1\\ansi\\ansicpg1252\\deff0\\uc1\n"
+		buffer += "{\\fonttbl"
+		for (i, font) in fonts.enumerated() { buffer += "{\\f\(i)\\fnil\\fcharset0 \(escape(font));}" }
+		buffer += "}\n"
+
+		buffer += "{\\colortbl;"
+		for color in colors {
+			let value = Int(color, radix: 16) ?? 0
+			buffer += "\\red\((value >> 16) & 0xFF)\\green\((value >> 8) & 0xFF)\\blue\(value & 0xFF);"
+		}
+		buffer += "}\n"
+
+		buffer += "{\\stylesheet"
+		for (i, style) in paragraphStyles.enumerated() {
+			buffer += "{\\s\(i + 1)\(styleFormatting[i]) \(escape(styleName(style, index: i)));}"
+		}
+		buffer += "}\n"
+
+		buffer += "\\paperw\(page.width)\\paperh\(page.height)\\margl1440\\margr1440\\margt1440\\margb1440\n"
+
+		// Paragraphs
+		let success = enumerateParagraphs { styleIndex, runs, pageBreakBefore in
+			buffer += "\\pard\\plain\\s\(styleIndex + 1)\(styleFormatting[styleIndex])"
+			if pageBreakBefore { buffer += "\\pagebb" }
+			buffer += " "
+
+			for run in runs where !run.text.isEmpty {
+				var control = ""
+				if run.bold { control += "\\b" }
+				if run.italic { control += "\\i" }
+				if run.underline { control += "\\ul" }
+				if run.note { control += "\\cf\(noteColor + 1)" }
+
+				if !control.isEmpty { buffer += "{\(control) \(escape(run.text))}" }
+				else { buffer += escape(run.text) }
+			}
+
+			buffer += "\\par\n"
+
+			if buffer.utf8.count > bufferSize { return flush() }
+			return true
+		}
+
+		guard success else { return false }
+
+		buffer += "}\n"
+		return flush()
+	}
+
+	/// Paragraph and character formatting for a style
+	private func formatting(for style:BeatParagraphStyle) -> String {
+		var rtf = ""
+
+		switch style.alignment {
+		case .center: rtf += "\\qc"
+		case .right: rtf += "\\qr"
+		case .justified: rtf += "\\qj"
+		default: rtf += "\\ql"
+		}
+
+		rtf += "\\li\(twips(style.leftIndent))\\ri\(twips(style.rightIndent))\\fi\(twips(style.firstLineIndent))"
+		rtf += "\\sb\(twips(style.spaceBefore))\\sa\(twips(style.spaceAfter))"
+		rtf += "\\f\(style.font)\\fs\(Int((style.fontSize * 2).rounded()))\\cf\(style.color + 1)"
+
+		if style.bold { rtf += "\\b" }
+		if style.italic { rtf += "\\i" }
+		if style.underline { rtf += "\\ul" }
+
+		return rtf
+	}
+
+	/// Escapes control characters and writes anything outside ASCII as unicode
+	private func escape(_ string:String) -> String {
+		var result = ""
+		result.reserveCapacity(string.utf16.count)
+
+		for unit in string.utf16 {
+			switch unit {
+			case 0x5C: result += "\\\\"
+			case 0x7B: result += "\\{"
+			case 0x7D: result += "\\}"
+			case 0x0A, 0x2028: result += "\\line "
+			case 0x09: result += "\\tab "
+			case 0x20..<0x80: result.unicodeScalars.append(Unicode.Scalar(UInt8(unit)))
+			case 0..<0x20: break
+			default: result += "\\u\(Int16(bitPattern: unit))?"
+			}
+		}
+
+		return result
+	}
+}
+
+
+// MARK: - Office Open XML
+
+final class BeatDOCXWriter:BeatDocumentWriter {
+	func write(to stream:OutputStream) -> Bool {
+		let zip = BeatZipWriter()
+
+		zip.addEntry("[Content_Types].xml", string: """
+		<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+		<Types xmlns="http://schemas.openxmlformats.org/package/2006/content-types"><Default Extension="rels" ContentType="application/vnd.openxmlformats-package.relationships+xml"/><Default Extension="xml" ContentType="application/xml"/><Override PartName="/word/document.xml" ContentType="application/vnd.openxmlformats-officedocument.wordprocessingml.document.main+xml"/><Override PartName="/word/styles.xml" ContentType="application/vnd.openxmlformats-officedocument.wordprocessingml.styles+xml"/></Types>
+		""")
+
+		zip.addEntry("_rels/.rels", string: """
+		<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+		<Relationships xmlns="http://schemas.openxmlformats.org/package/2006/relationships"><Relationship Id="rId1" Type="http://schemas.openxmlformats.org/officeDocument/2006/relationships/officeDocument" Target="word/document.xml"/></Relationships>
+		""")
+
+		zip.addEntry("word/_rels/document.xml.rels", string: """
+		<?xml version="1.0" encoding="UTF-8" standalone="yes"?>
+		<Relationships xmlns="http://schemas.openxmlformats.org/package/2006/relationships"><Relationship Id="rId1" Type="http://schemas.openxmlformats.org/officeDocument/2006/relationships/styles" Target="styles.xml"/></Relationships>
+		""")
+
+		zip.addEntry("word/styles.xml", string: stylesXML())
+
+		guard let body = documentXML() else { return false }
+		zip.addEntry("word/document.xml", data: body)
+
+		return zip.write(to: stream)
+	}
+
+	private func stylesXML() -> String {
+		var xml = "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n"
+		xml += "<w:styles xmlns:w=\"http://schemas.openxmlformats.org/wordprocessingml/2006/main\">"
+
+		for (i, style) in paragraphStyles.enumerated() {
+			xml += "<w:style w:type=\"paragraph\" w:customStyle=\"1\" w:styleId=\"BeatStyle\(i + 1)\">"
+			xml += "<w:name w:val=\"\(escape(styleName(style, index: i)))\"/>"
+
+			// Paragraph properties
+			xml += "<w:pPr>"
+			xml += "<w:spacing w:before=\"\(twips(style.spaceBefore))\" w:after=\"\(twips(style.spaceAfter))\" w:line=\"240\" w:lineRule=\"auto\"/>"
+
+			let firstLine = twips(style.firstLineIndent)
+			let indent = (firstLine < 0) ? "w:hanging=\"\(-firstLine)\"" : "w:firstLine=\"\(firstLine)\""
+			xml += "<w:ind w:left=\"\(twips(style.leftIndent))\" w:right=\"\(twips(style.rightIndent))\" \(indent)/>"
+
+			switch style.alignment {
+			case .center: xml += "<w:jc w:val=\"center\"/>"
+			case .right: xml += "<w:jc w:val=\"right\"/>"
+			case .justified: xml += "<w:jc w:val=\"both\"/>"
+			default: xml += "<w:jc w:val=\"left\"/>"
+			}
+			xml += "</w:pPr>"
+
+			// Character properties
+			let font = escape(fonts[style.font])
+			xml += "<w:rPr><w:rFonts w:ascii=\"\(font)\" w:hAnsi=\"\(font)\" w:cs=\"\(font)\"/>"
+			if style.bold { xml += "<w:b/>" }
+			if style.italic { xml += "<w:i/>" }
+			if style.underline { xml += "<w:u w:val=\"single\"/>" }
+			xml += "<w:color w:val=\"\(colors[style.color])\"/>"
+			xml += "<w:sz w:val=\"\(Int((style.fontSize * 2).rounded()))\"/>"
+			xml += "</w:rPr>"
+
+			xml += "</w:style>"
+		}
+
+		xml += "</w:styles>"
+		return xml
+	}
+
+	private func documentXML() -> Data? {
+		var xml = Data()
+		xml.append(contentsOf: "<?xml version=\"1.0\" encoding=\"UTF-8\" standalone=\"yes\"?>\n".utf8)
+		xml.append(contentsOf: "<w:document xmlns:w=\"http://schemas.openxmlformats.org/wordprocessingml/2006/main\"><w:body>".utf8)
+
+		var paragraph = ""
+		let success = enumerateParagraphs { styleIndex, runs, pageBreakBefore in
+			paragraph.removeAll(keepingCapacity: true)
+			paragraph += "<w:p><w:pPr><w:pStyle w:val=\"BeatStyle\(styleIndex + 1)\"/>"
+			if pageBreakBefore { paragraph += "<w:pageBreakBefore/>" }
+			paragraph += "</w:pPr>"
+
+			for run in runs where !run.text.isEmpty {
+				paragraph += "<w:r>"
+
+				if run.bold || run.italic || run.underline || run.note {
+					paragraph += "<w:rPr>"
+					if run.bold { paragraph += "<w:b/>" }
+					if run.italic { paragraph += "<w:i/>" }
+					if run.underline { paragraph += "<w:u w:val=\"single\"/>" }
+					if run.note { paragraph += "<w:color w:val=\"\(colors[noteColor])\"/>" }
+					paragraph += "</w:rPr>"
+				}
+
+				// Line breaks and tabs are separate elements in OOXML
+				let lines = run.text.components(separatedBy: CharacterSet(charactersIn: "\n\u{2028}"))
+				for (i, line) in lines.enumerated() {
+					if i > 0 { paragraph += "<w:br/>" }
+
+					let parts = line.components(separatedBy: "\t")
+					for (j, part) in parts.enumerated() {
+						if j > 0 { paragraph += "<w:tab/>" }
+						if !part.isEmpty { paragraph += "<w:t xml:space=\"preserve\">\(escape(part))</w:t>" }
+					}
+				}
+
+				paragraph += "</w:r>"
+			}
+
+			paragraph += "</w:p>"
+			xml.append(contentsOf: paragraph.utf8)
+			return true
+		}
+
+		guard success else { return nil }
+
+		let page = pageSize
+		xml.append(contentsOf: "<w:sectPr><w:pgSz w:w=\"\(page.width)\" w:h=\"\(page.height)\"/><w:pgMar w:top=\"1440\" w:right=\"1440\" w:bottom=\"1440\" w:left=\"1440\" w:header=\"720\" w:footer=\"720\" w:gutter=\"0\"/></w:sectPr>".utf8)
+		xml.append(contentsOf: "</w:body></w:document>".utf8)
+
+		return xml
+	}
+
+	/// Escapes XML entities and removes characters which are not allowed in XML
+	private func escape(_ string:String) -> String {
+		var result = ""
+		result.reserveCapacity(string.count)
+
+		for scalar in string.unicodeScalars {
+			switch scalar {
+			case "&": result += "&amp;"
+			case "<": result += "&lt;"
+			case ">": result += "&gt;"
+			case "\"": result += "&quot;"
+			case "\t", "\n", "\r": result.unicodeScalars.append(scalar)
+			default:
+				if scalar.value >= 0x20 { result.unicodeScalars.append(scalar) }
+			}
+		}
+
+		return result
+	}
+}
+
+
+extension BeatDocumentWriter {
+	/// Readable, unique name for a style table entry
+	func styleName(_ style:BeatParagraphStyle, index:Int) -> String {
+		let name = (!style.name.isEmpty) ? style.name.capitalized : "Paragraph"
+		let duplicate = paragraphStyles.prefix(index).contains { $0.name == style.name }
+		return duplicate ? "\(name) \(index + 1)" : name
+	}
+}
@@ -6,7 +6,6 @@
 //
 
 import Foundation
-import ZIPFoundation
 import BeatCore
 
 struct BeatEPubChapter {
@@ -21,22 +20,20 @@ struct BeatEPubChapter {
 
 public class BeatEPubExport:NSObject {
     public class func register(_ manager:BeatFileExportManager) {
-        manager.registerHandler(for: "ePub", fileTypes: ["epub"], supportedStyles: ["Novel"]) { delegate in
-            let exporter = BeatEPubExporter(delegate: delegate)
-            return exporter.ePubFile(delegate)
+        manager.registerSink(for: "ePub", fileTypes: ["epub"], supportedStyles: ["Novel"]) { document, stream in
+            let exporter = BeatEPubExporter(document: document)
+            return exporter.write(to: stream)
         }
     }
 }
 
 public class BeatEPubExporter:NSObject {
-    var parser:ContinuousFountainParser
     var document:BeatScreenplay
     var settings:BeatExportSettings
     
-    init(delegate: BeatEditorDelegate) {
-        self.settings = delegate.exportSettings
-        self.parser = delegate.parser
-        self.document = BeatScreenplay.from(delegate.parser, settings: delegate.exportSettings)
+    init(document: BeatExportDocument) {
+        self.settings = document.exportSettings
+        self.document = document.screenplay
         
         super.init()
     }
@@ -176,49 +173,33 @@ public class BeatEPubExporter:NSObject {
         </navPoint>
     """)
     
-    func ePubFile(_ delegate:BeatEditorDelegate) -> Data? {
-        let ePubPath = NSTemporaryDirectory() + "/ePubTemp/"
-        let url = URL(fileURLWithPath: ePubPath)
-        
-        let zipUrl = URL(fileURLWithPath: BeatPaths.pathForTemporaryFile(withPrefix: "epub"))
-        
-        guard let archive = try? Archive(url: zipUrl, accessMode: .create, pathEncoding: .utf8) else {
-            print("Can't create ePub archive")
-            return nil
-        }
-        
-        let chapterData = chapterFiles()
+    /// Writes the ePub archive into an open stream
+    func write(to stream:OutputStream) -> Bool {
+        return archive().write(to: stream)
+    }
+    
+    func ePubFile() -> Data? {
+        return archive().data()
+    }
     
-        let metaPath = ePubPath + "META-INF/"
-        let OEBPSPath = ePubPath + "OEBPS/"
-        let CSSPath = ePubPath + "CSS/"
+    func archive() -> BeatZipWriter {
+        let chapterData = chapterFiles()
         
         var oneLineTitle = self.document.titlePageText(forField: "title").replacingOccurrences(of: "\n", with: " ").trimmingCharacters(in: .whitespaces)
         if oneLineTitle.count == 0 { oneLineTitle = "---" }
         
         let authors = self.document.titlePageText(forField: "authors").replacingOccurrences(of: "\n", with: ", ").trimmingCharacters(in: .whitespaces)
         
-        try? FileManager.default.createDirectory(atPath: ePubPath, withIntermediateDirectories: true)
-        try? FileManager.default.createDirectory(atPath: metaPath, withIntermediateDirectories: true)
-        try? FileManager.default.createDirectory(atPath: OEBPSPath, withIntermediateDirectories: true)
-        try? FileManager.default.createDirectory(atPath: CSSPath, withIntermediateDirectories: true)
+        // Everything is kept in memory and written into the archive in one pass
+        let archive = BeatZipWriter()
         
-        // Create mime type file
-        let mimeTypeURL = URL(fileURLWithPath: BeatPaths.pathForTemporaryFile(withPrefix: ""))
-        try? mimeType.write(to: mimeTypeURL, atomically: true, encoding: .utf8)
-        try? archive.addEntry(with: "mimetype", fileURL: mimeTypeURL , compressionMethod: .none)
-        
-        // Create container XML
-        let containerURL = URL(fileURLWithPath: metaPath + "container.xml")
-        try? metaContainer.write(to: containerURL, atomically: true, encoding: .utf8)
-        try? archive.addEntry(with: "META-INF/" + containerURL.lastPathComponent, relativeTo: url, compressionMethod: .none)
+        // Mime type has to be the first entry and can't be compressed
+        archive.addEntry("mimetype", string: mimeType, compress: false)
+        archive.addEntry("META-INF/container.xml", string: metaContainer, compress: false)
 
         // Create OEBPS files
         for chapter in chapterData {
-            let fileName = chapter.filename + ".xhtml"
-            let chapterURL = URL(fileURLWithPath: OEBPSPath + fileName)
-            try? chapter.html.write(to: chapterURL, atomically: true, encoding: .utf8)
-            try? archive.addEntry(with: "OEBPS/" + chapterURL.lastPathComponent, relativeTo: url)
+            archive.addEntry("OEBPS/" + chapter.filename + ".xhtml", string: chapter.html)
         }
         
         let chapterManifests = chapterData.map { $0.manifest }
@@ -234,39 +215,21 @@ public class BeatEPubExporter:NSObject {
             "spine-items": spineItems.joined(separator: "\n"),
             "manifest" : chapterManifests.joined(separator: "\n")
         ])
-        let manifestURL = URL(fileURLWithPath: OEBPSPath + "content.opf")
-        try? manifestString.write(to: manifestURL, atomically: true, encoding: .utf8)
-        try? archive.addEntry(with: "OEBPS/" + manifestURL.lastPathComponent, relativeTo: url)
-
+        archive.addEntry("OEBPS/content.opf", string: manifestString)
         
         // Create TOC
         let tocItems = chapterData.map { tocLink.render(data: ["fileName": $0.filename, "title": ($0.title.count > 0) ? $0.title : "---"]) }
-        let tocURL = URL(fileURLWithPath: OEBPSPath + "toc.xhtml")
-        
         let toc = self.toc.render(data: ["toc-items": tocItems.joined(separator: "\n")])
-        try? toc.write(to: tocURL, atomically: true, encoding: .utf8)
-        try? archive.addEntry(with: "OEBPS/" + tocURL.lastPathComponent, relativeTo: url)
+        archive.addEntry("OEBPS/toc.xhtml", string: toc)
         
         let chapterNavPoints = chapterData.map { $0.navPoint }
         let tocNCX = tocNCX.render(data: [
             "title": oneLineTitle,
             "navPoints": chapterNavPoints.joined(separator: "\n")
         ])
-        let tocNCXURL = URL(fileURLWithPath: OEBPSPath + "toc.ncx")
-        try? tocNCX.write(to: tocNCXURL, atomically: true, encoding: .utf8)
-        try? archive.addEntry(with: "OEBPS/" + tocNCXURL.lastPathComponent, relativeTo: url)
-        
-        if !FileManager.default.fileExists(atPath: ePubPath, isDirectory: nil) {
-            print("Couldn't create directory")
-            return nil
-        }
-        
-        print("url",url)
+        archive.addEntry("OEBPS/toc.ncx", string: tocNCX)
         
-        //try? FileManager.default.zipItem(at: url, to: zipUrl, shouldKeepParent: false, compressionMethod: .none)
-        //print("   zip:", url)
-        let data = try? Data(contentsOf: zipUrl)
-        return data
+        return archive
     }
     
     func chapters() -> [[Line]] {
@@ -287,12 +250,16 @@ public class BeatEPubExporter:NSObject {
         return chapters
     }
     
+    /// Chapters are converted to HTML concurrently. Each chapter only reads its own lines, and templates are not mutated when rendering.
     func chapterFiles() -> ([BeatEPubChapter]) {
-        var chapterItems:[BeatEPubChapter] = []
+        let chapters = self.chapters()
+        var chapterItems = [BeatEPubChapter?](repeating: nil, count: chapters.count)
+        let lock = NSLock()
         
-        var i = 1
-        
-        for chapter in chapters() {
+        DispatchQueue.concurrentPerform(iterations: chapters.count) { index in
+            let chapter = chapters[index]
+            let i = index + 1
+            
             // Create HTML and find chapter title
             let content = html(lines: chapter)
             var title = chapter.first?.stripFormatting().trimmingCharacters(in: .whitespaces) ?? "(none)"
@@ -309,12 +276,13 @@ public class BeatEPubExporter:NSObject {
             let navItem = navPoint.render(data: [ "id": fileName, "order": String(i), "title": title ])
             
             let chapterItem = BeatEPubChapter(title: title, filename: fileName, html: html, manifest: mItem, navPoint: navItem)
-            chapterItems.append(chapterItem)
             
-            i += 1
+            lock.lock()
+            chapterItems[index] = chapterItem
+            lock.unlock()
         }
         
-        return chapterItems
+        return chapterItems.compactMap { $0 }
     }
     
     func html(lines:[Line]) -> String {
@@ -0,0 +1,225 @@
+//
+//  BeatZipWriter.swift
+//  BeatFileExport
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+/**
+
+ Minimal ZIP archive writer for in-memory content. Entries are deflated in parallel and then written sequentially to an output
+ stream, followed by the central directory. Nothing touches the disk unless the stream itself points to a file.
+
+ Entries are written in the order they were added, which matters for ePub: `mimetype` has to be the first, uncompressed entry.
+ ZIP64 is not supported, so a single archive has to stay under 4 GB.
+
+ */
+
+import Foundation
+import Compression
+
+final class BeatZipWriter {
+    private struct Entry {
+        var path:String
+        var data:Data
+        var compress:Bool
+    }
+
+    private struct PreparedEntry {
+        var path:Data
+        var payload:Data
+        var crc:UInt32
+        var uncompressedSize:UInt32
+        var method:UInt16
+        var offset:UInt32 = 0
+    }
+
+    private static let methodStored:UInt16 = 0
+    private static let methodDeflate:UInt16 = 8
+    /// Bit 11 marks file names as UTF-8
+    private static let flagUTF8:UInt16 = 1 << 11
+
+    private var entries:[Entry] = []
+
+    /// Adds a file to the archive. Set `compress` to `false` for entries which have to be stored as is.
+    func addEntry(_ path:String, data:Data, compress:Bool = true) {
+        entries.append(Entry(path: path, data: data, compress: compress))
+    }
+
+    func addEntry(_ path:String, string:String, compress:Bool = true) {
+        addEntry(path, data: Data(string.utf8), compress: compress)
+    }
+
+    /// Writes the whole archive to given stream. The stream has to be opened by the caller.
+    func write(to stream:OutputStream) -> Bool {
+        var prepared = prepareEntries()
+        let (date, time) = dosDateTime(Date())
+
+        var offset:UInt32 = 0
+
+        // Local file headers and contents
+        for i in 0..<prepared.count {
+            prepared[i].offset = offset
+
+            let entry = prepared[i]
+            var header = Data()
+            header.append(uint32: 0x04034b50)
+            header.append(uint16: 20) // Version needed to extract
+            header.append(uint16: Self.flagUTF8)
+            header.append(uint16: entry.method)
+            header.append(uint16: time)
+            header.append(uint16: date)
+            header.append(uint32: entry.crc)
+            header.append(uint32: UInt32(entry.payload.count))
+            header.append(uint32: entry.uncompressedSize)
+            header.append(uint16: UInt16(entry.path.count))
+            header.append(uint16: 0) // Extra field length
+            header.append(entry.path)
+
+            guard stream.write(header), stream.write(entry.payload) else { return false }
+            offset += UInt32(header.count + entry.payload.count)
+        }
+
+        // Central directory
+        var directory = Data()
+        for entry in prepared {
+            directory.append(uint32: 0x02014b50)
+            directory.append(uint16: 0x031E) // Made by: Unix, spec version 3.0
+            directory.append(uint16: 20)
+            directory.append(uint16: Self.flagUTF8)
+            directory.append(uint16: entry.method)
+            directory.append(uint16: time)
+            directory.append(uint16: date)
+            directory.append(uint32: entry.crc)
+            directory.append(uint32: UInt32(entry.payload.count))
+            directory.append(uint32: entry.uncompressedSize)
+            directory.append(uint16: UInt16(entry.path.count))
+            directory.append(uint16: 0) // Extra field length
+            directory.append(uint16: 0) // Comment length
+            directory.append(uint16: 0) // Disk number
+            directory.append(uint16: 0) // Internal attributes
+            directory.append(uint32: 0o100644 << 16) // External attributes: regular file, rw-r--r--
+            directory.append(uint32: entry.offset)
+            directory.append(entry.path)
+        }
+
+        // End of central directory record
+        var end = Data()
+        end.append(uint32: 0x06054b50)
+        end.append(uint16: 0) // Number of this disk
+        end.append(uint16: 0) // Disk where central directory starts
+        end.append(uint16: UInt16(prepared.count))
+        end.append(uint16: UInt16(prepared.count))
+        end.append(uint32: UInt32(directory.count))
+        end.append(uint32: offset)
+        end.append(uint16: 0) // Comment length
+
+        return stream.write(directory) && stream.write(end)
+    }
+
+    /// Returns the archive as data
+    func data() -> Data? {
+        let stream = OutputStream.toMemory()
+        stream.open()
+        defer { stream.close() }
+
+        guard write(to: stream) else {
+            print("ZIP writer: writing failed", stream.streamError ?? "")
+            return nil
+        }
+
+        return stream.property(forKey: .dataWrittenToMemoryStreamKey) as? Data
+    }
+
+
+    // MARK: - Compression
+
+    /// Calculates checksums and deflates all entries concurrently
+    private func prepareEntries() -> [PreparedEntry] {
+        var prepared = [PreparedEntry?](repeating: nil, count: entries.count)
+        let lock = NSLock()
+
+        DispatchQueue.concurrentPerform(iterations: entries.count) { i in
+            let entry = entries[i]
+            let crc = Self.crc32(entry.data)
+
+            var payload = entry.data
+            var method = Self.methodStored
+
+            if entry.compress, let deflated = Self.deflate(entry.data) {
+                payload = deflated
+                method = Self.methodDeflate
+            }
+
+            let item = PreparedEntry(path: Data(entry.path.utf8), payload: payload, crc: crc, uncompressedSize: UInt32(entry.data.count), method: method)
+
+            lock.lock()
+            prepared[i] = item
+            lock.unlock()
+        }
+
+        return prepared.compactMap { $0 }
+    }
+
+    /// Returns raw DEFLATE data, or `nil` if compressing didn't make the data any smaller
+    private static func deflate(_ data:Data) -> Data? {
+        guard data.count > 0 else { return nil }
+
+        let capacity = data.count
+        var result = Data(count: capacity)
+
+        // COMPRESSION_ZLIB produces a raw deflate stream without zlib headers, which is exactly what ZIP expects
+        let size = result.withUnsafeMutableBytes { (dst:UnsafeMutableRawBufferPointer) -> Int in
+            data.withUnsafeBytes { (src:UnsafeRawBufferPointer) -> Int in
+                compression_encode_buffer(dst.bindMemory(to: UInt8.self).baseAddress!, capacity,
+                                          src.bindMemory(to: UInt8.self).baseAddress!, data.count,
+                                          nil, COMPRESSION_ZLIB)
+            }
+        }
+
+        // Zero means the buffer was too small, ie. the result would have been larger than the original
+        guard size > 0 else { return nil }
+        result.count = size
+        return result
+    }
+
+    private static let crcTable:[UInt32] = (0..<256).map { n in
+        var c = UInt32(n)
+        for _ in 0..<8 {
+            c = (c & 1 != 0) ? (0xEDB88320 ^ (c >> 1)) : (c >> 1)
+        }
+        return c
+    }
+
+    private static func crc32(_ data:Data) -> UInt32 {
+        var crc:UInt32 = 0xFFFFFFFF
+        crcTable.withUnsafeBufferPointer { table in
+            data.withUnsafeBytes { (bytes:UnsafeRawBufferPointer) in
+                for byte in bytes {
+                    crc = table[Int((crc ^ UInt32(byte)) & 0xFF)] ^ (crc >> 8)
+                }
+            }
+        }
+        return crc ^ 0xFFFFFFFF
+    }
+
+    /// MS-DOS date and time fields
+    private func dosDateTime(_ date:Date) -> (date:UInt16, time:UInt16) {
+        let c = Calendar.current.dateComponents([.year, .month, .day, .hour, .minute, .second], from: date)
+        let year = max((c.year ?? 1980) - 1980, 0)
+        let dosDate = UInt16(year << 9 | (c.month ?? 1) << 5 | (c.day ?? 1))
+        let dosTime = UInt16((c.hour ?? 0) << 11 | (c.minute ?? 0) << 5 | (c.second ?? 0) / 2)
+        return (dosDate, dosTime)
+    }
+}
+
+fileprivate extension Data {
+    mutating func append(uint16 value:UInt16) {
+        append(UInt8(value & 0xFF))
+        append(UInt8(value >> 8))
+    }
+
+    mutating func append(uint32 value:UInt32) {
+        append(uint16: UInt16(value & 0xFFFF))
+        append(uint16: UInt16(value >> 16))
+    }
+}
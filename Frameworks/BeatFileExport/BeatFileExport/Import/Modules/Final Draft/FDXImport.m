@@ -10,6 +10,10 @@
  Turns Final Draft files into Fountain. There are certain quirks
  and some elements are not supported yet.
  
+ The file is read using libxml2 pull parser (`xmlTextReader`), so files are streamed from disk instead of
+ being loaded into memory first. Text is collected into a buffer and appended to the current element
+ only when an element starts or ends, to keep long paragraphs linear.
+ 
  */
 
 
@@ -22,10 +26,10 @@
 #import "FDXImport.h"
 #import "FDXElement.h"
 #import <BeatFileExport/BeatFDXExport.h>
+#import <libxml/xmlreader.h>
 
 
-@interface FDXImport () <NSXMLParserDelegate>
-@property(nonatomic, strong) NSXMLParser *xmlParser;
+@interface FDXImport ()
 
 @property (nonatomic) NSMutableAttributedString *attrContents;
 
@@ -34,7 +38,10 @@
 @property (nonatomic) bool insideParagraph;
 
 @property (nonatomic) NSString *lastFoundElement;
-@property (nonatomic) NSString *lastFoundString;
+/// Length of text found inside the current `<Text>` element
+@property (nonatomic) NSUInteger foundTextLength;
+/// Text waiting to be appended to current element
+@property (nonatomic) NSMutableString *pendingText;
 @property (nonatomic) FDXElement *lastAddedLine;
 @property (nonatomic) NSString *activeElement;
 @property (nonatomic) NSString *alignment;
@@ -93,6 +100,19 @@
         
 		[self setup];
 
+		// Local files are streamed straight from disk. The callback is called just like before: on macOS the URL was loaded
+		// asynchronously, so it's called on a background queue, and on iOS it's called synchronously before returning.
+		if (url.isFileURL) {
+#if TARGET_OS_OSX
+			dispatch_async(dispatch_get_global_queue(QOS_CLASS_USER_INITIATED, 0), ^{
+				[self parseFile:url callback:callback];
+			});
+#else
+			[self parseFile:url callback:callback];
+#endif
+			return self;
+		}
+		
 		// Thank you, RIPtutorial
 		// Fetch xml data
 #if TARGET_OS_OSX
@@ -132,6 +152,7 @@
 	self = [super init];
 	if (self) {
 		_importNotes = importNotes;
+		[self setup];
 		[self parse:data callback:callback];
 	}
 	
@@ -148,22 +169,92 @@
 	_attrContents = NSMutableAttributedString.new;
 	_notes = NSMutableArray.new;
     _tagDefinitions = NSMutableDictionary.new;
+	_pendingText = NSMutableString.new;
 }
 
+#define FDX_READER_OPTIONS (XML_PARSE_NONET | XML_PARSE_HUGE | XML_PARSE_NOERROR | XML_PARSE_NOWARNING)
+
 - (void)parse:(NSData*)data callback:(void(^)(NSString*))callback
 {
-	self.xmlParser = [[NSXMLParser alloc] initWithData:data];
-	self.xmlParser.delegate = self;
-        
-	if ([self.xmlParser parse]) {
-        if (callback != nil) callback(self.fountain);
+	xmlTextReaderPtr reader = xmlReaderForMemory(data.bytes, (int)data.length, NULL, NULL, FDX_READER_OPTIONS);
+	[self read:reader callback:callback];
+}
+
+- (void)parseFile:(NSURL*)url callback:(void(^)(NSString*))callback
+{
+	xmlTextReaderPtr reader = xmlReaderForFile(url.fileSystemRepresentation, NULL, FDX_READER_OPTIONS);
+	[self read:reader callback:callback];
+}
+
+/// Pulls nodes from the reader and passes them to element handlers
+- (void)read:(xmlTextReaderPtr)reader callback:(void(^)(NSString*))callback
+{
+	if (reader == NULL) {
+		self.errorMessage = @"Failed to open file";
+		NSLog(@"ERROR: %@", self.errorMessage);
+		return;
+	}
+	
+	int result;
+	while ((result = xmlTextReaderRead(reader)) == 1) {
+		int nodeType = xmlTextReaderNodeType(reader);
+		
+		if (nodeType == XML_READER_TYPE_ELEMENT) {
+			NSString* elementName = [self stringFromXML:xmlTextReaderConstName(reader)];
+			bool empty = xmlTextReaderIsEmptyElement(reader);
+			
+			NSMutableDictionary* attributes = NSMutableDictionary.new;
+			while (xmlTextReaderMoveToNextAttribute(reader) == 1) {
+				NSString* name = [self stringFromXML:xmlTextReaderConstName(reader)];
+				NSString* value = [self stringFromXML:xmlTextReaderConstValue(reader)];
+				if (name != nil && value != nil) attributes[name] = value;
+			}
+			
+			[self didStartElement:elementName attributes:attributes];
+			// Empty elements (<Text/>) don't have a separate end node
+			if (empty) [self didEndElement:elementName];
+		}
+		else if (nodeType == XML_READER_TYPE_END_ELEMENT) {
+			[self didEndElement:[self stringFromXML:xmlTextReaderConstName(reader)]];
+		}
+		else if (nodeType == XML_READER_TYPE_TEXT ||
+				 nodeType == XML_READER_TYPE_CDATA ||
+				 nodeType == XML_READER_TYPE_WHITESPACE ||
+				 nodeType == XML_READER_TYPE_SIGNIFICANT_WHITESPACE) {
+			NSString* string = [self stringFromXML:xmlTextReaderConstValue(reader)];
+			if (string != nil) [self foundCharacters:string];
+		}
+	}
+	
+	xmlFreeTextReader(reader);
+	
+	if (result == 0) {
+		if (callback != nil) callback(self.fountain);
 	} else {
-		NSLog(@"ERROR: %@", self.xmlParser.parserError);
+		const xmlError* error = xmlGetLastError();
+		self.errorMessage = (error != NULL && error->message != NULL) ? [NSString stringWithUTF8String:error->message] : @"Failed to parse FDX file";
+		NSLog(@"ERROR: %@", self.errorMessage);
 	}
 }
 
-- (void)parser:(NSXMLParser *)parser didStartElement:(NSString *)elementName namespaceURI:(nullable NSString *)namespaceURI qualifiedName:(nullable NSString *)qName attributes:(NSDictionary<NSString *, NSString *> *)attributeDict
+- (NSString*)stringFromXML:(const xmlChar*)string
+{
+	if (string == NULL) return nil;
+	return [NSString.alloc initWithBytes:string length:strlen((const char*)string) encoding:NSUTF8StringEncoding];
+}
+
+/// Appends collected text to the current element in one go
+- (void)flushPendingText
+{
+	if (_pendingText.length == 0) return;
+	
+	[_element append:_pendingText.copy];
+	[_pendingText setString:@""];
+}
+
+- (void)didStartElement:(NSString *)elementName attributes:(NSDictionary<NSString *, NSString *> *)attributeDict
 {
+	[self flushPendingText];
 	_lastFoundElement = elementName;
 
 	// Find different sections of the XML
@@ -215,7 +306,7 @@
 	}
 	else if ([elementName isEqualToString:@"Text"]) {
 		_didFinishText = NO;
-		_lastFoundString = @"";
+		_foundTextLength = 0;
 		_textStyle = attributeDict[@"Style"];
 		_revisionID = attributeDict[@"RevisionID"];
         _tag = attributeDict[@"TagNumber"];
@@ -247,7 +338,7 @@
     }
 }
 
-- (void)parser:(NSXMLParser *)parser foundCharacters:(NSString *)string
+- (void)foundCharacters:(NSString *)string
 {
 	// Let's ignore title page and other non-content stuff
 	if (_section == FDXSectionNone || _section == FDXSectionTitlePage) return;
@@ -258,21 +349,23 @@
 		
 		if ([_lastFoundElement isEqualToString:@"Text"]) {
 			// If we're inside a text element, add the text to element
-			[_element append:string];
+			[_pendingText appendString:string];
 		}
 		else {
 			// Otherwise, we need to trim the string. I think this is here for pre-FD12 compatibility?
 			NSString *trimmedString = [string stringByTrimmingCharactersInSet:NSCharacterSet.whitespaceAndNewlineCharacterSet];
-			[_element append:trimmedString];
+			[_pendingText appendString:trimmedString];
 		}
 		
-		// Save the string for later use
-		_lastFoundString = [_lastFoundString stringByAppendingString:string];
+		// Save the length for later use
+		_foundTextLength += string.length;
 	}
 }
 
-- (void)parser:(NSXMLParser *)parser didEndElement:(NSString *)elementName namespaceURI:(nullable NSString *)namespaceURI qualifiedName:(nullable NSString *)qName
+- (void)didEndElement:(NSString *)elementName
 {
+	[self flushPendingText];
+	
 	// End sections
 	if ([elementName isEqualToString:@"TitlePage"]) {
 		_titlePage = NO;
@@ -315,8 +408,8 @@
 	_lastFoundElement = @"";
 	_didFinishText = YES;
 	
-	if (_lastFoundString.length) {
-		NSRange range = (NSRange){ _element.length - _lastFoundString.length, _lastFoundString.length };
+	if (_foundTextLength > 0) {
+		NSRange range = (NSRange){ _element.length - _foundTextLength, _foundTextLength };
 		
 		if (_textStyle) {
 			[_element addStyle:_textStyle to:range];
@@ -456,7 +549,7 @@
 		NSRange lineRange = NSMakeRange(pos, length);
 		
 		// Insert notes
-		if (_importNotes && [self range:lineRange containsAnyIndex:noteIndices]) {
+		if (_importNotes && [noteIndices intersectsIndexesInRange:lineRange]) {
 			for (FDXNote* note in _notes) {
 				if (!NSLocationInRange(note.range.location, lineRange)) continue;
 				NSAttributedString* aNote = [NSAttributedString.alloc initWithString:note.noteString];
@@ -494,14 +587,6 @@
 	return [NSString stringWithFormat:@"%@\n%@", attributedScript.string, [settings getSettingsString]];
 }
 
-- (bool)range:(NSRange)range containsAnyIndex:(NSIndexSet*)set
-{
-	for (NSInteger i=range.location; i<NSMaxRange(range); i++) {
-		if ([set containsIndex:i]) return true;
-	}
-	return false;
-}
-
 - (NSString*)fountain
 {
     return self.scriptAsString;
@@ -0,0 +1,400 @@
+//
+//  PDFImportLayout.swift
+//  BeatFileExport
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+/**
+
+ Layout reconstruction for PDF import. This file doesn't depend on PDFKit: input is a plain stream of glyphs (character, bounds and page number), which can be recorded from a PDF and replayed headlessly.
+
+ Each page is processed by a single-pass state machine (`PDFPageLayout`), which detects line breaks from glyph positions and turns lines into Fountain elements. Page text is stored as an array of __runs__, each run being one inserted line with its position, so orphaned lines can be placed without walking through the whole page character by character.
+
+ Pages are independent apart from two values:
+ - line height, which only depends on glyph heights, so starting value for each page can be calculated up front
+ - title page, which is only detected on the first page
+
+ The first page is laid out first, and the rest in parallel. Results are then merged in page order.
+
+ */
+
+import Foundation
+
+/// A single character on a PDF page
+struct PDFGlyph: Codable {
+    /// UTF-16 unit
+    var character: UInt16
+    var rect: CGRect
+    var page: Int
+}
+
+enum PDFImportLayout {
+    /// Returns Fountain text for given pages of glyphs
+    static func fountain(from pages: [[PDFGlyph]]) -> String {
+        guard pages.count > 0 else { return "" }
+
+        // Calculate line height at the start of each page
+        var startHeights: [Double] = []
+        var height = 0.0
+        for (pageNumber, glyphs) in pages.enumerated() {
+            startHeights.append(height)
+            for glyph in glyphs { height = updatedLineHeight(height, glyph: glyph.rect, pageNumber: pageNumber) }
+        }
+
+        var texts = [String](repeating: "", count: pages.count)
+
+        // Title page can only be found on the first page, and it affects every page after that
+        let firstPage = PDFPageLayout(pageNumber: 0, lineHeight: startHeights[0], titlePageFound: false)
+        texts[0] = firstPage.process(pages[0])
+        let titlePageFound = firstPage.titlePageFound
+
+        let lock = NSLock()
+        DispatchQueue.concurrentPerform(iterations: pages.count - 1) { i in
+            let pageNumber = i + 1
+            let layout = PDFPageLayout(pageNumber: pageNumber, lineHeight: startHeights[pageNumber], titlePageFound: titlePageFound)
+            let text = layout.process(pages[pageNumber])
+
+            lock.lock()
+            texts[pageNumber] = text
+            lock.unlock()
+        }
+
+        return cleanOutput(merge(texts, titlePageFound: titlePageFound))
+    }
+
+    /// Merges pages in order. A paragraph running over a page break ends with a joining space, so it continues on the next page as is.
+    static func merge(_ pages: [String], titlePageFound: Bool) -> String {
+        var text = ""
+        for page in pages {
+            text += page
+            if titlePageFound { text += "\n" }
+        }
+        return text
+    }
+
+    /// Store line height if needed. We'll be gratitious on the first page because you might have something weird going on in title page, such as images or bigger title text.
+    static func updatedLineHeight(_ height: Double, glyph: CGRect, pageNumber: Int) -> Double {
+        if height == 0.0 || height < 11.0 || height > 18.0 || pageNumber == 0 { return glyph.height }
+        return height
+    }
+
+    static func cleanOutput(_ string: String) -> String {
+        // Clear double spaces and triple line breaks
+        var cleanedText = string.replacingOccurrences(of: #"[ ]{2,}"#, with: " ", options: .regularExpression)
+        cleanedText = cleanedText.replacingOccurrences(of: #"(?:\n\s\r*){3,}"#, with: "\n\n", options: .regularExpression)
+        // Some brute forcing in case the regex doesn't work, he he
+        cleanedText = cleanedText.replacingOccurrences(of: "\n\n\n", with: "\n\n")
+        cleanedText = cleanedText.replacingOccurrences(of: "\n\n\n", with: "\n\n")
+
+        return cleanedText
+    }
+}
+
+/// Rebuilds the text of a single page from its glyphs
+final class PDFPageLayout {
+    /// A line inserted on the page. Line breaks are stored as runs without position.
+    struct Run {
+        var text: String
+        var position: CGPoint?
+    }
+
+    let pageNumber: Int
+    private(set) var titlePageFound: Bool
+    /// Single character height
+    private(set) var chrHeight: Double
+
+    /// This flag determines whether the upcoming line is not linearly in its correct Y position.
+    private var nextLineIsOrphaned = false
+    /// Previously found text bounds
+    private var previousRect: CGRect = .zero
+    /// Flag for checking if we're in the middle of dialogue
+    private var dialogue = false
+
+    private(set) var runs: [Run] = []
+
+    init(pageNumber: Int, lineHeight: Double, titlePageFound: Bool) {
+        self.pageNumber = pageNumber
+        self.chrHeight = lineHeight
+        self.titlePageFound = titlePageFound
+    }
+
+    var text: String {
+        return runs.map { $0.text }.joined()
+    }
+
+    /// Processes the glyphs and returns page text
+    func process(_ glyphs: [PDFGlyph]) -> String {
+        // Current line and X position
+        var line: [UInt16] = []
+        var lineHasContent = false
+        var lineX = -1.0
+
+        for glyph in glyphs {
+            let chr = glyph.character
+            let chrBounds = glyph.rect
+
+            chrHeight = PDFImportLayout.updatedLineHeight(chrHeight, glyph: chrBounds, pageNumber: pageNumber)
+            let hadContent = lineHasContent
+
+            // Calculating offset to the previous line is the best way to determine whether this is a new line element.
+            let offset = previousRect.origin.y - chrBounds.origin.y
+            let limit = chrHeight - 2.0
+
+            // We've encountered a line break
+            if abs(offset) > limit {
+                let trimmedLine = String(decoding: line, as: UTF16.self).trimmingCharacters(in: .whitespacesAndNewlines)
+                line.removeAll(keepingCapacity: true)
+                lineHasContent = false
+
+                // Page numbers will be ignored altogether.
+                if shouldSkipLine(trimmedLine) { continue }
+
+                appendLine(trimmedLine, offset: offset, limit: limit)
+                lineX = -1
+            }
+
+            // Append the character to the line, unless it's a newline
+            if chr != 0x0A && chr != 0x0D {
+                line.append(chr)
+                if chrBounds.width > 0 {
+                    previousRect = chrBounds
+                    previousRect.origin.x = lineX
+                }
+
+                if chr != 0x20, hadContent {
+                    lineX = chrBounds.origin.x
+                }
+
+                if !Self.isWhitespace(chr) { lineHasContent = true }
+            }
+        }
+
+        // If something was left over, add it here
+        if line.count > 0 {
+            appendLine(String(decoding: line, as: UTF16.self).trimmingCharacters(in: .whitespaces), offset: 0.0, limit: chrHeight - 2.0)
+        }
+
+        return text
+    }
+
+    static func isWhitespace(_ chr: UInt16) -> Bool {
+        guard let scalar = Unicode.Scalar(chr) else { return false }
+        return CharacterSet.whitespacesAndNewlines.contains(scalar)
+    }
+
+
+    // MARK: - Elements
+
+    func appendLine(_ string: String, offset: CGFloat, limit: CGFloat) {
+        var trimmedLine = string
+        var lineBreaks = 0
+
+        // If this line is not orphaned, just add it. Otherwise we need to find a place for it.
+        let location = (!nextLineIsOrphaned && trimmedLine.count > 0) ? runs.count : findPositionFor(string)
+        if location == NSNotFound { return }
+
+        // Handle headings
+        trimmedLine = handleHeadings(trimmedLine, location: location)
+
+        // Check offset amount. If it's > 2 line heights, it's a full paragraph change. Otherwise we'll determine if it's a character cue or parenthetical line.
+        if offset > 2 * limit {
+            // Paragraph break
+            dialogue = false
+            lineBreaks = 2
+        } else if offset > limit {
+            // Normal, single line break. We won't add these unless it's a dialogue block of some sorts.
+            let dialogueResult = handleDialogue(trimmedLine, location: location)
+            trimmedLine = dialogueResult.string
+            lineBreaks = dialogueResult.lineBreaks
+        }
+
+        // Handle title page separately
+        if pageNumber == 0 {
+            let pageText = text
+
+            if !titlePageFound, pageText.trimmingCharacters(in: .whitespaces).count == 0, trimmedLine.count > 0, trimmedLine.isAllUppercase, Self.parseSceneHeading(trimmedLine) == nil {
+                titlePageFound = true
+                trimmedLine = "Title: " + trimmedLine
+            } else if titlePageFound {
+                let lines = pageText.split(separator: "\n")
+                if lines.count > 0 {
+                    if trimmedLine.lowercased().contains("written by") || trimmedLine.lowercased() == "by" {
+                        trimmedLine = "Credit: " + trimmedLine
+                    } else if trimmedLine.contains("@"), !pageText.contains("Contact:") {
+                        trimmedLine = "Contact: " + trimmedLine
+                    } else if lines.count > 0, lines.count < 3, !pageText.contains("Author:") {
+                        trimmedLine = "Author: " + trimmedLine
+                    }
+                }
+            }
+            if titlePageFound { lineBreaks = 1 }
+        }
+
+        // If there are no line breaks, join the lines with spaces (unless there's already a space or a hyphen)
+        if lineBreaks == 0, trimmedLine.count > 0, trimmedLine.last != " ", trimmedLine.last != "-" {
+            trimmedLine += " "
+        }
+
+        if trimmedLine.count > 0 {
+            runs.insert(Run(text: trimmedLine, position: previousRect.origin), at: location)
+        }
+
+        // If the offset is NEGATIVE, we have now encountered a line which is supposed to be somewhere much higher on the page.
+        // On the next iteration, we'll try to find a place for it.
+        nextLineIsOrphaned = (offset < 0 && previousRect.origin.y > 0)
+
+        // Add line breaks to page text
+        if trimmedLine.count > 0, lineBreaks > 0 {
+            runs.append(Run(text: String(repeating: "\n", count: lineBreaks), position: nil))
+        }
+    }
+
+    /// In some cases we might have ended up with an orphaned element. We'll now investigate where it should actually lie. Returns a run index.
+    func findPositionFor(_ string: String) -> Int {
+        if string.count == 0 || Self.isPageNumber(string) { return NSNotFound }
+
+        // Walk through positioned lines backwards. Adjacent runs with the same position are handled as a single range.
+        var previousRange: Range<Int>? = nil
+        var i = runs.count - 1
+
+        while i >= 0 {
+            guard let position = runs[i].position else {
+                i -= 1
+                continue
+            }
+
+            var start = i
+            while start > 0, let p = runs[start - 1].position, p == position { start -= 1 }
+            let range = start..<(i + 1)
+
+            if position.y == previousRect.origin.y {
+                return (previousRect.origin.x > position.x) ? range.upperBound : range.lowerBound
+            } else if position.y > previousRect.origin.y {
+                guard let previousRange else { return runs.count }
+                return (previousRect.origin.x > position.x) ? previousRange.upperBound : previousRange.lowerBound
+            }
+
+            previousRange = range
+            i = start - 1
+        }
+
+        return runs.count
+    }
+
+    /// Returns `true` if the text before given run index ends with a line break
+    func lineBreakBefore(_ location: Int) -> Bool {
+        guard location > 0, location <= runs.count else { return false }
+        return runs[location - 1].text.utf16.last == 0x0A
+    }
+
+    func handleHeadings(_ string: String, location: Int) -> String {
+        var result = string
+        if let heading = Self.parseSceneHeading(result) {
+            result = heading.heading.trimmingCharacters(in: .whitespaces)
+            if heading.number.count > 0 { result += " #\(heading.number)#" }
+            if !lineBreakBefore(location) { result = "\n" + result }
+
+            result += "\n\n"
+        }
+
+        return result
+    }
+
+    func handleDialogue(_ string: String, location: Int) -> (string: String, lineBreaks: Int) {
+        var result = string
+        var lineBreaks = 0
+
+        if Self.mightBeCharacter(string) {
+            if !lineBreakBefore(location) {
+                result = "\n" + result
+            }
+            dialogue = true
+            lineBreaks = 1
+        } else if dialogue, string.first == "(" {
+            if !lineBreakBefore(location) { result = "\n" + result }
+            if string.last == ")" { lineBreaks = 1 }
+        } else if dialogue, string.last == ")" {
+            lineBreaks = 1
+        }
+
+        return (result, lineBreaks)
+    }
+
+    func shouldSkipLine(_ string: String) -> Bool {
+        return Self.isPageNumber(string) || string == "(MORE)"
+    }
+
+
+    // MARK: - Element checks
+
+    private static let sceneHeadingRegex = try? NSRegularExpression(pattern: #"^(\d+)?\s*(INT|EXT)\. (.+?)(\s*\d+)?$"#, options: .caseInsensitive)
+    private static let pageNumberRegex = try? NSRegularExpression(pattern: #"^\d+\.$|^pg\.\s*\d+$"#)
+
+    static func parseSceneHeading(_ input: String) -> (heading: String, number: String)? {
+        guard let regex = sceneHeadingRegex else { return nil }
+
+        let range = NSRange(location: 0, length: input.utf16.count)
+
+        if let match = regex.firstMatch(in: input, options: [], range: range) {
+            // Extract the optional starting number
+            let numberStartRange = match.range(at: 1)
+            let numberStart = numberStartRange.location != NSNotFound ? (input as NSString).substring(with: numberStartRange) : nil
+
+            // Extract the scene type (INT or EXT)
+            let sceneType = (input as NSString).substring(with: match.range(at: 2))
+
+            // Extract the description part
+            let description = (input as NSString).substring(with: match.range(at: 3)).trimmingCharacters(in: .whitespaces)
+
+            // Extract the optional ending number
+            let numberEndRange = match.range(at: 4)
+            let numberEnd = numberEndRange.location != NSNotFound ? (input as NSString).substring(with: numberEndRange).trimmingCharacters(in: .whitespaces) : nil
+
+            // Check if there's a matching starting and ending number, or if either is nil
+            if numberStart == numberEnd || numberEnd == nil {
+                let heading = "\(sceneType). \(description)"
+                return (heading, numberStart ?? "")
+            }
+        }
+
+        return nil
+    }
+
+    static func isPageNumber(_ input: String) -> Bool {
+        guard let regex = pageNumberRegex else { return false }
+
+        let range = NSRange(location: 0, length: input.utf16.count)
+        return regex.firstMatch(in: input, options: [], range: range) != nil
+    }
+
+    static func mightBeCharacter(_ input: String) -> Bool {
+        var parentheses = false
+        if input.count == 0 || input.first == "(" {
+            return false
+        }
+
+        return input.allSatisfy({ char in
+            if parentheses || char.isUppercase || char.isWhitespace {
+                return true
+            } else if char == "(", input.first != "(" {
+                parentheses = true
+                return true
+            } else if char == ")" {
+                parentheses = false
+                return true
+            } else if char.isPunctuation, char != ",", char != ":", char != "!" {
+                return true
+            } else {
+                return false
+            }
+        })
+    }
+}
+
+private extension String {
+    var isAllUppercase: Bool {
+        self.allSatisfy { chr in
+            return !chr.isLowercase
+        }
+    }
+}
@@ -16,6 +16,7 @@
 #import <BeatParsing/ContinuousFountainParser+Omissions.h>
 #import <BeatParsing/ContinuousFountainParser+Lookup.h>
 #import <BeatParsing/ContinuousFountainParser+Macros.h>
+#import <BeatParsing/ContinuousFountainParser+Indexes.h>
 #import <BeatParsing/ContinuousFountainParser+TitlePage.h>
 #import <BeatParsing/ContinuousFountainParser+LineIdentifiers.h>
 
@@ -31,6 +32,7 @@
 #import <BeatParsing/Line+Macros.h>
 
 #import <BeatParsing/OutlineScene.h>
+#import <BeatParsing/BeatCompletionIndex.h>
 #import <BeatParsing/FountainRegexes.h>
 #import <BeatParsing/BeatDocumentSettings.h>
 #import <BeatParsing/BeatDocumentSettings+Shorthands.h>
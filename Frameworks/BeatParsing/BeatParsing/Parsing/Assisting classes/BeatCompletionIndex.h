@@ -0,0 +1,38 @@
+//
+//  BeatCompletionIndex.h
+//  BeatParsing
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+#import <Foundation/Foundation.h>
+
+@class Line;
+
+NS_ASSUME_NONNULL_BEGIN
+
+/// Counts occurrences of keys (such as character names or scene headings) in lines. The parser keeps the index up to date while parsing, so collecting names doesn't require iterating through the whole document.
+@interface BeatCompletionIndex : NSObject
+
+/// Number of distinct keys
+@property (nonatomic, readonly) NSUInteger count;
+
+/// Stores the key for given line, replacing whatever the line had before. Search key is the normalized form used for prefix lookups. Pass `nil` to remove the line from index.
+- (void)setKey:(NSString* _Nullable)key searchKey:(NSString* _Nullable)searchKey forLine:(Line*)line;
+/// Returns the key stored for given line
+- (NSString* _Nullable)keyForLine:(Line*)line;
+/// Number of lines with given key
+- (NSInteger)countForKey:(NSString*)key;
+
+/// Returns distinct search keys beginning with given prefix, most frequent first. An empty prefix returns all search keys. Occurrences on the excluded line are not counted.
+- (NSArray<NSString*>*)completionsForPrefix:(NSString*)prefix excludingLine:(Line* _Nullable)line;
+/// All keys, most frequent first. Occurrences on the excluded line are not counted.
+- (NSArray<NSString*>*)keysByFrequencyExcludingLine:(Line* _Nullable)line;
+/// All keys in alphabetical order. Occurrences on the excluded line are not counted.
+- (NSArray<NSString*>*)sortedKeysExcludingLine:(Line* _Nullable)line;
+
+- (void)removeAllKeys;
+
+@end
+
+NS_ASSUME_NONNULL_END
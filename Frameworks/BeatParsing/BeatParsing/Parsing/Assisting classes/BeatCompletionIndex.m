@@ -0,0 +1,194 @@
+//
+//  BeatCompletionIndex.m
+//  BeatParsing
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+/**
+ 
+ Keys are kept in an array sorted by their search key, which lets us find every key with a given prefix using binary search,
+ without iterating through all the names. Because only the matching keys are ranked by frequency, completions stay fast even
+ in scripts with hundreds of characters.
+ 
+ */
+
+#import "BeatCompletionIndex.h"
+
+@interface BeatCompletionIndex ()
+@property (nonatomic) NSMapTable<Line*, NSString*>* lineKeys;
+@property (nonatomic) NSMutableDictionary<NSString*, NSNumber*>* counts;
+@property (nonatomic) NSMutableDictionary<NSString*, NSString*>* searchKeys;
+/// Keys sorted by search key
+@property (nonatomic) NSMutableArray<NSString*>* sortedKeys;
+@end
+
+@implementation BeatCompletionIndex
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _lineKeys = NSMapTable.weakToStrongObjectsMapTable;
+        _counts = NSMutableDictionary.new;
+        _searchKeys = NSMutableDictionary.new;
+        _sortedKeys = NSMutableArray.new;
+    }
+    return self;
+}
+
+- (NSUInteger)count
+{
+    return _counts.count;
+}
+
+- (void)removeAllKeys
+{
+    [_lineKeys removeAllObjects];
+    [_counts removeAllObjects];
+    [_searchKeys removeAllObjects];
+    [_sortedKeys removeAllObjects];
+}
+
+
+#pragma mark - Updating
+
+- (void)setKey:(NSString*)key searchKey:(NSString*)searchKey forLine:(Line*)line
+{
+    if (line == nil) return;
+    if (key.length == 0) key = nil;
+    
+    NSString* oldKey = [_lineKeys objectForKey:line];
+    if (oldKey == key || [oldKey isEqualToString:key]) return;
+    
+    if (oldKey != nil) {
+        [_lineKeys removeObjectForKey:line];
+        [self decrementKey:oldKey];
+    }
+    
+    if (key != nil) {
+        [_lineKeys setObject:key forKey:line];
+        [self incrementKey:key searchKey:(searchKey != nil) ? searchKey : key];
+    }
+}
+
+- (void)incrementKey:(NSString*)key searchKey:(NSString*)searchKey
+{
+    NSInteger count = _counts[key].integerValue;
+    _counts[key] = @(count + 1);
+    if (count > 0) return;
+    
+    // A new key, add it to sorted keys
+    _searchKeys[key] = searchKey;
+    NSUInteger i = [_sortedKeys indexOfObject:key inSortedRange:NSMakeRange(0, _sortedKeys.count) options:NSBinarySearchingInsertionIndex usingComparator:self.comparator];
+    [_sortedKeys insertObject:key atIndex:i];
+}
+
+- (void)decrementKey:(NSString*)key
+{
+    NSInteger count = _counts[key].integerValue - 1;
+    if (count > 0) {
+        _counts[key] = @(count);
+        return;
+    }
+    
+    // No more occurrences, remove the key
+    NSUInteger i = [_sortedKeys indexOfObject:key inSortedRange:NSMakeRange(0, _sortedKeys.count) options:NSBinarySearchingFirstEqual usingComparator:self.comparator];
+    if (i != NSNotFound) [_sortedKeys removeObjectAtIndex:i];
+    
+    [_counts removeObjectForKey:key];
+    [_searchKeys removeObjectForKey:key];
+}
+
+/// Sorts keys by search key, and then by the key itself
+- (NSComparator)comparator
+{
+    NSDictionary<NSString*, NSString*>* searchKeys = _searchKeys;
+    return ^NSComparisonResult(NSString* key1, NSString* key2) {
+        NSComparisonResult result = [searchKeys[key1] compare:searchKeys[key2]];
+        return (result != NSOrderedSame) ? result : [key1 compare:key2];
+    };
+}
+
+
+#pragma mark - Lookup
+
+- (NSString*)keyForLine:(Line*)line
+{
+    return [_lineKeys objectForKey:line];
+}
+
+- (NSInteger)countForKey:(NSString*)key
+{
+    return _counts[key].integerValue;
+}
+
+/// Returns the number of occurrences without the given line
+- (NSInteger)countForKey:(NSString*)key excludingLine:(Line*)line
+{
+    NSInteger count = _counts[key].integerValue;
+    if (line != nil && [[_lineKeys objectForKey:line] isEqualToString:key]) count -= 1;
+    return count;
+}
+
+- (NSArray<NSString*>*)completionsForPrefix:(NSString*)prefix excludingLine:(Line*)line
+{
+    // Find the first search key which is equal to or larger than the prefix
+    NSInteger lo = 0, hi = _sortedKeys.count;
+    while (lo < hi) {
+        NSInteger mid = (lo + hi) / 2;
+        if ([_searchKeys[_sortedKeys[mid]] compare:prefix] == NSOrderedAscending) lo = mid + 1;
+        else hi = mid;
+    }
+    
+    // Every key with the prefix follows, and keys sharing a search key are next to each other
+    NSMutableArray<NSString*>* completions = NSMutableArray.new;
+    NSMutableDictionary<NSString*, NSNumber*>* counts = NSMutableDictionary.new;
+    
+    // An empty prefix matches everything (note that -hasPrefix: returns NO for an empty string)
+    bool matchAll = (prefix.length == 0);
+    
+    for (NSInteger i = lo; i < _sortedKeys.count; i++) {
+        NSString* key = _sortedKeys[i];
+        NSString* searchKey = _searchKeys[key];
+        if (!matchAll && ![searchKey hasPrefix:prefix]) break;
+        
+        NSInteger count = [self countForKey:key excludingLine:line];
+        if (count == 0 || searchKey.length == 0) continue;
+        
+        if (counts[searchKey] == nil) [completions addObject:searchKey];
+        counts[searchKey] = @(counts[searchKey].integerValue + count);
+    }
+    
+    return [self sortByFrequency:completions counts:counts];
+}
+
+- (NSArray<NSString*>*)keysByFrequencyExcludingLine:(Line*)line
+{
+    NSArray<NSString*>* keys = [self sortedKeysExcludingLine:line];
+    NSMutableDictionary<NSString*, NSNumber*>* counts = [NSMutableDictionary dictionaryWithCapacity:keys.count];
+    for (NSString* key in keys) counts[key] = @([self countForKey:key excludingLine:line]);
+    
+    return [self sortByFrequency:keys counts:counts];
+}
+
+- (NSArray<NSString*>*)sortedKeysExcludingLine:(Line*)line
+{
+    NSMutableArray<NSString*>* keys = [NSMutableArray arrayWithCapacity:_counts.count];
+    for (NSString* key in _counts) {
+        if ([self countForKey:key excludingLine:line] > 0) [keys addObject:key];
+    }
+    
+    [keys sortUsingSelector:@selector(compare:)];
+    return keys;
+}
+
+/// Most frequent first. The sort is stable, so items with equal counts keep their order.
+- (NSArray<NSString*>*)sortByFrequency:(NSArray<NSString*>*)items counts:(NSDictionary<NSString*, NSNumber*>*)counts
+{
+    return [items sortedArrayWithOptions:NSSortStable usingComparator:^NSComparisonResult(NSString* a, NSString* b) {
+        return [counts[b] compare:counts[a]];
+    }];
+}
+
+@end
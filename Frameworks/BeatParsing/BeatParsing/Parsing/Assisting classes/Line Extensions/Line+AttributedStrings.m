@@ -93,6 +93,7 @@
     // Add font stylization. We iterate through formatting range types (the last enum is a count value) and apply the style names.
     for (NSUInteger i=0; i<(NSUInteger)FormattingRangeCount; i++) {
         FormattedRange formatting = (FormattedRange)i;
+        if ([self formattingIsEmpty:formatting]) continue;
         
         NSMutableIndexSet* indices = [self formattedRange:formatting];
         InlineFormatting* f = InlineFormatting.inlineFormats[@(formatting)];
@@ -7,11 +7,16 @@
 
 #import <BeatParsing/BeatParsing.h>
 
+@class BeatCompiledMacro;
+
 NS_ASSUME_NONNULL_BEGIN
 
 @interface Line (Macros)
 /// Parses and resolves macros on a line and stores the parsed content in  `resolvedMacros` dictionary, mapped to macro range key. The actual values are stored as attributes and only replaced when rendering to attributed string.
-- (void)resolveMacrosWithParser:(BeatMacroParser*)macroParser;
+/// @returns `true` if the resolved values changed
+- (bool)resolveMacrosWithParser:(BeatMacroParser*)macroParser;
+/// Macros on this line in order of appearance, as `[range, compiled macro]` pairs. Cached until line content changes.
+- (NSArray<NSArray*>*)compiledMacros;
 @end
 
 NS_ASSUME_NONNULL_END
@@ -10,22 +10,38 @@
 
 @implementation Line (Macros)
 
-- (void)resolveMacrosWithParser:(BeatMacroParser*)macroParser
-{    
-    NSDictionary* macros = self.macros;
-    self.resolvedMacros = NSMutableDictionary.new;
+- (bool)resolveMacrosWithParser:(BeatMacroParser*)macroParser
+{
+    NSMutableDictionary* resolvedMacros = NSMutableDictionary.new;
     
-    NSArray<NSValue*>* keys = [macros.allKeys sortedArrayUsingComparator:^NSComparisonResult(NSValue*  _Nonnull obj1, NSValue*  _Nonnull obj2) {
-        if (obj1.rangeValue.location > obj2.rangeValue.location) return true;
-        return false;
-    }];
+    for (NSArray* macro in self.compiledMacros) {
+        id value = [macroParser evaluate:macro[1]];
+        if (value != nil) resolvedMacros[macro[0]] = [NSString stringWithFormat:@"%@", value];
+    }
     
-    for (NSValue* range in keys) {
-        NSString* macro = macros[range];
-        id value = [macroParser parseMacro:macro];
+    // Only replace the values when something actually changed, so content cached on this line stays valid
+    if ([resolvedMacros isEqualToDictionary:self.resolvedMacros]) return false;
+    
+    self.resolvedMacros = resolvedMacros;
+    return true;
+}
+
+- (NSArray<NSArray*>*)compiledMacros
+{
+    return [self cachedContentForKey:@"compiledMacros" create:^id{
+        NSDictionary<NSValue*, NSString*>* macros = self.macros;
+        NSArray<NSValue*>* keys = [macros.allKeys sortedArrayUsingComparator:^NSComparisonResult(NSValue*  _Nonnull obj1, NSValue*  _Nonnull obj2) {
+            if (obj1.rangeValue.location == obj2.rangeValue.location) return NSOrderedSame;
+            return (obj1.rangeValue.location > obj2.rangeValue.location) ? NSOrderedDescending : NSOrderedAscending;
+        }];
         
-        if (value != nil) self.resolvedMacros[range] = [NSString stringWithFormat:@"%@", value];
-    }
+        NSMutableArray* compiled = [NSMutableArray arrayWithCapacity:keys.count];
+        for (NSValue* range in keys) {
+            [compiled addObject:@[range, [BeatMacroParser compile:macros[range]]]];
+        }
+        
+        return compiled;
+    }];
 }
 
 @end
@@ -24,30 +24,66 @@
 - (bool)note { return self.isNote; }
 
 
+/// Note delimiters which can continue a note block on another line
+typedef struct {
+    /// The first `]]` which appears before any `[[`
+    NSInteger close;
+    /// The last `[[` which isn't followed by `]]`
+    NSInteger open;
+} BeatNoteDelimiters;
+
+/// Finds both block delimiters in a single pass. The result is cached until the line changes, because resolving note blocks asks for the same lines over and over again.
+- (BeatNoteDelimiters)noteDelimiters
+{
+    NSValue* value = [self cachedContentForKey:@"noteDelimiters" create:^id{
+        BeatNoteDelimiters delimiters = { NSNotFound, NSNotFound };
+        NSInteger length = self.string.length;
+        
+        if (length > 1 && length <= 30000) {
+            unichar chrs[length];
+            [self.string getCharacters:chrs];
+            
+            bool seenOpen = false;
+            bool lastWasOpen = false;
+            NSInteger lastOpen = NSNotFound;
+            
+            for (NSInteger i=0; i<length - 1; i++) {
+                unichar c1 = chrs[i];
+                unichar c2 = chrs[i+1];
+                
+                if (c1 == ']' && c2 == ']') {
+                    if (!seenOpen && delimiters.close == NSNotFound) delimiters.close = i;
+                    lastWasOpen = false;
+                }
+                else if (c1 == '[' && c2 == '[') {
+                    seenOpen = true;
+                    lastWasOpen = true;
+                    lastOpen = i;
+                }
+            }
+            
+            if (lastWasOpen) delimiters.open = lastOpen;
+        }
+        
+        return [NSValue valueWithBytes:&delimiters objCType:@encode(BeatNoteDelimiters)];
+    }];
+    
+    BeatNoteDelimiters delimiters = { NSNotFound, NSNotFound };
+    [value getValue:&delimiters size:sizeof(BeatNoteDelimiters)];
+    return delimiters;
+}
+
 /// Returns `true` if the note is able to succesfully terminate a multi-line note block (contains `]]`)
 - (bool)canTerminateNoteBlock {
     return [self canTerminateNoteBlockWithActualIndex:nil];
 }
 - (bool)canTerminateNoteBlockWithActualIndex:(NSInteger*)position
 {
-    if (self.length > 30000) return false;
-    else if (![self.string containsString:@"]]"]) return false;
+    NSInteger close = self.noteDelimiters.close;
+    if (close == NSNotFound) return false;
     
-    unichar chrs[self.string.length];
-    [self.string getCharacters:chrs];
-    
-    for (NSInteger i=0; i<self.length - 1; i++) {
-        unichar c1 = chrs[i];
-        unichar c2 = chrs[i+1];
-        
-        if (c1 == ']' && c2 == ']') {
-            if (position != nil) *position = i;
-            return true;
-        }
-        else if (c1 == '[' && c2 == '[') return false;
-    }
-    
-    return false;
+    if (position != nil) *position = close;
+    return true;
 }
 
 /// Returns `true` if the line can begin a note block
@@ -60,23 +96,11 @@
 /// @param index Pointer to the index where the potential note block begins.
 - (bool)canBeginNoteBlockWithActualIndex:(NSInteger*)index
 {
-    if (self.length > 30000) return false;
-    
-    unichar chrs[self.string.length];
-    [self.string getCharacters:chrs];
-    
-    for (NSInteger i=self.length - 1; i > 0; i--) {
-        unichar c1 = chrs[i];
-        unichar c2 = chrs[i-1];
-        
-        if (c1 == '[' && c2 == '[') {
-            if (index != nil) *index = i - 1;
-            return true;
-        }
-        else if (c1 == ']' && c2 == ']') return false;
-    }
+    NSInteger open = self.noteDelimiters.open;
+    if (open == NSNotFound) return false;
     
-    return false;
+    if (index != nil) *index = open;
+    return true;
 }
 
 - (NSArray<NSString*>*)noteContents
@@ -35,7 +35,9 @@
 /// Returns ranges with content ONLY (useful for reconstructing the string with no Fountain stylization)
 - (NSIndexSet*)contentRanges
 {
-    return [self contentRangesIncluding:nil];
+    return [self cachedContentForKey:@"contentRanges" create:^id{
+        return [self contentRangesIncluding:nil].copy;
+    }];
 }
 /// Returns ranges with content ONLY (useful for reconstructing the string with no Fountain stylization), with given extra ranges included.
 - (NSIndexSet*)contentRangesIncluding:(NSIndexSet*)includedRanges
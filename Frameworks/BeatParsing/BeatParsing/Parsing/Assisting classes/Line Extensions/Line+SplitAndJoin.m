@@ -150,6 +150,10 @@
         }
     }
     
+    // Formatting and macros were modified in place
+    [retain invalidateContent];
+    [split invalidateContent];
+    
     return @[ retain, split ];
 }
 
@@ -222,6 +226,9 @@
             self.resolvedMacros[rKey] = line.resolvedMacros[r];
         }
     }
+    
+    // Formatting and macros were modified in place
+    [self invalidateContent];
 }
 
 
@@ -34,6 +34,9 @@ NS_ASSUME_NONNULL_BEGIN
 /// Returns line versions ready to be serialized to JSON.
 - (NSArray<NSDictionary*>*)versionsForSerialization;
 
+/// Stores current version and returns the `/** ALTERNATIVES: ... */` block which is appended to the line when saving, or `nil` if the line has no alternatives. The serialized block is cached until versions change.
+- (NSString* _Nullable)alternativesForSaving;
+
 /// Adds a new version of this text.
 /// - note: You need to have baked the revisions in the text for this to work correctly
 - (void)addVersion;
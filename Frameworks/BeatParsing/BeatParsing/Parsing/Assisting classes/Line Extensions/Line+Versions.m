@@ -41,21 +41,37 @@
 - (void)storeVersion
 {
     if (self.versions == nil) self.versions = NSMutableArray.new;
+    
+    NSDictionary* revisions = self.revisionsForVersion;
+    
+    // Keep the existing version if nothing has changed, so serialized alternatives stay valid
+    NSDictionary* stored = (self.currentVersion < self.versions.count) ? self.versions[self.currentVersion] : nil;
+    if (stored != nil && [stored[@"text"] isEqualToString:self.string] && [stored[@"revisions"] isEqualToDictionary:revisions]) return;
 
     self.versions[self.currentVersion] = @{
-        @"text": self.string,
-        @"revisions": (self.revisedRanges != nil) ? self.revisedRanges : @{}
+        @"text": self.string.copy,
+        @"revisions": revisions
     };
 }
 
+/// Returns an immutable copy of current revisions. Revised ranges are mutated in place, so versions can't share them with the line.
+- (NSDictionary*)revisionsForVersion
+{
+    if (self.revisedRanges == nil) return @{};
+    
+    NSMutableDictionary* revisions = [NSMutableDictionary.alloc initWithCapacity:self.revisedRanges.count];
+    for (NSNumber* key in self.revisedRanges.allKeys) revisions[key] = self.revisedRanges[key].copy;
+    return revisions.copy;
+}
+
 /// Adds a new version of this text.
 /// - note: You need to have baked the revisions in the text for this to work correctly
 - (void)addVersion
 {
     [self storeVersion];
     [self.versions addObject:@{
-        @"text": self.string,
-        @"revisions": (self.revisedRanges != nil) ? self.revisedRanges : @{}
+        @"text": self.string.copy,
+        @"revisions": self.revisionsForVersion
     }];
     self.currentVersion = self.versions.count - 1;
 }
@@ -157,6 +173,47 @@
     return versions;
 }
 
+/// Stores current version and returns the `/** ALTERNATIVES: ... */` block which is appended to the line when saving, or `nil` if the line has no alternatives.
+/// The serialized block is reused until the versions change.
+- (NSString*)alternativesForSaving
+{
+    if (self.versions.count == 0) return nil;
+    
+    // Update current version
+    [self storeVersion];
+    
+    // Versions are immutable dictionaries, so comparing the objects is enough
+    NSArray* cached = self.serializedVersions;
+    if (cached.count == 3 && [cached[0] integerValue] == self.currentVersion) {
+        NSArray* versions = cached[1];
+        bool unchanged = (versions.count == self.versions.count);
+        
+        for (NSInteger i=0; i<versions.count && unchanged; i++) {
+            if (versions[i] != self.versions[i]) unchanged = false;
+        }
+        
+        if (unchanged) return cached[2];
+    }
+    
+    // We need to have methods for serializing index sets
+    NSDictionary* versionDict = @{
+        @"current": @(self.currentVersion),
+        @"versions": self.versionsForSerialization
+    };
+    
+    NSError* error;
+    NSData* versionData = [NSJSONSerialization dataWithJSONObject:versionDict options:0 error:&error];
+    if (versionData == nil) {
+        NSLog(@"!!! Error serializing version data: %@", error);
+        return nil;
+    }
+    
+    NSString* alternatives = [NSString stringWithFormat:@"%@%@ */", ALTERNATIVE_PREFIX, [NSString.alloc initWithData:versionData encoding:NSUTF8StringEncoding]];
+    self.serializedVersions = @[@(self.currentVersion), self.versions.copy, alternatives];
+    
+    return alternatives;
+}
+
 @end
 /*
  
@@ -213,6 +213,18 @@ JSExportAs(setCustomData, - (NSDictionary*)setCustomData:(NSString*)key value:(i
 
 /// Returns the index set for given formatted range type. Never returns a `nil` value.
 - (NSMutableIndexSet*)formattedRange:(FormattedRange)type;
+/// Returns `true` if the line has no ranges of given formatting type. Cheaper than checking the index set, because it won't be created.
+- (bool)formattingIsEmpty:(FormattedRange)type;
+/// Packs formatting ranges into a compact array and releases the index sets. They will be recreated when accessed.
+/// @warning Only call this when nobody is holding on to the index sets of this line.
+- (void)compactFormatting;
+
+/// Incremented whenever the text, formatting or resolved macros of this line change. Use this to cache anything derived from line content.
+@property (nonatomic, readonly) NSUInteger contentVersion;
+/// Drops cached content (stripped strings, content ranges etc.). Setters do this automatically, but you have to call it yourself after mutating formatting or macros in place.
+- (void)invalidateContent;
+/// Returns a value cached for current content version, or creates and caches it using the given block.
+- (id)cachedContentForKey:(NSString*)key create:(id (^)(void))create;
 
 /// @warning This property is used only for testing purposes.
 @property (nonatomic) NSString* image;
@@ -272,6 +284,8 @@ JSExportAs(setCustomData, - (NSDictionary*)setCustomData:(NSString*)key value:(i
 @property (nonatomic) NSMutableArray<NSDictionary<NSString*, id>*>* versions;
 /// The currently selected iteration of line content
 @property (nonatomic) NSInteger currentVersion;
+/// Serialized alternatives and the versions they were created from. Managed by `alternativesForSaving`.
+@property (nonatomic) NSArray* serializedVersions;
 
 
 #pragma mark - Generated metadata
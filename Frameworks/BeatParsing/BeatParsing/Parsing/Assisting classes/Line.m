@@ -32,12 +32,43 @@
 #import "NSString+EMOEmoji.h"
 #import <BeatParsing/BeatParsing-Swift.h>
 
+/// Packed formatting range. `kind` is a `FormattedRange` value.
+typedef struct {
+    uint32_t location;
+    uint32_t length;
+    uint32_t kind;
+} BeatFormattingSpan;
+
+/// Values derived from line content. The cache is replaced as a whole when content changes, so readers never see a half-updated state.
+@interface BeatLineContentCache : NSObject
+@property (nonatomic) NSUInteger version;
+@property (nonatomic) NSMutableDictionary<NSString*, id>* values;
+@end
+
+@implementation BeatLineContentCache
+- (instancetype)initWithVersion:(NSUInteger)version
+{
+    self = [super init];
+    if (self) {
+        _version = version;
+        _values = NSMutableDictionary.new;
+    }
+    return self;
+}
+@end
+
 @interface Line()
+@property (atomic) BeatLineContentCache* contentCache;
 @property (nonatomic) NSUInteger oldHash;
 @property (nonatomic) NSString* cachedString;
+/// Packed formatting spans, grouped by kind. The data is never mutated, so clones can share it.
+@property (nonatomic) NSData* formattingSpans;
 @end
 
 @implementation Line
+
+@synthesize formattedRanges = _formattedRanges;
+@synthesize type = _type;
  
 #pragma mark - Shorthand initializers
 
@@ -127,6 +158,102 @@
         _string = string;
         self.formattedString = nil;
     }
+    [self invalidateContent];
+}
+
+- (void)setResolvedMacros:(NSMutableDictionary<NSValue *,NSString *> *)resolvedMacros
+{
+    _resolvedMacros = resolvedMacros;
+    [self invalidateContent];
+}
+
+
+#pragma mark - Content cache
+
+/*
+ 
+ Stripped strings, content ranges and other values derived from line content are cached until the text, type, formatting or
+ resolved macros change. Setters invalidate the cache, but anything that mutates index sets or macro dictionaries in place
+ (parser formatting passes, note blocks, splitting and joining) has to call `invalidateContent` itself.
+ 
+ */
+
+/// Incremented whenever the content of this line changes
+- (NSUInteger)contentVersion
+{
+    return self.validContentCache.version;
+}
+
+/// Drops cached content. Call this after mutating formatting or macros in place.
+- (void)invalidateContent
+{
+    BeatLineContentCache* cache = self.contentCache;
+    if (cache == nil) return;
+    
+    // Nothing was cached, so we can just bump the version
+    @synchronized (cache) {
+        if (cache.values.count == 0) {
+            cache.version += 1;
+            return;
+        }
+    }
+    
+    self.contentCache = [BeatLineContentCache.alloc initWithVersion:cache.version + 1];
+}
+
+/// Returns a cached value for current content version, or creates it using the given block
+- (id)cachedContentForKey:(NSString*)key create:(id (^)(void))create
+{
+    BeatLineContentCache* cache = self.validContentCache;
+    
+    @synchronized (cache) {
+        id value = cache.values[key];
+        if (value != nil) return value;
+    }
+    
+    id value = create();
+    if (value == nil) return nil;
+    
+    @synchronized (cache) {
+        cache.values[key] = value;
+    }
+    return value;
+}
+
+- (BeatLineContentCache*)validContentCache
+{
+    BeatLineContentCache* cache = self.contentCache;
+    if (cache != nil) return cache;
+    
+    cache = [BeatLineContentCache.alloc initWithVersion:0];
+    self.contentCache = cache;
+    return cache;
+}
+
+- (LineType)type
+{
+    return _type;
+}
+
+- (void)setType:(LineType)type
+{
+    if (_type == type) return;
+    _type = type;
+    [self invalidateContent];
+}
+
+- (void)setSceneNumberRange:(NSRange)sceneNumberRange
+{
+    if (NSEqualRanges(_sceneNumberRange, sceneNumberRange)) return;
+    _sceneNumberRange = sceneNumberRange;
+    [self invalidateContent];
+}
+
+- (void)setBeginsTitlePageBlock:(bool)beginsTitlePageBlock
+{
+    if (_beginsTitlePageBlock == beginsTitlePageBlock) return;
+    _beginsTitlePageBlock = beginsTitlePageBlock;
+    [self invalidateContent];
 }
 
 
@@ -196,20 +323,19 @@
     
     newLine.resolvedMacros = self.resolvedMacros.mutableCopy;
     
-    if (self.revisedRanges.count > 0) newLine.revisedRanges = self.revisedRanges.mutableCopy;
+    // Formatting is handed over as packed spans. Index sets are only created if the clone actually reads them.
+    newLine.formattingSpans = self.packedFormatting;
     
-    NSMutableDictionary* ranges = NSMutableDictionary.new;
-    for (NSValue* key in self.formattedRanges.allKeys) {
-        if (self.formattedRanges[key] != nil) {
-            NSMutableIndexSet* indices = ((NSMutableIndexSet*)self.formattedRanges[key]).mutableCopy;
-            ranges[key] = indices;
-        } else {
-            ranges[key] = NSMutableIndexSet.new;
-        }
+    // Revision index sets are copied too, because joining lines modifies them in place
+    if (self.revisedRanges.count > 0) {
+        NSMutableDictionary* revisions = NSMutableDictionary.new;
+        for (NSNumber* key in self.revisedRanges.allKeys) revisions[key] = self.revisedRanges[key].mutableCopy;
+        newLine.revisedRanges = revisions;
     }
-    
-    newLine.formattedRanges = ranges;
-     
+
+    // Baked tags
+    if (self.tags != nil) newLine.tags = self.tags.mutableCopy;
+
     newLine.sceneNumberRange = self.sceneNumberRange;
     newLine.sceneNumber = self.sceneNumber.copy;
     newLine.color = self.color.copy;
@@ -237,6 +363,13 @@
 #pragma mark - String methods
 
 - (NSString*)stringForDisplay
+{
+    return [self cachedContentForKey:@"stringForDisplay" create:^id{
+        return [self createStringForDisplay];
+    }];
+}
+
+- (NSString*)createStringForDisplay
 {
     // Wow. This is pretty hacky. If the line is not omitted, we'll return the normal stripped and trimmed string, but otherwise we'll create a clone and remove the omissions.
     if (!self.omitted) {
@@ -274,9 +407,19 @@
 }
 
 - (NSString*)stripFormattingWithSettings:(BeatExportSettings*)settings
+{
+    // Only the note setting has an effect on stripped content
+    bool printNotes = settings.printNotes;
+    
+    return [self cachedContentForKey:(printNotes) ? @"strippedWithNotes" : @"stripped" create:^id{
+        return [self createStrippedStringWithNotes:printNotes].copy;
+    }];
+}
+
+- (NSString*)createStrippedStringWithNotes:(bool)printNotes
 {
     NSMutableIndexSet *contentRanges = self.contentRanges.mutableCopy;
-    if (settings.printNotes) [contentRanges addIndexes:self.noteRanges];
+    if (printNotes) [contentRanges addIndexes:self.noteRanges];
 
     __block NSMutableString *content = NSMutableString.string;
     NSDictionary* macros = self.resolvedMacros;
@@ -575,7 +718,7 @@
 - (void)setNoteRanges:(NSMutableIndexSet *)noteRanges { [self setRanges:noteRanges forFormatting:FormattingRangeNote]; }
 
 - (NSMutableIndexSet *)removalSuggestionRanges { return [self formattedRange:FormattingRangeRemovalSuggestion]; }
-- (void)setRemovalSuggestionRanges:(NSMutableIndexSet *)removalSuggestionRanges { _formattedRanges[@(FormattingRangeRemovalSuggestion)] = removalSuggestionRanges; }
+- (void)setRemovalSuggestionRanges:(NSMutableIndexSet *)removalSuggestionRanges { [self setRanges:removalSuggestionRanges forFormatting:FormattingRangeRemovalSuggestion]; }
 
 - (NSMutableIndexSet *)escapeRanges { return [self formattedRange:FormattingRangeEscape]; }
 - (void)setEscapeRanges:(NSMutableIndexSet *)escapeRanges { [self setRanges:escapeRanges forFormatting:FormattingRangeEscape]; }
@@ -583,14 +726,121 @@
 /// Returns the index set for given formatted range type. Never returns a `nil` value.
 - (NSMutableIndexSet*)formattedRange:(FormattedRange)type
 {
-    if (_formattedRanges[@(type)] == nil) _formattedRanges[@(type)] = NSMutableIndexSet.new;
-    return _formattedRanges[@(type)];
+    NSMutableIndexSet* indices = _formattedRanges[@(type)];
+    
+    if (indices == nil) {
+        indices = [self indicesFromSpans:type];
+        _formattedRanges[@(type)] = indices;
+    }
+    
+    return indices;
 }
 
 /// Set ranges for a formatting type. Ensures that you won't save a `nil` value.
 - (void)setRanges:(NSMutableIndexSet*)indices forFormatting:(FormattedRange)formatting
 {
-    self.formattedRanges[@(formatting)] = (indices != nil) ? indices : NSMutableIndexSet.new;
+    _formattedRanges[@(formatting)] = (indices != nil) ? indices : NSMutableIndexSet.new;
+    [self invalidateContent];
+}
+
+
+#pragma mark - Packed formatting
+
+/*
+ 
+ Formatting ranges can also be stored as a single packed array of `(location, length, kind)` spans. Cloned lines only
+ carry the packed data (which is shared with the original when possible), and the index sets above are materialized one kind
+ at a time when something asks for them. Once a kind has an index set in `formattedRanges`, that set is the authority and the
+ spans of the same kind are ignored.
+ 
+ */
+
+/// Returns every formatted range as an index set. Any remaining packed spans are materialized first.
+- (NSMutableDictionary<NSValue*,NSMutableIndexSet*>*)formattedRanges
+{
+    if (_formattingSpans != nil) {
+        const BeatFormattingSpan* spans = _formattingSpans.bytes;
+        NSUInteger count = _formattingSpans.length / sizeof(BeatFormattingSpan);
+        
+        for (NSUInteger i = 0; i < count; i++) [self formattedRange:(FormattedRange)spans[i].kind];
+        _formattingSpans = nil;
+    }
+    
+    return _formattedRanges;
+}
+
+- (void)setFormattedRanges:(NSMutableDictionary<NSValue*,NSMutableIndexSet*>*)formattedRanges
+{
+    _formattedRanges = (formattedRanges != nil) ? formattedRanges : NSMutableDictionary.new;
+    _formattingSpans = nil;
+    [self invalidateContent];
+}
+
+/// Creates an index set for given kind from packed spans
+- (NSMutableIndexSet*)indicesFromSpans:(FormattedRange)type
+{
+    NSMutableIndexSet* indices = NSMutableIndexSet.new;
+    
+    const BeatFormattingSpan* spans = _formattingSpans.bytes;
+    NSUInteger count = _formattingSpans.length / sizeof(BeatFormattingSpan);
+    
+    for (NSUInteger i = 0; i < count; i++) {
+        if (spans[i].kind == type) [indices addIndexesInRange:NSMakeRange(spans[i].location, spans[i].length)];
+    }
+    
+    return indices;
+}
+
+/// Returns `true` if there are no ranges of given kind. Doesn't materialize an index set.
+- (bool)formattingIsEmpty:(FormattedRange)type
+{
+    NSMutableIndexSet* indices = _formattedRanges[@(type)];
+    if (indices != nil) return (indices.count == 0);
+    
+    const BeatFormattingSpan* spans = _formattingSpans.bytes;
+    NSUInteger count = _formattingSpans.length / sizeof(BeatFormattingSpan);
+    
+    for (NSUInteger i = 0; i < count; i++) {
+        if (spans[i].kind == type && spans[i].length > 0) return false;
+    }
+    
+    return true;
+}
+
+/// Returns all formatting as packed spans without modifying the line. If nothing has been materialized, the existing data is returned as is.
+/// Spans are grouped by kind and not sorted, because none of the consumers care about their order.
+- (NSData*)packedFormatting
+{
+    if (_formattedRanges.count == 0) return _formattingSpans;
+    
+    NSMutableData* data = NSMutableData.new;
+    
+    // Spans of kinds which were never materialized are still valid
+    const BeatFormattingSpan* spans = _formattingSpans.bytes;
+    NSUInteger count = _formattingSpans.length / sizeof(BeatFormattingSpan);
+    
+    for (NSUInteger i = 0; i < count; i++) {
+        if (_formattedRanges[@(spans[i].kind)] == nil) [data appendBytes:&spans[i] length:sizeof(BeatFormattingSpan)];
+    }
+    
+    for (NSNumber* key in _formattedRanges) {
+        uint32_t kind = key.unsignedIntValue;
+        [_formattedRanges[key] enumerateRangesUsingBlock:^(NSRange range, BOOL * _Nonnull stop) {
+            BeatFormattingSpan span = { (uint32_t)range.location, (uint32_t)range.length, kind };
+            [data appendBytes:&span length:sizeof(BeatFormattingSpan)];
+        }];
+    }
+    
+    if (data.length == 0) return nil;
+    return data;
+}
+
+/// Packs all formatting ranges and releases the index sets.
+/// @warning Only call this when nobody is holding on to the index sets of this line, because any later changes to them would be lost.
+- (void)compactFormatting
+{
+    _formattingSpans = self.packedFormatting;
+    _formattedRanges = NSMutableDictionary.new;
 }
 
 /// It's much more sensible to calculate this on the fly than store it every time.
@@ -606,7 +856,7 @@
 /// Returns TRUE when the line has no inline formatting (like **bold**)
 -(bool)noFormatting
 {
-    return !(self.boldRanges.count || self.italicRanges.count || self.highlightRanges.count || self.underlinedRanges.count);
+    return ([self formattingIsEmpty:FormattingRangeBold] && [self formattingIsEmpty:FormattingRangeItalic] && [self formattingIsEmpty:FormattingRangeHighlight] && [self formattingIsEmpty:FormattingRangeUnderlined]);
 }
 
 
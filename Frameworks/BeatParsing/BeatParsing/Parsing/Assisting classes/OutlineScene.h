@@ -130,4 +130,11 @@
 - (NSString*)typeAsString;
 - (NSDictionary*)forSerialization;
 - (NSDictionary*)json;
+
+/// Returns a cached JSON string for this scene. The string is recreated when the scene has been invalidated or has moved.
+- (NSString*)jsonString;
+/// Clears the cached JSON string. Call this whenever contents of the scene have changed.
+- (void)invalidateSerialization;
+/// Returns a JSON array of given scenes, concatenated from cached fragments
++ (NSString*)jsonForScenes:(NSArray<OutlineScene*>*)scenes;
 @end
@@ -11,7 +11,11 @@
 #import "OutlineScene.h"
 #import <BeatParsing/Line+Type.h>
 
-@implementation OutlineScene
+@implementation OutlineScene {
+    /// Cached JSON fragment and the values it was created with
+    NSString* _serializedJSON;
+    NSArray* _serializedKey;
+}
 
 + (OutlineScene*)withLine:(Line*)line delegate:(id)delegate
 {
@@ -99,6 +103,59 @@
     }
 }
 
+/// Values which affect serialization but don't go through `OutlineChanges`. Positions shift whenever something is edited before this scene, and revisions can be added or removed without editing the text.
+- (NSArray*)serializationKey
+{
+    // Revised ranges are mutable, so the key needs its own copies
+    NSDictionary<NSNumber*, NSMutableIndexSet*>* revisedRanges = self.line.revisedRanges;
+    NSMutableDictionary<NSNumber*, NSIndexSet*>* revisions = [NSMutableDictionary dictionaryWithCapacity:revisedRanges.count];
+    for (NSNumber* generation in revisedRanges) revisions[generation] = revisedRanges[generation].copy;
+    
+    return @[
+        @(self.position), @(self.length), @(self.sectionDepth), @(self.omitted),
+        (self.string != nil) ? self.string : @"",
+        (self.sceneNumber != nil) ? self.sceneNumber : @"",
+        (self.color != nil) ? self.color : @"",
+        revisions
+    ];
+}
+
+- (NSString*)jsonString
+{
+    @synchronized (self) {
+        NSArray* key = self.serializationKey;
+        if (_serializedJSON != nil && [_serializedKey isEqualToArray:key]) return _serializedJSON;
+        
+        NSError* error;
+        NSData* data = [NSJSONSerialization dataWithJSONObject:self.forSerialization options:0 error:&error];
+        if (error) {
+            NSLog(@"JSON error: %@", error);
+            return @"{}";
+        }
+        
+        _serializedJSON = [NSString.alloc initWithData:data encoding:NSUTF8StringEncoding];
+        _serializedKey = key;
+        
+        return _serializedJSON;
+    }
+}
+
+- (void)invalidateSerialization
+{
+    @synchronized (self) {
+        _serializedJSON = nil;
+        _serializedKey = nil;
+    }
+}
+
++ (NSString*)jsonForScenes:(NSArray<OutlineScene*>*)scenes
+{
+    NSMutableArray<NSString*>* fragments = [NSMutableArray arrayWithCapacity:scenes.count];
+    for (OutlineScene* scene in scenes) [fragments addObject:scene.jsonString];
+    
+    return [NSString stringWithFormat:@"[%@]", [fragments componentsJoinedByString:@","]];
+}
+
 - (NSArray*)serializedBeats
 {
 	NSMutableArray *beats = NSMutableArray.new;
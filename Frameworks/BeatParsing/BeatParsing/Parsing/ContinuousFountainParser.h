@@ -17,6 +17,8 @@
 
 @class OutlineScene;
 @class BeatMacroParser;
+@class BeatMacroState;
+@class BeatCompletionIndex;
 
 #pragma mark - Parser delegate
 
@@ -158,6 +160,18 @@
 
 @property (nonatomic) BeatMacroParser* macros;
 @property (nonatomic) bool macrosNeedUpdate;
+/// Macro parser state before each line with macros, recorded when resolving macros. Used to resume resolving from the middle of the document.
+@property (nonatomic) NSMapTable<Line*, BeatMacroState*>* macroStates;
+/// Lines which have changed since macros were last resolved
+@property (nonatomic) NSHashTable<Line*>* macroChangedLines;
+
+
+#pragma mark - Indexes
+
+/// Character cue names and the number of cues for each name. Kept up to date while parsing.
+@property (nonatomic) BeatCompletionIndex* characterIndex;
+/// Scene headings and the number of times each heading is used, searchable without prefixes (`INT.`, `EXT.` etc.). Kept up to date while parsing.
+@property (nonatomic) BeatCompletionIndex* headingIndex;
 
 
 #pragma mark - Boneyard
@@ -45,6 +45,7 @@
 #import <BeatParsing/ContinuousFountainParser+Outline.h>
 #import <BeatParsing/ContinuousFountainParser+Lookup.h>
 #import <BeatParsing/ContinuousFountainParser+Macros.h>
+#import <BeatParsing/ContinuousFountainParser+Indexes.h>
 #import <BeatParsing/ContinuousFountainParser+TitlePage.h>
 #import <BeatParsing/ContinuousFountainParser+ParsingRules.h>
 #import <BeatParsing/ContinuousFountainParser+LineIdentifiers.h>
@@ -199,42 +200,62 @@
 
 #pragma mark - Saved file processing
 
-/// Returns the RAW text when saving a screenplay, including additional markup (namely versions)
+/// Returns the RAW text when saving a screenplay, including additional markup (namely versions).
+/// This is called on every save and autosave, so we calculate the exact length first and then write the content into a single buffer. Serialized alternatives are cached in lines.
 - (NSString*)screenplayForSaving
 {
-    NSArray *lines = self.safeLines.copy;
-    NSMutableString *content = NSMutableString.string;
-    
-    Line *previousLine;
-    for (Line* line in lines) {
-        if (!line) continue;
+    NSArray<Line*>* lines = self.safeLines;
+    NSInteger count = lines.count;
+    if (count == 0) return @"";
+    
+    // Collect the strings first, so we're writing exactly what we measured
+    NSMutableArray<NSString*>* strings = [NSMutableArray arrayWithCapacity:count];
+    NSMutableDictionary<NSNumber*, NSString*>* alternatives = nil;
+    NSUInteger length = count - 1; // Line breaks
+    
+    for (NSInteger i=0; i<count; i++) {
+        NSString* string = lines[i].string;
+        if (string == nil) string = @"";
         
-        NSString* string = line.string;
-
-        if (line.versions.count > 0) {
-            // Update current version
-            [line storeVersion];
-            //We need to have methods for serializing index sets
-            NSDictionary* versionDict = @{
-                @"current": @(line.currentVersion),
-                @"versions": line.versionsForSerialization
-            };
-            NSData* versionData = [NSJSONSerialization dataWithJSONObject:versionDict options:0 error:nil];
-            NSString* versionString = [NSString stringWithFormat:@"/** ALTERNATIVES: %@ */", [NSString.alloc initWithData:versionData encoding:NSUTF8StringEncoding]];
+        [strings addObject:string];
+        length += string.length;
+        
+        if (lines[i].versions.count > 0) {
+            NSString* alternative = lines[i].alternativesForSaving;
+            if (alternative == nil) continue;
             
-            string = [string stringByAppendingString:versionString];
+            if (alternatives == nil) alternatives = NSMutableDictionary.new;
+            alternatives[@(i)] = alternative;
+            length += alternative.length;
         }
+    }
     
-        // Append to full content
-        [content appendString:string];
+    unichar* buffer = malloc(MAX(length, 1) * sizeof(unichar));
+    if (buffer == NULL) {
+        NSLog(@"ERROR: Could not allocate buffer for saving");
+        return nil;
+    }
+    
+    NSUInteger position = 0;
+    for (NSInteger i=0; i<count; i++) {
+        NSString* string = strings[i];
+        NSString* alternative = (alternatives != nil) ? alternatives[@(i)] : nil;
         
-        // Add a line break until we reach the end
-        if (line != self.lines.lastObject) [content appendString:@"\n"];
+        NSUInteger len = MIN(string.length, length - position);
+        [string getCharacters:buffer + position range:NSMakeRange(0, len)];
+        position += len;
         
-        previousLine = line;
+        if (alternative != nil) {
+            len = MIN(alternative.length, length - position);
+            [alternative getCharacters:buffer + position range:NSMakeRange(0, len)];
+            position += len;
+        }
+        
+        // Add a line break until we reach the end
+        if (i < count - 1 && position < length) buffer[position++] = '\n';
     }
     
-    return content;
+    return [NSString.alloc initWithCharactersNoCopy:buffer length:position freeWhenDone:YES];
 }
 
 /// Returns the whole document as single string
@@ -299,6 +320,12 @@
     [self updateOutline];
     self.outlineChanges = OutlineChanges.new;
     
+    // Build character and heading indexes in one go
+    [self rebuildIndexes];
+    
+    // Nobody holds on to formatting index sets yet, so pack them. Untouched lines will then share their spans with any clones.
+    for (Line* line in self.lines) [line compactFormatting];
+    
     // Reset changes (to force the editor to reformat each line)
     [self.changedIndices addIndexesInRange:NSMakeRange(0,self.lines.count)];
     
@@ -516,6 +543,13 @@
     if (line.isOutlineElement) [self removeOutlineElementForLine:line];
     [self addUpdateToOutlineIfNeededAt:index];
     
+    [self removeLineFromIndexes:line];
+    
+    // Removing a macro or a top-level section affects the macros after it
+    if ((line.macroRanges.count > 0 || line.type == section) && self.lines.count > 1) {
+        [self macrosNeedUpdateAtLine:(index + 1 < self.lines.count) ? self.lines[index + 1] : self.lines[index - 1]];
+    }
+    
     // Remove the line
     [self.lines removeObjectAtIndex:index];
     [self decrementLinePositionsFromIndex:index amount:line.range.length];
@@ -629,6 +663,9 @@
     while (lineIndices.count > 0) {
         [self correctParseInLine:lineIndices.lowestIndex indicesToDo:lineIndices];
     }
+    
+    // Lines can change type without being parsed again, so we'll update indexes for every changed line
+    [self updateIndexesInLines:self.changedIndices];
 }
 
 /// Fixes dialogue blocks when something is addede below a possible cue
@@ -742,8 +779,13 @@
     // Parse correct type
     [self parseTypeAndFormattingForLine:currentLine atIndex:index];
     
+    // Lines with macros (now or before) and top-level sections affect macro values
+    if (currentLine.macroRanges.count > 0 || currentLine.type == section || oldType == section || [self.macroStates objectForKey:currentLine] != nil) {
+        [self macrosNeedUpdateAtLine:currentLine];
+    }
+    
     // Update macros when the last line has been updated
-    if (lastToParse && self.macrosNeedUpdate) [self updateMacros];
+    if (lastToParse && self.macrosNeedUpdate) [self updateChangedMacros];
     
     // Add, remove or update outline elements
     if ((oldType == section || oldType == heading) && !currentLine.isOutlineElement) {
@@ -767,9 +809,6 @@
             bool didChangeType = (currentLine.type != oldType);
             [self addUpdateToOutlineAtLine:currentLine didChangeType:didChangeType];
         }
-        
-        // Update all macros
-        if (currentLine.macroRanges.count > 0) self.macrosNeedUpdate = true;
     }
         
     // Correct orphaned dialogue if needed
@@ -894,6 +933,8 @@
             line.titleRange = NSMakeRange(0, [line.string rangeOfString:@":"].location + 1);
         }
     }
+    
+    [self updateIndexesForLine:line];
 } }
 
 - (void)parseInlineFormattingFor:(Line*)line atIndex:(NSInteger)index
@@ -939,6 +980,9 @@
             }
         }
     }
+    
+    // Escape ranges are collected in place while parsing
+    [line invalidateContent];
 }
 
 
@@ -0,0 +1,30 @@
+//
+//  ContinuousFountainParser+Indexes.h
+//  BeatParsing
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+#import <BeatParsing/BeatParsing.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface ContinuousFountainParser (Indexes)
+
+/// Rebuilds character and heading indexes from all lines
+- (void)rebuildIndexes;
+/// Updates index entries for a line after it was parsed or changed type
+- (void)updateIndexesForLine:(Line*)line;
+/// Updates index entries for lines at given indices
+- (void)updateIndexesInLines:(NSIndexSet*)indices;
+/// Removes a line from indexes
+- (void)removeLineFromIndexes:(Line*)line;
+
+/// Returns the prefix of a scene heading, ie. `INT.` or `.` for forced headings. A heading without spaces is all prefix.
++ (NSString*)sceneHeadingPrefix:(NSString*)heading;
+/// Returns an uppercase scene heading without its prefix. Headings are searched using this key, so `INT. HOUSE` and `EXT. HOUSE` are both found with `HO`.
++ (NSString* _Nullable)searchKeyForHeading:(NSString* _Nullable)heading;
+
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,86 @@
+//
+//  ContinuousFountainParser+Indexes.m
+//  BeatParsing
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+/**
+ 
+ Character and scene heading indexes used by autocompletion. Indexes are built once after the initial parse, and then
+ updated whenever a line is parsed, changes its type or is removed.
+ 
+ */
+
+#import "ContinuousFountainParser+Indexes.h"
+#import "BeatCompletionIndex.h"
+
+@implementation ContinuousFountainParser (Indexes)
+
+- (void)rebuildIndexes
+{
+    if (self.characterIndex == nil) self.characterIndex = BeatCompletionIndex.new;
+    if (self.headingIndex == nil) self.headingIndex = BeatCompletionIndex.new;
+    
+    [self.characterIndex removeAllKeys];
+    [self.headingIndex removeAllKeys];
+    
+    for (Line* line in self.safeLines) [self updateIndexesForLine:line];
+}
+
+- (void)updateIndexesForLine:(Line*)line
+{
+    // Indexes are built after the initial parse
+    if (self.characterIndex == nil || line == nil) return;
+    
+    // Character name, excluding any suffixes, such as (CONT'D), (V.O.') etc.
+    NSString* name = (line.isAnyCharacter) ? line.characterName : nil;
+    [self.characterIndex setKey:name searchKey:name.uppercaseString forLine:line];
+    
+    NSString* sceneHeading = (line.type == heading) ? line.stripFormatting : nil;
+    [self.headingIndex setKey:sceneHeading searchKey:[ContinuousFountainParser searchKeyForHeading:sceneHeading] forLine:line];
+}
+
+- (void)updateIndexesInLines:(NSIndexSet*)indices
+{
+    if (self.characterIndex == nil) return;
+    
+    NSArray<Line*>* lines = self.lines;
+    [indices enumerateIndexesUsingBlock:^(NSUInteger idx, BOOL * _Nonnull stop) {
+        if (idx < lines.count) [self updateIndexesForLine:lines[idx]];
+    }];
+}
+
+- (void)removeLineFromIndexes:(Line*)line
+{
+    [self.characterIndex setKey:nil searchKey:nil forLine:line];
+    [self.headingIndex setKey:nil searchKey:nil forLine:line];
+}
+
+
+#pragma mark - Scene heading prefixes
+
++ (NSString*)sceneHeadingPrefix:(NSString*)heading
+{
+    // Forced scene heading
+    if (heading.length > 0 && [heading characterAtIndex:0] == '.') {
+        return [heading substringToIndex:1];
+    }
+    
+    if ([heading containsString:@" "]) {
+        return [heading substringToIndex:[heading rangeOfString:@" "].location];
+    } else {
+        return heading;
+    }
+}
+
++ (NSString*)searchKeyForHeading:(NSString*)heading
+{
+    if (heading.length == 0) return nil;
+    
+    NSString* string = heading.uppercaseString;
+    NSString* prefix = [self sceneHeadingPrefix:string];
+    
+    return [[string stringByReplacingOccurrencesOfString:prefix withString:@""] stringByTrimmingCharactersInSet:NSCharacterSet.whitespaceCharacterSet];
+}
+
+@end
@@ -11,7 +11,12 @@ NS_ASSUME_NONNULL_BEGIN
 
 @interface ContinuousFountainParser (Macros)
 
+/// Resolves all macros in the document from the top
 - (void)updateMacros;
+/// Resolves macros starting from the first changed line, and stops as soon as the results can't differ from the previous pass
+- (void)updateChangedMacros;
+/// Marks the line for the next macro update
+- (void)macrosNeedUpdateAtLine:(Line*)line;
 
 @end
 
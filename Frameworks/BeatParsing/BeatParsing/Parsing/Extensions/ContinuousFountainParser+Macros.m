@@ -4,8 +4,18 @@
 //
 //  Created by Lauri-Matti Parppei on 2.9.2025.
 //
+/**
+ 
+ Macro values depend on everything before them: serials are incremented, variables can be redefined and panels are reset
+ at top-level sections. To avoid resolving the whole document after each edit, we store the state of the macro parser before
+ each line with macros. After an edit, resolving starts from the last unchanged macro line before the first changed line.
+ When we've passed the last changed line and the parser state matches the state recorded for a line during the previous pass,
+ every following macro would resolve to the same value, and we can stop.
+ 
+ */
 
 #import "ContinuousFountainParser+Macros.h"
+#import "ContinuousFountainParser+Lookup.h"
 #import <BeatParsing/BeatParsing-Swift.h>
 
 @implementation ContinuousFountainParser (Macros)
@@ -15,22 +25,84 @@
 - (void)updateMacros
 {
     self.macrosNeedUpdate = false;
+    [self.macroChangedLines removeAllObjects];
+    self.macroStates = NSMapTable.weakToStrongObjectsMapTable;
     
+    [self resolveMacrosInLines:self.safeLines from:0 lastChange:NSNotFound parser:BeatMacroParser.new];
+}
+
+- (void)updateChangedMacros
+{
+    // Nothing has been resolved yet
+    if (self.macroStates == nil || self.macroChangedLines == nil) {
+        [self updateMacros];
+        return;
+    }
+    
+    self.macrosNeedUpdate = false;
+    
+    NSArray<Line*>* lines = self.safeLines;
+    NSInteger firstChange = NSNotFound;
+    NSInteger lastChange = -1;
+    
+    for (Line* line in self.macroChangedLines) {
+        NSInteger i = [self indexOfLine:line lines:lines];
+        if (i == NSNotFound) continue;
+        
+        if (firstChange == NSNotFound || i < firstChange) firstChange = i;
+        if (i > lastChange) lastChange = i;
+    }
+    [self.macroChangedLines removeAllObjects];
+    
+    if (firstChange == NSNotFound) return;
+    
+    // Find the closest line with a recorded state before the change. Everything up to it is unchanged.
     BeatMacroParser* parser = BeatMacroParser.new;
-    NSArray* lines = self.safeLines;
+    NSInteger start = 0;
     
-    for (NSInteger i=0; i<lines.count; i++) {
+    for (NSInteger i = firstChange - 1; i >= 0; i--) {
+        BeatMacroState* state = [self.macroStates objectForKey:lines[i]];
+        if (state == nil) continue;
+        
+        [parser restoreState:state];
+        start = i;
+        break;
+    }
+    
+    [self resolveMacrosInLines:lines from:start lastChange:lastChange parser:parser];
+}
+
+- (void)resolveMacrosInLines:(NSArray<Line*>*)lines from:(NSInteger)start lastChange:(NSInteger)lastChange parser:(BeatMacroParser*)parser
+{
+    for (NSInteger i = start; i < lines.count; i++) {
         Line* l = lines[i];
         if (l.type == section && l.sectionDepth == 1) [parser resetPanel];
-        if (l.macroRanges.count == 0) continue;
         
-        [l resolveMacrosWithParser:parser];
+        if (l.macroRanges.count == 0) {
+            [self.macroStates removeObjectForKey:l];
+            continue;
+        }
+        
+        // The state has converged, so the rest of the document resolves like it did before
+        BeatMacroState* state = parser.saveState;
+        if (lastChange != NSNotFound && i > lastChange && [state isEqual:[self.macroStates objectForKey:l]]) break;
+        
+        [self.macroStates setObject:state forKey:l];
+        
+        bool changed = [l resolveMacrosWithParser:parser];
         
-        if (l.isOutlineElement || l.type == synopse) {
+        if (changed && (l.isOutlineElement || l.type == synopse)) {
             [self addUpdateToOutlineAtLine:l didChangeType:false];
         }
     }
 }
 
+- (void)macrosNeedUpdateAtLine:(Line*)line
+{
+    if (self.macroChangedLines == nil) self.macroChangedLines = NSHashTable.weakObjectsHashTable;
+    [self.macroChangedLines addObject:line];
+    self.macrosNeedUpdate = true;
+}
+
 
 @end
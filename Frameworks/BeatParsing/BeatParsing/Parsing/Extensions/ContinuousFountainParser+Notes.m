@@ -8,6 +8,16 @@
 #import <BeatParsing/ContinuousFountainParser.h>
 #import "ContinuousFountainParser+Notes.h"
 
+/// Returns the colors of multiline note fragments on given line. Editor uses these colors, so lines need to be formatted again when they change.
+static NSArray<NSString*>* multilineNoteColors(Line* line)
+{
+    NSMutableArray<NSString*>* colors = NSMutableArray.new;
+    for (BeatNoteData* note in line.noteData) {
+        if (note.multiline) [colors addObject:(note.color != nil) ? note.color : @""];
+    }
+    return colors;
+}
+
 @implementation ContinuousFountainParser (Notes)
 
 #pragma mark - Note parsing
@@ -91,6 +101,9 @@
         }
     }
         
+    // Note ranges were modified in place
+    [line invalidateContent];
+    
     // Check if there was an unfinished not (except on the last line)
     if (noteRange.location != NSNotFound && lineIndex != self.lines.count-1) {
         line.noteOut = true;
@@ -153,7 +166,7 @@
     bool cancel = false; // A flag to determine if we should remove the note block from existence
     
     // We might not know the actual position, so let's retrieve it
-    if (position == NSNotFound) position = [(Line*)self.lines[lineIndex] canBeginNoteBlockWithActualIndex:&position];
+    if (position == NSNotFound) [(Line*)self.lines[lineIndex] canBeginNoteBlockWithActualIndex:&position];
     
     NSMutableIndexSet* affectedLines = NSMutableIndexSet.new;
     Line* lastLine;
@@ -211,17 +224,27 @@
         if (range.location == NSNotFound || range.length == NSNotFound) return;
         
         if (cancel) {
-            [self.changedIndices addIndex:idx];
-            
             if (!l.noteIn && idx != affectedLines.firstIndex && l.type != empty) {
                 *stop = true;
                 return;
             }
             
-            [l.noteRanges removeIndexesInRange:range];
+            // Only lines which actually lose note ranges need to be formatted again
+            if ([l.noteRanges intersectsIndexesInRange:range]) {
+                [l.noteRanges removeIndexesInRange:range];
+                [l invalidateContent];
+                [self.changedIndices addIndex:idx];
+            }
         } else {
-            [l.noteRanges addIndexesInRange:range];
-            [self.changedIndices addIndex:idx];
+            bool oldNoteIn = l.noteIn;
+            bool oldNoteOut = l.noteOut;
+            NSArray<NSString*>* oldColors = multilineNoteColors(l);
+            bool changedRanges = ![l.noteRanges containsIndexesInRange:range];
+            
+            if (changedRanges) {
+                [l.noteRanges addIndexesInRange:range];
+                [l invalidateContent];
+            }
             
             // Add correct noteIn/noteOut properties.
             if (idx == affectedLines.firstIndex) {
@@ -254,6 +277,10 @@
 
                 [noteContent appendString:[l.string substringWithRange:range]];
             }
+            
+            // Lines which were already a part of this block don't need to be formatted again, unless the note color changed
+            bool changedColor = idx != affectedLines.firstIndex && ![oldColors isEqualToArray:multilineNoteColors(l)];
+            if (changedRanges || changedColor || oldNoteIn != l.noteIn || oldNoteOut != l.noteOut) [self.changedIndices addIndex:idx];
         }
     }];
         
@@ -275,44 +302,23 @@
     [firstLine.noteData addObject:note];
 }
 
+/// Finds the line which could open the note block the given line belongs to. Notes can't span over empty lines, so the search never leaves the current paragraph, and delimiter positions are cached on each line, see `Line+Notes`.
 - (NSInteger)findNoteBlockStartIndexFor:(Line*)line at:(NSInteger)idx positionInLine:(NSInteger*)position
 {
     NSArray* lines = self.lines;
     
     if (idx == NSNotFound) idx = [self indexOfLine:line]; // Get index if needed
-    else if (idx == NSNotFound) return NSNotFound;
-    
-    NSInteger noteStartLine = NSNotFound;
+    if (idx == NSNotFound || idx >= lines.count) return NSNotFound;
     
     for (NSInteger i=idx; i>=0; i--) {
         Line* l = lines[i];
         if (l.type == empty && i < idx) break;   // Stop if we're not in a block
         
-        unichar chrs[l.length];
-        [l.string getCharacters:chrs];
-        
-        for (NSInteger k=l.string.length-1; k>=0; k--) {
-            if (k > 0) {
-                unichar c1 = chrs[k];
-                unichar c2 = chrs[k-1];
-                
-                if (c1 == ']' && c2 == ']') {
-                    break; // Cancel right away at terminating note
-                }
-                else if (c1 == '[' && c2 == '[') {
-                    // The note opening was found
-                    noteStartLine = i;
-                    *position = k - 1;
-                    break;
-                }
-            }
-        }
-        
-        // We found the line, no reason to look backwards anymore
-        if (noteStartLine != NSNotFound) break;
+        // The note opening was found, no reason to look backwards anymore
+        if ([l canBeginNoteBlockWithActualIndex:position]) return i;
     }
         
-    return noteStartLine;
+    return NSNotFound;
 }
 
 @end
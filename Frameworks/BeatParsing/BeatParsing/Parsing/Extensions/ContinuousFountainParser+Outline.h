@@ -37,6 +37,8 @@
 - (void)updateSceneForLine:(Line*)line at:(NSInteger)index lineIndex:(NSInteger)lineIndex;
 /// Updates the given scene and gathers its notes and synopsis lines. If you don't know the line/scene index pass them as `NSNotFound` .
 - (void)updateScene:(OutlineScene*)scene at:(NSInteger)index lineIndex:(NSInteger)lineIndex;
+/// Clears cached JSON for changed outline elements.
+- (void)invalidateSerializationWithChanges:(OutlineChanges*)changes;
 
 /// Adds an update to this line, but only if needed
 - (void)addUpdateToOutlineIfNeededAt:(NSInteger)lineIndex;
@@ -135,11 +135,21 @@
     if (self.outlineChanges.hasChanges) [self updateOutlineHierarchy];
         
     OutlineChanges* changes = self.outlineChanges.copy;
+    [self invalidateSerializationWithChanges:changes];
     self.outlineChanges = OutlineChanges.new;
     
     return changes;
 }
 
+/// Clears cached JSON for changed outline elements. Scenes which only moved are handled by the scenes themselves.
+- (void)invalidateSerializationWithChanges:(OutlineChanges*)changes
+{
+    if (changes == nil) return;
+    
+    NSArray* scenes = (changes.needsFullUpdate) ? self.outline.copy : [changes.updated.allObjects arrayByAddingObjectsFromArray:changes.added.allObjects];
+    for (OutlineScene* scene in scenes) [scene invalidateSerialization];
+}
+
 /// Returns an array of dictionaries with UUID mapped to the actual string.
 -(NSArray<NSDictionary<NSString*,NSString*>*>*)outlineUUIDs
 {
@@ -256,6 +266,7 @@
     if (lineIndex == NSNotFound) lineIndex = [self indexOfLine:scene.line];
     
     // Reset everything
+    [scene invalidateSerialization];
     scene.synopsis = NSMutableArray.new;
     scene.beats = NSMutableArray.new;
     scene.notes = NSMutableArray.new;
@@ -409,6 +420,7 @@
     [self updateSceneNumbers:autoNumbered forcedNumbers:forcedNumbers];
     
     if (self.outlineChanges.hasChanges) {
+        [self invalidateSerializationWithChanges:self.outlineChanges];
         [(id<ContinuousFountainParserOutlineDelegate>)self.delegate outlineDidUpdateWithChanges:self.outlineChanges];
     }
     self.outlineChanges = nil;
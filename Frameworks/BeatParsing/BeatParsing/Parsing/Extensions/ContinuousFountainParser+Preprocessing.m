@@ -79,19 +79,7 @@
         }
         
         // Preprocess macros
-        if (l.macroRanges.count > 0) {
-            NSArray<NSValue*>* macroKeys = [l.macros.allKeys sortedArrayUsingComparator:^NSComparisonResult(NSValue*  _Nonnull obj1, NSValue*  _Nonnull obj2) {
-                return (obj1.rangeValue.location > obj2.rangeValue.location);
-            }];
-            
-            l.resolvedMacros = NSMutableDictionary.new;
-            for (NSValue* range in macroKeys) {
-                NSString* macro = l.macros[range];
-                id value = [macros parseMacro:macro];
-                
-                if (value != nil) l.resolvedMacros[range] = [NSString stringWithFormat:@"%@", value];
-            }
-        }
+        if (l.macroRanges.count > 0) [l resolveMacrosWithParser:macros];
          
         // Skip line if it's a macro and has no results
         if (l.macroRanges.count > 0 && l.macroRanges.count == l.length && l.resolvedMacros.count == 0) {
@@ -11,6 +11,9 @@
  
  The code has been cooked up in a day or two, so it's not the cleanest approach, but works :------)
  
+ Each distinct macro string is tokenized only once into a `BeatCompiledMacro`, which is then evaluated against parser state.
+ Parser state can be saved and restored, which allows the continuous parser to resolve only the affected part of the document.
+ 
  There are three types of macros: `string`, `serial` (which can be `series` for compatibility with Highland) and `date`.
  String macros require a definition, whereas serials start at `1` by default:
  
@@ -43,62 +46,20 @@ import Foundation
     var panel = BeatMacro(name: "panel", type: .panel, value: 0)
     var references = BeatMacro(name: "ref", type: .reference, value: [String]())
     
-    let typeNames = ["string", "serial", "series", "number", "date", "panel", "ref", "references"]
-    
     
     /// Resolves the given macro content and returns the resulting value. At `Line` level, this is called for each macro range, passing the strings in those ranges. `{{` and `}}` are removed automatically. You can also provide pure macro strings to do weird tricks.
     @objc public func parseMacro(_ macro: String) -> AnyObject? {
-        // Remove {{, }} and leading/trailing whitespace
-        let trimmedMacro = macro.replacingOccurrences(of: "{{", with: "").replacingOccurrences(of: "}}", with: "").trimmingCharacters(in: .whitespaces)
-        
-        // Separate in two (if applicable)
-        let components = trimmedMacro.split(separator: "=").map { $0.trimmingCharacters(in: .whitespaces) }
-        
-        // Check that macro format is valid
-        guard components.count > 0 else { return nil }
-        
-        var varName = ""
-        var typeName = "string"
-        var parameters = ""
-        var subValue = -1
-        
-        if let leftSide = components.first?.components(separatedBy: " ") {
-            if leftSide.count > 1, let t = leftSide.first?.lowercased().trimmingCharacters(in: .whitespaces) {
-                if typeNames.contains(t) { typeName = t }
-                
-                if typeName == "date" || typeName == "ref" {
-                    parameters = leftSide[1..<leftSide.count].joined(separator: " ")
-                } else {
-                    varName = leftSide[1]
-                }
-            } else {
-                varName = leftSide.first!
-            }
-        }
-        
-        // Variable names are case-insensitive
-        if typeName != "date" { varName = varName.lowercased() }
-        
-        // Check for sub-values for serials
-        if varName.contains(".") && typeName != "date" {
-            // A sub value is something like {{page.sub}} or {{page.sub.sub.sub}}. We get the sub value index by calculating the amount of components called "sub".
-            let components = varName.components(separatedBy: ".")
-            varName = components[0]
-            
-            for i in 1..<components.count {
-                if components[i] == "sub" { subValue += 1 }
-                else { break }
-            }
-        }
-        
-        // Don't let empty macro names through
-        if varName == "", typeName != "date", typeName != "ref", typeName != "references" { print("Invalid macro"); return nil; }
+        return evaluate(BeatMacroParser.compile(macro))
+    }
+    
+    /// Resolves a compiled macro against current state and returns the resulting value.
+    @objc public func evaluate(_ compiled: BeatCompiledMacro) -> AnyObject? {
+        guard compiled.valid else { return nil }
         
-        // Dates and panels don't work as other macros. They can be called just as keywords, {{panel}} or {{date}}, so in these cases we'll make the var name TYPE name and leave actual var name empty.
-        if varName == "date" || varName == "panel" || varName == "references" {
-            typeName = varName
-            varName = ""
-        }
+        let varName = compiled.varName
+        let typeName = compiled.typeName
+        let subValue = compiled.subValue
+        var parameters = compiled.parameters
                 
         // Let's create/fetch the macro now
         let macro:BeatMacro
@@ -126,9 +87,7 @@ import Foundation
         }
 
         // Handle the right side (meaning anything after =)
-        if components.count > 1, macro.type != .reference {
-            let rightSide = components[1]
-            
+        if let rightSide = compiled.rightSide, macro.type != .reference {
             if varType == .serial || varType == .number {
                 let exp = NSExpression(format: rightSide)
                 macro.value = exp.expressionValue(with: nil, context: nil) ?? -1
@@ -141,7 +100,7 @@ import Foundation
         } else if varType == .reference {
             var items = macro.value as? [String] ?? []
             // We'll support using = just to be friendly
-            if components.count > 1 { parameters = components[1] }
+            if let rightSide = compiled.rightSide { parameters = rightSide }
             
             items.append(parameters)
             macro.value = items
@@ -166,11 +125,143 @@ import Foundation
         return macro.resolvedValue(subValue: subValue)
     }
     
+    
+    // MARK: - Compiling
+    
+    private static var compiledMacros: [String: BeatCompiledMacro] = [:]
+    private static let compiledLock = NSLock()
+    
+    /// Returns the compiled form of given macro string. Each distinct macro is tokenized only once, and the result is shared by all parsers.
+    @objc public class func compile(_ macro: String) -> BeatCompiledMacro {
+        compiledLock.lock()
+        defer { compiledLock.unlock() }
+        
+        if let compiled = compiledMacros[macro] { return compiled }
+        
+        // Don't let the cache grow forever when somebody is typing a lot of macros
+        if compiledMacros.count > 2000 { compiledMacros.removeAll() }
+        
+        let compiled = BeatCompiledMacro(macro)
+        compiledMacros[macro] = compiled
+        return compiled
+    }
+    
+    
+    // MARK: - State
+    
+    /// Returns a copy of current parser state
+    @objc public func saveState() -> BeatMacroState {
+        return BeatMacroState(macros: macros.mapValues { $0.copy() }, panel: panel.copy(), references: references.copy())
+    }
+    
+    /// Restores parser to a previously saved state. The saved state is not modified by further evaluation.
+    @objc public func restoreState(_ state: BeatMacroState) {
+        self.macros = state.macros.mapValues { $0.copy() }
+        self.panel = state.panel.copy()
+        self.references = state.references.copy()
+    }
+    
     @objc public func resetPanel() {
         self.panel.value = 0
     }
 }
 
+/// A macro split into its parts. Tokenizing is independent of parser state, so it's done only once per macro string, see `BeatMacroParser.compile()`.
+@objc public final class BeatCompiledMacro:NSObject {
+    static let typeNames = ["string", "serial", "series", "number", "date", "panel", "ref", "references"]
+    
+    /// `false` if the macro has no name and can't be resolved
+    let valid:Bool
+    let typeName:String
+    let varName:String
+    let parameters:String
+    let subValue:Int
+    /// Anything after `=`, if applicable
+    let rightSide:String?
+    
+    init(_ macro:String) {
+        // Remove {{, }} and leading/trailing whitespace
+        let trimmedMacro = macro.replacingOccurrences(of: "{{", with: "").replacingOccurrences(of: "}}", with: "").trimmingCharacters(in: .whitespaces)
+        
+        // Separate in two (if applicable)
+        let components = trimmedMacro.split(separator: "=").map { $0.trimmingCharacters(in: .whitespaces) }
+        
+        var varName = ""
+        var typeName = "string"
+        var parameters = ""
+        var subValue = -1
+        
+        if let leftSide = components.first?.components(separatedBy: " ") {
+            if leftSide.count > 1, let t = leftSide.first?.lowercased().trimmingCharacters(in: .whitespaces) {
+                if BeatCompiledMacro.typeNames.contains(t) { typeName = t }
+                
+                if typeName == "date" || typeName == "ref" {
+                    parameters = leftSide[1..<leftSide.count].joined(separator: " ")
+                } else {
+                    varName = leftSide[1]
+                }
+            } else {
+                varName = leftSide.first!
+            }
+        }
+        
+        // Variable names are case-insensitive
+        if typeName != "date" { varName = varName.lowercased() }
+        
+        // Check for sub-values for serials
+        if varName.contains(".") && typeName != "date" {
+            // A sub value is something like {{page.sub}} or {{page.sub.sub.sub}}. We get the sub value index by calculating the amount of components called "sub".
+            let components = varName.components(separatedBy: ".")
+            varName = components[0]
+            
+            for i in 1..<components.count {
+                if components[i] == "sub" { subValue += 1 }
+                else { break }
+            }
+        }
+        
+        // Check that macro format is valid. Don't let empty macro names through.
+        var valid = components.count > 0
+        if valid, varName == "", typeName != "date", typeName != "ref", typeName != "references" { print("Invalid macro"); valid = false }
+        
+        // Dates and panels don't work as other macros. They can be called just as keywords, {{panel}} or {{date}}, so in these cases we'll make the var name TYPE name and leave actual var name empty.
+        if varName == "date" || varName == "panel" || varName == "references" {
+            typeName = varName
+            varName = ""
+        }
+        
+        self.valid = valid
+        self.typeName = typeName
+        self.varName = varName
+        self.parameters = parameters
+        self.subValue = subValue
+        self.rightSide = (components.count > 1) ? components[1] : nil
+    }
+}
+
+/// A snapshot of macro parser state. Two equal states resolve any following macros to the same values.
+@objc public final class BeatMacroState:NSObject {
+    let macros:[String: BeatMacro]
+    let panel:BeatMacro
+    let references:BeatMacro
+    
+    init(macros: [String : BeatMacro], panel: BeatMacro, references: BeatMacro) {
+        self.macros = macros
+        self.panel = panel
+        self.references = references
+    }
+    
+    public override func isEqual(_ object: Any?) -> Bool {
+        guard let other = object as? BeatMacroState, macros.count == other.macros.count else { return false }
+        guard panel.isEqual(to: other.panel), references.isEqual(to: other.references) else { return false }
+        
+        for (key, macro) in macros {
+            guard let otherMacro = other.macros[key], macro.isEqual(to: otherMacro) else { return false }
+        }
+        return true
+    }
+}
+
 @objc enum MacroType:Int {
     case string, serial, number, date, panel, reference, references
 }
@@ -237,6 +328,25 @@ class BeatMacro {
         }
     }
     
+    func copy() -> BeatMacro {
+        let macro = BeatMacro(name: name, type: type, value: value)
+        macro.subValues = subValues
+        return macro
+    }
+    
+    func isEqual(to other:BeatMacro) -> Bool {
+        guard type == other.type, name == other.name, subValues == other.subValues else { return false }
+        
+        switch (value, other.value) {
+        case (nil, nil):
+            return true
+        case let (a?, b?):
+            return (a as AnyObject as? NSObject)?.isEqual(b as AnyObject) ?? false
+        default:
+            return false
+        }
+    }
+    
     func incrementValue(subValue:Int = -1) {
         if var n = value as? Int, subValue == -1 {
             n += 1
@@ -274,25 +384,26 @@ class BeatMacro {
 
 @objc public extension Line {
     @objc var macros:[NSRange:String] {
-        guard self.string.count > 0 else { return [:] }
+        // Scan UTF-16 units, so the ranges match other ranges on the line
+        let str = self.string as NSString
+        guard str.length > 1 else { return [:] }
         var macros:[NSRange:String] = [:]
         
-        var currentRange:NSRange?
+        var location = -1
+        let open = unichar(0x7B), close = unichar(0x7D)
         
-        for i in 0 ..< string.count - 1 {
-            let c = string[i]
-            let c2 = string[i+1]
+        for i in 0 ..< str.length - 1 {
+            let c = str.character(at: i)
+            let c2 = str.character(at: i+1)
             
-            if c == "{" && c2 == "{" {
-                currentRange = NSMakeRange(i, 0)
+            if c == open && c2 == open {
+                location = i
             }
-            else if c == "}" && c2 == "}" && currentRange != nil {
-                let loc = currentRange!.location
-                currentRange?.length = i - loc
-                
-                macros[NSMakeRange(loc, currentRange!.length + 2)] = String(string.prefix(i).suffix(currentRange!.length - 2))
+            else if c == close && c2 == close && location >= 0 {
+                let length = i - location
+                macros[NSMakeRange(location, length + 2)] = str.substring(with: NSMakeRange(location + 2, max(0, length - 2)))
                 
-                currentRange = nil
+                location = -1
             }
         }
         
@@ -68,7 +68,7 @@ FOUNDATION_EXPORT NSString *const BeatExportSettingInvisibleElements;
 - (BeatPaperSize)pageSize;
 @end
 
-@interface BeatExportSettings : NSObject
+@interface BeatExportSettings : NSObject <NSCopying>
 
 @property (nonatomic, weak) id<BeatExportSettingDelegate> delegate;
 @property (nonatomic) BeatExportOperation operation;
@@ -147,6 +147,35 @@ NSString *const BeatExportSettingInvisibleElements = @"invisibleElements";
     _additionalTypes = additionalTypes;
 }
 
+- (id)copyWithZone:(NSZone *)zone
+{
+    BeatExportSettings* settings = [[BeatExportSettings allocWithZone:zone] init];
+    
+    settings->_delegate = _delegate;
+    settings->_operation = _operation;
+    settings->_header = _header;
+    settings->_headerAlignment = _headerAlignment;
+    settings->_invisibleElements = _invisibleElements;
+    settings->_printNotes = _printNotes;
+    settings->_printSceneNumbers = _printSceneNumbers;
+    settings->_hidePageNumbers = _hidePageNumbers;
+    settings->_additionalTypes = _additionalTypes.copy;
+    settings->_fileName = _fileName;
+    settings->_document = _document;
+    settings->_revisions = _revisions.copy;
+    settings->_paperSize = _paperSize;
+    settings->_simpleSceneHeadings = _simpleSceneHeadings;
+    settings->_printSceneHeadingColors = _printSceneHeadingColors;
+    settings->_styles = _styles;
+    settings->_customCSS = _customCSS;
+    settings->_customStyles = _customStyles;
+    settings->_documentSettings = _documentSettings;
+    settings->_firstPageNumber = _firstPageNumber;
+    settings->_revisionHighlightMode = _revisionHighlightMode;
+    
+    return settings;
+}
+
 - (BeatPaperSize)paperSize
 {
 	// Check paper size
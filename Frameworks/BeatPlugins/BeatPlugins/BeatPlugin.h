@@ -17,6 +17,9 @@
 
 #import <BeatPlugins/BeatPluginManager.h>
 
+@class BeatPluginChangeBatch;
+@class BeatPluginProfiler;
+@class BeatPluginWorker;
 
 #if TARGET_OS_OSX
 
@@ -97,6 +100,8 @@ JSExportAs(objc_call, - (id)objc_call:(NSString*)methodName args:(NSArray*)argum
 - (bool)macOS;
 /// Returns a string, with all instances of `#key#` replaced with localized strings.
 - (NSString*)localize:(NSString*)string;
+/// Profiler for execution times of this plugin
+@property (nonatomic, readonly) BeatPluginProfiler* profiler;
 
 
 #pragma mark Listeners
@@ -324,6 +329,8 @@ JSExportAs(bakeRevisionsInRange, - (void)bakeRevisionsInRange:(NSInteger)loc len
 
 /// Timer array
 @property (nonatomic) NSMutableArray<BeatPluginTimer*>* timers;
+/// Background workers
+@property (nonatomic) NSMutableArray<BeatPluginWorker*>* workers;
 
 
 #pragma mark UI-side stuff for macOS and iOS
@@ -348,6 +355,8 @@ JSExportAs(bakeRevisionsInRange, - (void)bakeRevisionsInRange:(NSInteger)loc len
 - (void)forceEnd;
 
 - (void)runCallback:(JSValue*)callback withArguments:(NSArray*)arguments;
+/// Runs a callback and records its execution time under given label
+- (void)runCallback:(JSValue*)callback withArguments:(NSArray*)arguments label:(NSString*)label;
 
 - (void)addToChangeCount;
 
@@ -370,6 +379,16 @@ JSExportAs(bakeRevisionsInRange, - (void)bakeRevisionsInRange:(NSInteger)loc len
 @property (nonatomic) JSValue* notepadChangeMethod;
 @property (nonatomic) JSValue* documentSavedCallback;
 
+/// Batched change listener and its pending changes
+@property (nonatomic) JSValue* documentChangeMethod;
+@property (nonatomic) BeatPluginChangeBatch* changeBatch;
+/// Delay for delivering batched changes in milliseconds. `0` means that changes are delivered once per run loop turn.
+@property (nonatomic) NSInteger documentChangeDebounce;
+/// Incremented whenever a batch delivery is scheduled, so only the latest one gets delivered
+@property (nonatomic) NSInteger documentChangeToken;
+/// Latest arguments for throttled listeners, waiting to be delivered
+@property (nonatomic) NSMutableDictionary<NSString*, NSArray*>* throttledListenerCalls;
+
 
 #pragma mark Other callbacks and data providers
 
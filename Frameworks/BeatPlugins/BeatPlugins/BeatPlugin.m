@@ -28,6 +28,9 @@
 // Console component
 #import "BeatConsole.h"
 #import "BeatPluginTimer.h"
+#import "BeatPluginVMPool.h"
+#import "BeatPluginProfiler.h"
+#import "BeatPluginWorker.h"
 
 // Extensions and categories
 #import "BeatPlugin+Parser.h"
@@ -80,6 +83,7 @@
 // Getters for these are defined in categories
 @synthesize reviews;
 @synthesize tagging;
+@synthesize profiler = _profiler;
 
 
 + (BeatPlugin*)withName:(NSString*)name delegate:(id<BeatPluginDelegate>)delegate
@@ -129,9 +133,9 @@
 
 - (void)setupVM
 {
-    // Create virtual machine and JS context
-    _vm = [[JSVirtualMachine alloc] init];
-    _context = [[JSContext alloc] initWithVirtualMachine:_vm];
+    // Get a pre-warmed JS context from a shared virtual machine
+    _context = [BeatPluginVMPool.shared dequeueContext];
+    _vm = _context.virtualMachine;
     
     [self setupErrorHandler];
     [self setupRequire];
@@ -194,9 +198,9 @@
 /// Load JavaScript into plugin scope from any path. This is called by the block defined in `setupRequire`.
 - (void)importScript:(NSString *)path {
 	NSError *error;
-	NSString *script = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:&error];
+	NSString *script = [BeatPluginVMPool.shared sourceAtPath:path error:&error];
 	
-	if (error) {
+	if (script == nil) {
 		NSString *errorMsg = [NSString stringWithFormat:@"Error: Could not import JavaScript module '%@'", path.lastPathComponent];
 		[self log:errorMsg];
 		return;
@@ -322,6 +326,11 @@
     [_timers removeAllObjects];
     _timers = nil;
     
+    for (BeatPluginWorker* worker in _workers.copy) {
+        [worker terminate];
+    }
+    _workers = nil;
+    
     [self killSynths];
 }
 
@@ -357,6 +366,9 @@
 	
 	self.plugin = nil;
     self.pluginData = nil;
+    
+    // The plugin has finished, so other plugins can use its VM
+    if (self.context != nil) [BeatPluginVMPool.shared returnContext:self.context];
     self.vm = nil;
     self.context = nil;
     
@@ -366,6 +378,8 @@
     self.updateOutlineMethod = nil;
     self.updatePreviewMethod = nil;
     self.updateSelectionMethod = nil;
+    self.documentChangeMethod = nil;
+    self.changeBatch = nil;
 
     // Remove from the list of running plugins
 	if (_resident) [_delegate.pluginAgent deregisterPlugin:self];
@@ -373,6 +387,11 @@
 
 /// Runs a callback value when a plugin window is closed. We need to finish all callbacks before the plugin itself can be terminated, so we need to jump some extra hoops.
 - (void)runCallback:(JSValue*)callback withArguments:(NSArray*)arguments
+{
+    [self runCallback:callback withArguments:arguments label:@"callback"];
+}
+
+- (void)runCallback:(JSValue*)callback withArguments:(NSArray*)arguments label:(NSString*)label
 {
     if (!callback || callback.isUndefined) return;
         
@@ -380,7 +399,9 @@
         // Callback functions are often called when a plugin window is closed, and we can't close the plugin until all callbacks are done.
         // We'll increment remaining callback number, and if it's zero after this callback is done, we'll give permission to terminate the plugin.
         self.callbacksRemaining += 1;
+        uint64_t start = BeatPluginProfiler.now;
         [callback callWithArguments:arguments];
+        [self.profiler record:label start:start];
         self.callbacksRemaining -= 1;
         
         // If we've reached the end of any callbacks, terminate plugin.
@@ -390,6 +411,15 @@
     });
 }
 
+/// Returns the profiler for this plugin instance. Budget and throttling are set separately for each plugin.
+- (BeatPluginProfiler*)profiler
+{
+    @synchronized (self) {
+        if (_profiler == nil) _profiler = [BeatPluginProfiler.alloc initWithPluginName:self.pluginName];
+        return _profiler;
+    }
+}
+
 /// Check compatibility with Beat version number
 - (bool)compatibleWith:(NSString *)version {
 	return [BeatPluginManager isCompatible:version];
@@ -10,8 +10,13 @@
 
 NS_ASSUME_NONNULL_BEGIN
 
+@class BeatPluginQuery;
+
 @interface BeatPluginAgent : NSObject
 
+/// Cached screenplay aggregations, shared by all plugins in this document. Results are invalidated on each change.
+@property (nonatomic, readonly) BeatPluginQuery* query;
+
 - (instancetype)initWithDelegate:(id<BeatPluginDelegate>)delegate;
 
 - (void)registerPlugin:(id<BeatPluginInstance>)plugin;
@@ -47,6 +52,9 @@ NS_ASSUME_NONNULL_BEGIN
 /// Outline did change
 - (void)updatePluginsWithOutline:(NSArray*)outline changes:(OutlineChanges* _Nullable)changes;
 
+/// Parser removed a line
+- (void)lineWasRemoved:(Line*)line;
+
 /// Make plugins know that window became main.
 /// - note: macOS only
 - (void)notifyPluginsThatWindowBecameMain;
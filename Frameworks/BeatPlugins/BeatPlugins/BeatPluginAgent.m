@@ -15,11 +15,13 @@
 #import <BeatPlugins/BeatPlugin+Listeners.h>
 #import <BeatPlugins/BeatPlugins-Swift.h>
 #import <BeatCore/BeatEditorDelegate.h>
+#import "BeatPluginQuery.h"
 
 @class BeatPlugin;
 
 @interface BeatPluginAgent() <BeatPluginAgentInstance>
 @property (nonatomic, weak) id<BeatPluginDelegate> delegate;
+@property (nonatomic) BeatPluginQuery* query;
 @end
 
 @implementation BeatPluginAgent
@@ -31,6 +33,12 @@
     return self;
 }
 
+- (BeatPluginQuery*)query
+{
+    if (_query == nil) _query = [BeatPluginQuery.alloc initWithDelegate:self.delegate];
+    return _query;
+}
+
 /// Runs a plugin with a name in plugin manager.
 - (void)runPluginWithName:(NSString*)pluginName
 {
@@ -89,12 +97,22 @@
 
 - (void)updatePlugins:(NSRange)range
 {
+    [_query invalidate];
+    
     if (!self.delegate.runningPlugins || self.delegate.documentIsLoading) return;
     for (BeatPlugin* plugin in self.delegate.runningPlugins.allValues) {
         [plugin updateText:range];
     }
 }
 
+- (void)lineWasRemoved:(Line*)line
+{
+    if (!self.delegate.runningPlugins || self.delegate.documentIsLoading) return;
+    for (BeatPlugin* plugin in self.delegate.runningPlugins.allValues) {
+        [plugin lineWasRemoved:line];
+    }
+}
+
 - (void)updatePluginsWithSelection:(NSRange)range
 {
     for (BeatPlugin *plugin in self.delegate.runningPlugins.allValues) {
@@ -111,6 +129,8 @@
 
 - (void)updatePluginsWithOutline:(NSArray*)outline changes:(OutlineChanges* _Nullable)changes
 {
+    [_query invalidate];
+    
     for (BeatPlugin *plugin in self.delegate.runningPlugins.allValues) {
         [plugin updateOutline:changes];
     }
@@ -21,6 +21,7 @@
 #import "BeatPluginManager.h"
 #import <UnzipKit/UnzipKit.h>
 #import "BeatPlugin.h"
+#import "BeatPluginVMPool.h"
 #import <BeatPlugins/BeatPlugins-Swift.h>
 #import <BeatCore/BeatLocalization.h>
 #import <BeatCore/BeatCore-Swift.h>
@@ -93,7 +94,7 @@
     NSError* error;
     
     plugin.url = (self.bundleURL != nil) ? self.bundleURL : self.localURL;
-    plugin.script = [NSString stringWithContentsOfURL:mainScriptURL encoding:NSUTF8StringEncoding error:&error];
+    plugin.script = [BeatPluginVMPool.shared sourceAtPath:mainScriptURL.path error:&error];
 
     
     if (self.isFolder) {
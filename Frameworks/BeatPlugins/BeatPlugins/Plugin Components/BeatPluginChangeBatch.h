@@ -0,0 +1,26 @@
+//
+//  BeatPluginChangeBatch.h
+//  BeatPlugins
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+#import <Foundation/Foundation.h>
+#import <BeatParsing/BeatParsing.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface BeatPluginChangeBatch : NSObject
+/// Incremented on every edit
+@property (nonatomic, readonly) NSInteger version;
+- (instancetype)initWithParser:(ContinuousFountainParser*)parser;
+/// Registers an edit. The range is the changed range in the edited text, and lines around it are compared on next flush.
+- (void)addEditInRange:(NSRange)range;
+/// Registers a line removed by the parser
+- (void)removeLine:(Line*)line;
+- (void)addOutlineChanges:(OutlineChanges* _Nullable)changes;
+/// Returns the changes since last flush and resets the batch
+- (NSDictionary*)flush;
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,173 @@
+//
+//  BeatPluginChangeBatch.m
+//  BeatPlugins
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+/**
+ 
+ Collects document changes for plugins which listen to them in batches (`Beat.onDocumentChange`).
+ 
+ The batch stores the string of each line object as it was when the plugin last heard of it. Edits register the lines around the
+ changed range, and the parser reports any removed lines. When flushed, only those lines are compared against the stored strings,
+ which gives us changed, inserted and removed lines without walking through the whole document. If the line count doesn't add up
+ (the whole text was replaced, for example), every line is compared. Outline changes are merged until the batch is flushed.
+ 
+ Delta object sent to plugins:
+ ```
+ {
+    version: 12,                   // Incremented on every edit
+    changed: ["uuid", ...],        // Lines whose text was edited
+    inserted: ["uuid", ...],       // New lines
+    removed: ["uuid", ...],        // Lines which no longer exist
+    outline: OutlineChanges        // Merged outline changes (or null)
+ }
+ ```
+ 
+ */
+
+#import "BeatPluginChangeBatch.h"
+
+@interface BeatPluginChangeBatch ()
+@property (nonatomic, weak) ContinuousFountainParser* parser;
+/// Line object → line string at the time of last flush
+@property (nonatomic) NSMapTable<Line*, NSString*>* snapshot;
+/// Lines which might have changed since last flush
+@property (nonatomic) NSHashTable<Line*>* touchedLines;
+/// Lines from the snapshot which were removed since last flush
+@property (nonatomic) NSHashTable<Line*>* removedLines;
+@property (nonatomic) OutlineChanges* outlineChanges;
+@property (nonatomic) NSInteger version;
+@end
+
+@implementation BeatPluginChangeBatch
+
+- (instancetype)initWithParser:(ContinuousFountainParser*)parser
+{
+    self = [super init];
+    if (self) {
+        _parser = parser;
+        _snapshot = [self snapshotOfLines:parser.safeLines];
+        _touchedLines = [NSHashTable.alloc initWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality capacity:16];
+        _removedLines = [NSHashTable.alloc initWithOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality capacity:16];
+    }
+    return self;
+}
+
+- (NSMapTable<Line*, NSString*>*)snapshotOfLines:(NSArray<Line*>*)lines
+{
+    NSMapTable* snapshot = [NSMapTable.alloc initWithKeyOptions:NSPointerFunctionsStrongMemory | NSPointerFunctionsObjectPointerPersonality valueOptions:NSPointerFunctionsStrongMemory capacity:lines.count];
+    for (Line* line in lines) [snapshot setObject:line.string.copy forKey:line];
+    return snapshot;
+}
+
+- (void)addEditInRange:(NSRange)range
+{
+    _version += 1;
+    
+    // Lines intersecting the change, and the ones right next to it, as line breaks belong to the preceding line
+    NSArray<Line*>* lines = self.parser.lines;
+    NSInteger first = [self.parser lineIndexAtPosition:range.location];
+    NSInteger last = [self.parser lineIndexAtPosition:NSMaxRange(range)];
+    if (first == NSNotFound || last == NSNotFound) return;
+    
+    first = MAX(first - 1, 0);
+    last = MIN(last + 1, (NSInteger)lines.count - 1);
+    
+    for (NSInteger i = first; i <= last; i++) [_touchedLines addObject:lines[i]];
+}
+
+- (void)removeLine:(Line*)line
+{
+    [_touchedLines removeObject:line];
+    // Lines which were inserted and removed within the same batch never existed as far as the plugin is concerned
+    if ([_snapshot objectForKey:line] != nil) [_removedLines addObject:line];
+}
+
+- (void)addOutlineChanges:(OutlineChanges*)changes
+{
+    if (changes == nil || !changes.hasChanges) return;
+    
+    if (_outlineChanges == nil) _outlineChanges = OutlineChanges.new;
+    OutlineChanges* pending = _outlineChanges;
+    
+    [pending.added unionSet:changes.added];
+    [pending.updated unionSet:changes.updated];
+    [pending.removed unionSet:changes.removed];
+    pending.needsFullUpdate = pending.needsFullUpdate || changes.needsFullUpdate;
+    
+    // Scenes which were both added and removed within the batch never existed as far as the plugin is concerned
+    NSMutableSet* addedAndRemoved = [NSMutableSet setWithSet:pending.added];
+    [addedAndRemoved intersectSet:pending.removed];
+    
+    [pending.added minusSet:addedAndRemoved];
+    [pending.removed minusSet:addedAndRemoved];
+    [pending.updated minusSet:pending.removed];
+    [pending.updated minusSet:pending.added];
+}
+
+- (NSDictionary*)flush
+{
+    NSArray<Line*>* lines = self.parser.safeLines;
+    
+    NSMutableArray<NSString*>* changed = NSMutableArray.new;
+    NSMutableArray<NSString*>* inserted = NSMutableArray.new;
+    NSMutableArray<NSString*>* removed = NSMutableArray.new;
+    
+    NSInteger insertedCount = 0;
+    for (Line* line in _touchedLines) {
+        if ([_snapshot objectForKey:line] == nil) insertedCount += 1;
+    }
+    
+    if (_snapshot.count - _removedLines.count + insertedCount == lines.count) {
+        // Only compare lines which were touched by edits
+        for (Line* line in _touchedLines) {
+            NSString* string = [_snapshot objectForKey:line];
+            
+            if (string == nil) [inserted addObject:line.uuidString];
+            else if (string != line.string && ![string isEqualToString:line.string]) [changed addObject:line.uuidString];
+            else continue;
+            
+            [_snapshot setObject:line.string.copy forKey:line];
+        }
+        
+        for (Line* line in _removedLines) {
+            [removed addObject:line.uuidString];
+            [_snapshot removeObjectForKey:line];
+        }
+    } else {
+        // Lines were added or removed without us knowing, so we'll have to compare everything
+        NSMapTable<Line*, NSString*>* previous = _snapshot;
+        NSMapTable<Line*, NSString*>* current = [self snapshotOfLines:lines];
+        
+        for (Line* line in lines) {
+            NSString* string = [previous objectForKey:line];
+            
+            if (string == nil) [inserted addObject:line.uuidString];
+            else if (string != line.string && ![string isEqualToString:line.string]) [changed addObject:line.uuidString];
+        }
+        
+        for (Line* line in previous.keyEnumerator) {
+            if ([current objectForKey:line] == nil) [removed addObject:line.uuidString];
+        }
+        
+        _snapshot = current;
+    }
+    
+    [_touchedLines removeAllObjects];
+    [_removedLines removeAllObjects];
+    
+    id outline = (_outlineChanges != nil) ? _outlineChanges : NSNull.null;
+    _outlineChanges = nil;
+    
+    return @{
+        @"version": @(_version),
+        @"changed": changed,
+        @"inserted": inserted,
+        @"removed": removed,
+        @"outline": outline
+    };
+}
+
+@end
@@ -0,0 +1,49 @@
+//
+//  BeatPluginDocumentSnapshot.h
+//  BeatPlugins
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+#import <Foundation/Foundation.h>
+#import <JavaScriptCore/JavaScriptCore.h>
+#import <BeatParsing/BeatParsing.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@protocol BeatPluginDocumentSnapshotExports <JSExport>
+/// Number of lines in snapshot
+@property (nonatomic, readonly) NSInteger count;
+/// Number of scenes in snapshot
+@property (nonatomic, readonly) NSInteger sceneCount;
+
+/// Line positions as `Int32Array`
+@property (nonatomic, readonly) JSValue* positions;
+/// Line lengths as `Int32Array`
+@property (nonatomic, readonly) JSValue* lengths;
+/// Line types as `Int32Array`
+@property (nonatomic, readonly) JSValue* types;
+
+/// Returns the string of given line without creating a line object
+- (NSString* _Nullable)string:(NSInteger)index;
+/// Returns the line at given index
+- (Line* _Nullable)line:(NSInteger)index;
+/// Returns lines in given index range
+JSExportAs(lines, - (NSArray<Line*>*)linesFrom:(NSInteger)index length:(NSInteger)length);
+/// Returns all lines of given type
+- (NSArray<Line*>*)linesOfType:(LineType)type;
+/// Returns the scene at given index
+- (OutlineScene* _Nullable)scene:(NSInteger)index;
+/// Returns scenes in given index range
+JSExportAs(scenes, - (NSArray<OutlineScene*>*)scenesFrom:(NSInteger)index length:(NSInteger)length);
+/// Returns the full outline, including sections
+- (NSArray<OutlineScene*>*)outline;
+@end
+
+@interface BeatPluginDocumentSnapshot : NSObject <BeatPluginDocumentSnapshotExports>
+- (instancetype)initWithParser:(ContinuousFountainParser*)parser;
+/// Set `detached` when the parser holds cloned lines which are not shared with the editor. Its lines are then used as is, instead of cloning them on main thread.
+- (instancetype)initWithParser:(ContinuousFountainParser*)parser detached:(bool)detached;
+@end
+
+NS_ASSUME_NONNULL_END
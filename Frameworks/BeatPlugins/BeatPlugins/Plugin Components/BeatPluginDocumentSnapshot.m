@@ -0,0 +1,202 @@
+//
+//  BeatPluginDocumentSnapshot.m
+//  BeatPlugins
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+/**
+ 
+ Read-only view of the document for plugins which need to scan through the whole screenplay (`Beat.snapshot()`).
+ 
+ Instead of serializing every line into JSON, the snapshot only stores line references, strings and a few numeric columns,
+ which are handed to JavaScript as typed arrays. Each array is a copy of the column, so plugins can modify them freely without affecting
+ native lookups. Line and scene objects are only bridged when they are requested, and their properties are materialized one by one as the plugin reads them.
+ 
+ ```
+ const doc = Beat.snapshot()
+ const types = doc.types
+ for (let i = 0; i < doc.count; i++) {
+    if (types[i] == Beat.type.dialogue) words += doc.string(i).split(" ").length
+ }
+ ```
+ 
+ Everything in the snapshot reflects the moment it was taken. Lines are cloned on main thread when the snapshot is created, and the
+ outline is built from the clones, so line and scene objects can be read on any thread while the user keeps editing.
+ 
+ */
+
+#import "BeatPluginDocumentSnapshot.h"
+
+@interface BeatPluginDocumentSnapshot ()
+@property (nonatomic) NSArray<Line*>* lineObjects;
+@property (nonatomic) NSArray<NSString*>* strings;
+@property (nonatomic) NSArray<OutlineScene*>* sceneObjects;
+@property (nonatomic) NSArray<OutlineScene*>* outlineObjects;
+
+@property (nonatomic) NSData* positionData;
+@property (nonatomic) NSData* lengthData;
+@property (nonatomic) NSData* typeData;
+@end
+
+@implementation BeatPluginDocumentSnapshot
+
+- (instancetype)initWithParser:(ContinuousFountainParser*)parser
+{
+    return [self initWithParser:parser detached:false];
+}
+
+- (instancetype)initWithParser:(ContinuousFountainParser*)parser detached:(bool)detached
+{
+    self = [super init];
+    if (self) {
+        // Live lines can only be read safely on main thread
+        if (!detached) {
+            __block ContinuousFountainParser* clone;
+            if (NSThread.isMainThread) clone = [self detachedCopyOf:parser];
+            else dispatch_sync(dispatch_get_main_queue(), ^{ clone = [self detachedCopyOf:parser]; });
+            parser = clone;
+        }
+        
+        NSArray<Line*>* lines = parser.safeLines.copy;
+        NSInteger count = lines.count;
+        
+        NSMutableArray<NSString*>* strings = [NSMutableArray arrayWithCapacity:count];
+        NSMutableData* positions = [NSMutableData dataWithLength:count * sizeof(int32_t)];
+        NSMutableData* lengths = [NSMutableData dataWithLength:count * sizeof(int32_t)];
+        NSMutableData* types = [NSMutableData dataWithLength:count * sizeof(int32_t)];
+        
+        int32_t* p = positions.mutableBytes;
+        int32_t* l = lengths.mutableBytes;
+        int32_t* t = types.mutableBytes;
+        
+        for (NSInteger i = 0; i < count; i++) {
+            Line* line = lines[i];
+            NSString* string = line.string.copy;
+            
+            [strings addObject:(string != nil) ? string : @""];
+            p[i] = (int32_t)line.position;
+            l[i] = (int32_t)string.length;
+            t[i] = (int32_t)line.type;
+        }
+        
+        _lineObjects = lines;
+        _strings = strings;
+        _positionData = positions;
+        _lengthData = lengths;
+        _typeData = types;
+        
+        _sceneObjects = parser.scenes.copy;
+        _outlineObjects = (parser.outline != nil) ? parser.outline.copy : @[];
+    }
+    return self;
+}
+
+
+#pragma mark - Columns
+
+- (NSInteger)count { return _lineObjects.count; }
+- (NSInteger)sceneCount { return _sceneObjects.count; }
+
+- (JSValue*)positions { return [self typedArrayWithData:_positionData]; }
+- (JSValue*)lengths { return [self typedArrayWithData:_lengthData]; }
+- (JSValue*)types { return [self typedArrayWithData:_typeData]; }
+
+static void BeatPluginReleaseColumn(void* bytes, void* deallocatorContext)
+{
+    CFRelease(deallocatorContext);
+}
+
+/// Wraps a copy of the column into an `Int32Array`. Typed arrays are writable, so JavaScript never gets the data used for native lookups. The array keeps the copy alive for as long as JavaScript holds on to it.
+- (JSValue*)typedArrayWithData:(NSData*)data
+{
+    JSContext* context = JSContext.currentContext;
+    if (context == nil) return nil;
+    
+    NSMutableData* copy = data.mutableCopy;
+    
+    JSValueRef exception = NULL;
+    JSObjectRef array = JSObjectMakeTypedArrayWithBytesNoCopy(context.JSGlobalContextRef, kJSTypedArrayTypeInt32Array, copy.mutableBytes, copy.length, BeatPluginReleaseColumn, (void*)CFBridgingRetain(copy), &exception);
+    
+    if (array == NULL || exception != NULL) return [JSValue valueWithUndefinedInContext:context];
+    return [JSValue valueWithJSValueRef:array inContext:context];
+}
+
+
+#pragma mark - Lines
+
+- (NSString*)string:(NSInteger)index
+{
+    if (index < 0 || index >= _strings.count) return nil;
+    return _strings[index];
+}
+
+- (Line*)line:(NSInteger)index
+{
+    if (index < 0 || index >= _lineObjects.count) return nil;
+    return _lineObjects[index];
+}
+
+- (NSArray<Line*>*)linesFrom:(NSInteger)index length:(NSInteger)length
+{
+    NSRange range = [self clampedRange:NSMakeRange(MAX(index, 0), MAX(length, 0)) count:_lineObjects.count];
+    return [_lineObjects subarrayWithRange:range];
+}
+
+- (NSArray<Line*>*)linesOfType:(LineType)type
+{
+    NSMutableArray* lines = NSMutableArray.new;
+    const int32_t* types = _typeData.bytes;
+    
+    for (NSInteger i = 0; i < _lineObjects.count; i++) {
+        if (types[i] == (int32_t)type) [lines addObject:_lineObjects[i]];
+    }
+    
+    return lines;
+}
+
+/// Returns a parser which holds clones of the given lines and an outline built from them. Has to be called on main thread.
+- (ContinuousFountainParser*)detachedCopyOf:(ContinuousFountainParser*)parser
+{
+    NSArray<Line*>* lines = parser.safeLines;
+    NSMutableArray<Line*>* clones = [NSMutableArray arrayWithCapacity:lines.count];
+    for (Line* line in lines) [clones addObject:line.clone];
+    
+    ContinuousFountainParser* copy = ContinuousFountainParser.new;
+    copy.lines = clones;
+    [copy updateOutline];
+    
+    return copy;
+}
+
+
+#pragma mark - Scenes
+
+- (OutlineScene*)scene:(NSInteger)index
+{
+    if (index < 0 || index >= _sceneObjects.count) return nil;
+    return _sceneObjects[index];
+}
+
+- (NSArray<OutlineScene*>*)scenesFrom:(NSInteger)index length:(NSInteger)length
+{
+    NSRange range = [self clampedRange:NSMakeRange(MAX(index, 0), MAX(length, 0)) count:_sceneObjects.count];
+    return [_sceneObjects subarrayWithRange:range];
+}
+
+- (NSArray<OutlineScene*>*)outline
+{
+    return _outlineObjects;
+}
+
+
+#pragma mark - Helpers
+
+- (NSRange)clampedRange:(NSRange)range count:(NSInteger)count
+{
+    if (range.location >= count) return NSMakeRange(count, 0);
+    if (NSMaxRange(range) > count) range.length = count - range.location;
+    return range;
+}
+
+@end
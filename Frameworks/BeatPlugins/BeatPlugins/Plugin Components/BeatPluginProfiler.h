@@ -0,0 +1,42 @@
+//
+//  BeatPluginProfiler.h
+//  BeatPlugins
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+#import <Foundation/Foundation.h>
+#import <JavaScriptCore/JavaScriptCore.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@protocol BeatPluginProfilerExports <JSExport>
+/// Soft time budget for a single listener call of this plugin, in milliseconds. Calls exceeding the budget are logged to console.
+@property (nonatomic) NSInteger budget;
+/// When `true`, listeners of this plugin which keep going over budget are throttled
+@property (nonatomic) bool throttling;
+/// Human-readable report of all plugins
+- (NSString*)report;
+/// All measurements as JSON
+- (NSString*)json;
+/// Clears all measurements
+- (void)reset;
+@end
+
+/// Each plugin instance has its own profiler, which holds its budget and throttling settings. Measurements of all plugins are collected in one place, so reports cover every plugin.
+@interface BeatPluginProfiler : NSObject <BeatPluginProfilerExports>
+@property (nonatomic, readonly) NSString* pluginName;
+
+- (instancetype)initWithPluginName:(NSString*)pluginName;
+
+/// Returns the current time for measurements
++ (uint64_t)now;
+/// Records a call which started at given time (see `now`). Returns `true` if the call went over budget.
+- (bool)record:(NSString*)callback start:(uint64_t)start;
+/// Counts calls to heavy API methods
+- (void)countCall:(NSString*)method;
+/// Returns the time in seconds for which the given listener should not be called, or `0` if it's not throttled
+- (NSTimeInterval)throttleIntervalFor:(NSString*)callback;
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,288 @@
+//
+//  BeatPluginProfiler.m
+//  BeatPlugins
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+/**
+ 
+ Collects execution times of plugin callbacks, so that it's possible to see which plugin slows down the editor.
+ 
+ Each plugin has its own timing statistics for every callback type (`onTextChange`, `timer`, `dispatch` etc.), including a histogram,
+ maximum duration and how much of the time was spent on main thread. Calls to heavy API methods, such as `Beat.lines()`, are counted too.
+ 
+ Listener calls which exceed the soft budget are logged to console. If throttling is enabled and a listener goes over budget several
+ times in a row, it will only be called once per throttle interval until it becomes fast again. Budget and throttling are set for each
+ plugin instance separately, so one plugin can't change them for others.
+ 
+ The profiler is available to plugins and console as `Beat.profiler`, ie. `Beat.profiler.report()` or `Beat.profiler.json()`.
+ 
+ */
+
+#import "BeatPluginProfiler.h"
+#import "BeatConsole.h"
+
+/// Histogram bucket limits in milliseconds. The last bucket contains everything above the last limit.
+static const double BeatProfilerBuckets[] = { 1.0, 4.0, 16.0, 50.0, 100.0 };
+#define BEAT_PROFILER_BUCKET_COUNT 6
+/// Number of consecutive over-budget calls before a listener is throttled
+#define BEAT_PROFILER_THROTTLE_LIMIT 3
+/// Throttled listeners are called at most once per this interval (seconds)
+#define BEAT_PROFILER_THROTTLE_INTERVAL 0.5
+
+@interface BeatCallbackProfile : NSObject
+@property (nonatomic) NSInteger count;
+@property (nonatomic) double total;
+@property (nonatomic) double max;
+@property (nonatomic) double mainThreadTotal;
+@property (nonatomic) NSInteger overBudget;
+@property (nonatomic) NSInteger consecutiveOverBudget;
+@property (nonatomic) uint64_t lastCall;
+@end
+
+@implementation BeatCallbackProfile {
+    @public NSInteger histogram[BEAT_PROFILER_BUCKET_COUNT];
+}
+@end
+
+/// Measurements of all plugins. Access only while synchronized on the store.
+@interface BeatPluginProfileStore : NSObject
+/// Plugin name → callback name → profile
+@property (nonatomic) NSMutableDictionary<NSString*, NSMutableDictionary<NSString*, BeatCallbackProfile*>*>* profiles;
+/// Plugin name → method name → call count
+@property (nonatomic) NSMutableDictionary<NSString*, NSMutableDictionary<NSString*, NSNumber*>*>* apiCalls;
+@end
+
+@implementation BeatPluginProfileStore
+
++ (BeatPluginProfileStore*)shared
+{
+    static BeatPluginProfileStore* store;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        store = BeatPluginProfileStore.new;
+    });
+    return store;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _profiles = NSMutableDictionary.new;
+        _apiCalls = NSMutableDictionary.new;
+    }
+    return self;
+}
+
+- (BeatCallbackProfile*)profileFor:(NSString*)callback plugin:(NSString*)pluginName
+{
+    NSMutableDictionary* callbacks = _profiles[pluginName];
+    if (callbacks == nil) {
+        callbacks = NSMutableDictionary.new;
+        _profiles[pluginName] = callbacks;
+    }
+    
+    BeatCallbackProfile* profile = callbacks[callback];
+    if (profile == nil) {
+        profile = BeatCallbackProfile.new;
+        callbacks[callback] = profile;
+    }
+    
+    return profile;
+}
+
+@end
+
+@interface BeatPluginProfiler ()
+@property (nonatomic) BeatPluginProfileStore* store;
+@end
+
+@implementation BeatPluginProfiler
+
+- (instancetype)initWithPluginName:(NSString*)pluginName
+{
+    self = [super init];
+    if (self) {
+        _pluginName = (pluginName != nil) ? pluginName.copy : @"";
+        _store = BeatPluginProfileStore.shared;
+        _budget = 16;
+        _throttling = false;
+    }
+    return self;
+}
+
++ (uint64_t)now
+{
+    return clock_gettime_nsec_np(CLOCK_UPTIME_RAW);
+}
+
+
+#pragma mark - Recording
+
+- (bool)record:(NSString*)callback start:(uint64_t)start
+{
+    uint64_t end = BeatPluginProfiler.now;
+    double ms = (double)(end - start) / 1000000.0;
+    bool mainThread = NSThread.isMainThread;
+    bool overBudget = false;
+    
+    @synchronized (_store) {
+        BeatCallbackProfile* profile = [_store profileFor:callback plugin:_pluginName];
+        
+        profile.count += 1;
+        profile.total += ms;
+        profile.max = MAX(profile.max, ms);
+        profile.lastCall = end;
+        if (mainThread) profile.mainThreadTotal += ms;
+        
+        NSInteger bucket = 0;
+        while (bucket < BEAT_PROFILER_BUCKET_COUNT - 1 && ms >= BeatProfilerBuckets[bucket]) bucket++;
+        profile->histogram[bucket] += 1;
+        
+        // Only main thread work can slow down typing
+        overBudget = (mainThread && _budget > 0 && ms > _budget);
+        if (overBudget) {
+            profile.overBudget += 1;
+            profile.consecutiveOverBudget += 1;
+        } else {
+            profile.consecutiveOverBudget = 0;
+        }
+    }
+    
+    if (overBudget) {
+        NSString* message = [NSString stringWithFormat:@"%@ took %.1f ms (budget %lu ms)", callback, ms, (unsigned long)_budget];
+        [BeatConsole.shared logToConsole:message pluginName:_pluginName context:nil];
+    }
+    
+    return overBudget;
+}
+
+- (void)countCall:(NSString*)method
+{
+    @synchronized (_store) {
+        NSMutableDictionary* calls = _store.apiCalls[_pluginName];
+        if (calls == nil) {
+            calls = NSMutableDictionary.new;
+            _store.apiCalls[_pluginName] = calls;
+        }
+        calls[method] = @([calls[method] integerValue] + 1);
+    }
+}
+
+- (NSTimeInterval)throttleIntervalFor:(NSString*)callback
+{
+    if (!_throttling) return 0.0;
+    
+    @synchronized (_store) {
+        BeatCallbackProfile* profile = _store.profiles[_pluginName][callback];
+        if (profile == nil || profile.consecutiveOverBudget < BEAT_PROFILER_THROTTLE_LIMIT) return 0.0;
+        
+        double elapsed = (double)(BeatPluginProfiler.now - profile.lastCall) / 1000000000.0;
+        return MAX(BEAT_PROFILER_THROTTLE_INTERVAL - elapsed, 0.0);
+    }
+}
+
+/// Clears measurements of all plugins
+- (void)reset
+{
+    @synchronized (_store) {
+        [_store.profiles removeAllObjects];
+        [_store.apiCalls removeAllObjects];
+    }
+}
+
+
+#pragma mark - Results
+
+- (NSDictionary*)results
+{
+    NSMutableDictionary* results = NSMutableDictionary.new;
+    
+    @synchronized (_store) {
+        NSDictionary* profiles = _store.profiles;
+        NSDictionary* apiCalls = _store.apiCalls;
+        
+        NSMutableSet* pluginNames = [NSMutableSet setWithArray:profiles.allKeys];
+        [pluginNames addObjectsFromArray:apiCalls.allKeys];
+        
+        for (NSString* pluginName in pluginNames) {
+            NSMutableDictionary* callbacks = NSMutableDictionary.new;
+            double mainThreadTotal = 0.0;
+            
+            for (NSString* name in profiles[pluginName]) {
+                BeatCallbackProfile* profile = profiles[pluginName][name];
+                mainThreadTotal += profile.mainThreadTotal;
+                
+                NSMutableArray* histogram = NSMutableArray.new;
+                for (NSInteger i = 0; i < BEAT_PROFILER_BUCKET_COUNT; i++) [histogram addObject:@(profile->histogram[i])];
+                
+                callbacks[name] = @{
+                    @"count": @(profile.count),
+                    @"total": @(profile.total),
+                    @"mean": @((profile.count > 0) ? profile.total / profile.count : 0.0),
+                    @"max": @(profile.max),
+                    @"mainThread": @(profile.mainThreadTotal),
+                    @"overBudget": @(profile.overBudget),
+                    @"histogram": histogram
+                };
+            }
+            
+            results[pluginName] = @{
+                @"callbacks": callbacks,
+                @"mainThread": @(mainThreadTotal),
+                @"apiCalls": (apiCalls[pluginName] != nil) ? [apiCalls[pluginName] copy] : @{}
+            };
+        }
+    }
+    
+    return results;
+}
+
+- (NSString*)json
+{
+    NSMutableArray* limits = NSMutableArray.new;
+    for (NSInteger i = 0; i < BEAT_PROFILER_BUCKET_COUNT - 1; i++) [limits addObject:@(BeatProfilerBuckets[i])];
+    
+    NSDictionary* dump = @{
+        @"budget": @(_budget),
+        @"histogramLimits": limits,
+        @"plugins": self.results
+    };
+    
+    NSData* data = [NSJSONSerialization dataWithJSONObject:dump options:NSJSONWritingPrettyPrinted error:nil];
+    return (data != nil) ? [NSString.alloc initWithData:data encoding:NSUTF8StringEncoding] : @"{}";
+}
+
+- (NSString*)report
+{
+    NSDictionary* results = self.results;
+    NSMutableString* report = NSMutableString.new;
+    
+    // Sort plugins by the time they've spent on main thread
+    NSArray* pluginNames = [results keysSortedByValueUsingComparator:^NSComparisonResult(NSDictionary* a, NSDictionary* b) {
+        return [b[@"mainThread"] compare:a[@"mainThread"]];
+    }];
+    
+    for (NSString* pluginName in pluginNames) {
+        NSDictionary* plugin = results[pluginName];
+        [report appendFormat:@"\n%@ — main thread %.1f ms\n", pluginName, [plugin[@"mainThread"] doubleValue]];
+        
+        NSDictionary* callbacks = plugin[@"callbacks"];
+        for (NSString* name in [callbacks.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+            NSDictionary* c = callbacks[name];
+            [report appendFormat:@"   %@: %@ calls, mean %.2f ms, max %.2f ms, over budget %@, histogram %@\n", name, c[@"count"], [c[@"mean"] doubleValue], [c[@"max"] doubleValue], c[@"overBudget"], [c[@"histogram"] componentsJoinedByString:@"/"]];
+        }
+        
+        NSDictionary* apiCalls = plugin[@"apiCalls"];
+        for (NSString* method in [apiCalls.allKeys sortedArrayUsingSelector:@selector(compare:)]) {
+            [report appendFormat:@"   %@(): %@ calls\n", method, apiCalls[method]];
+        }
+    }
+    
+    if (report.length == 0) return @"No plugin activity recorded";
+    return report;
+}
+
+@end
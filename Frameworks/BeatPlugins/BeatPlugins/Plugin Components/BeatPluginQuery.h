@@ -0,0 +1,44 @@
+//
+//  BeatPluginQuery.h
+//  BeatPlugins
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+#import <Foundation/Foundation.h>
+#import <JavaScriptCore/JavaScriptCore.h>
+#import <BeatParsing/BeatParsing.h>
+
+@protocol BeatEditorDelegate;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@protocol BeatPluginQueryExports <JSExport>
+/// Document version the cached results were calculated for
+@property (nonatomic, readonly) NSUInteger version;
+
+/// Totals for the whole document: `{ words, glyphs, lines, scenes, pages, eighths }`
+- (NSDictionary*)totals;
+/// Characters: `{ NAME: { cues, words, scenes } }`
+- (NSDictionary*)characters;
+/// Scene headings in order: `[{ index, uuid, heading, sceneNumber, location, intExt, time, lines, words, characters, omitted }]`. Pass `true` to include `eighths: [pages, eighths]` from current pagination.
+JSExportAs(scenes, - (NSArray*)scenesWithEighths:(bool)eighths);
+/// Locations: `{ LOCATION: { scenes, eighths } }`
+- (NSDictionary*)locations;
+/// Scene counts by prefix: `{ interior, exterior, both, other }`
+- (NSDictionary*)intExt;
+/// Scene counts by time of day: `{ DAY: 3, NIGHT: 2 }`
+- (NSDictionary*)timesOfDay;
+/// Tags by category: `{ category: { tag name: { count, scenes } } }`
+- (NSDictionary*)tags;
+/// Revisions by generation: `{ level: { lines, characters } }`
+- (NSDictionary*)revisions;
+/// Drops cached results. Results are refreshed automatically after edits, so this is only needed when tags or revisions were changed without editing the text.
+- (void)invalidate;
+@end
+
+@interface BeatPluginQuery : NSObject <BeatPluginQueryExports>
+- (instancetype)initWithDelegate:(id<BeatEditorDelegate>)delegate;
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,524 @@
+//
+//  BeatPluginQuery.m
+//  BeatPlugins
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+/**
+
+ Native aggregations for plugins (`Beat.query()`). Statistics-style plugins used to fetch every line as JSON and
+ count words, characters and scene metadata in JavaScript on each refresh, which took a noticeable moment on feature-length scripts.
+
+ All groupings are calculated in a single pass over parsed lines and cached until the document changes. The query object is
+ shared by all plugins in the same document, so several plugins asking for the same numbers only pay for it once.
+
+ Revisions and tags are read straight from editor attributes, so they are up to date without baking anything into lines. Lines and
+ attributes are always captured on main thread. When a plugin asks for results in background, the capture is dispatched to main thread
+ and the actual calculation runs on cloned lines in the calling thread.
+
+ ```
+ const query = Beat.query()
+ const characters = query.characters()
+ const scenes = query.scenes(true) // Include eighths
+ ```
+
+ Page eighths come from the current pagination, so they are only available once the preview has been paginated.
+
+ */
+
+#import "BeatPluginQuery.h"
+#import <BeatCore/BeatCore.h>
+#import <BeatCore/BeatEditorDelegate.h>
+#import <BeatPagination2/BeatPagination2.h>
+#import <BeatPagination2/BeatPagination2-Swift.h>
+
+/// Counts whitespace-separated words without allocating substrings
+static NSInteger BeatQueryWordCount(NSString* string)
+{
+    NSInteger length = string.length;
+    if (length == 0) return 0;
+
+    CFStringInlineBuffer buffer;
+    CFStringInitInlineBuffer((CFStringRef)string, &buffer, CFRangeMake(0, length));
+    NSCharacterSet* whitespace = NSCharacterSet.whitespaceAndNewlineCharacterSet;
+
+    NSInteger words = 0;
+    bool inWord = false;
+    for (NSInteger i = 0; i < length; i++) {
+        unichar c = CFStringGetCharacterFromInlineBuffer(&buffer, i);
+        bool space = [whitespace characterIsMember:c];
+        if (!space && !inWord) words++;
+        inWord = !space;
+    }
+
+    return words;
+}
+
+@interface BeatPluginQuery ()
+@property (nonatomic, weak) id<BeatEditorDelegate> delegate;
+@property (nonatomic) NSUInteger version;
+@property (nonatomic) NSDictionary* results;
+/// Outline scene objects, in the same order as scene records
+@property (nonatomic) NSArray<OutlineScene*>* sceneObjects;
+
+/// Scene lengths in eighths, valid for the pagination they were calculated from
+@property (nonatomic) NSArray<NSNumber*>* sceneEighths;
+@property (nonatomic, weak) BeatPagination* eighthsPagination;
+@end
+
+@implementation BeatPluginQuery
+
+- (instancetype)initWithDelegate:(id<BeatEditorDelegate>)delegate
+{
+    self = [super init];
+    if (self) _delegate = delegate;
+    return self;
+}
+
+- (void)invalidate
+{
+    @synchronized (self) {
+        _version++;
+        _results = nil;
+        _sceneObjects = nil;
+        _sceneEighths = nil;
+    }
+}
+
+
+#pragma mark - Results
+
+- (NSDictionary*)totals
+{
+    NSMutableDictionary* totals = [self.results[@"totals"] mutableCopy];
+
+    BeatPaginationManager* pagination = self.delegate.pagination;
+    if (pagination.finishedPagination != nil) {
+        NSArray<NSNumber*>* length = pagination.lengthInEights;
+        totals[@"pages"] = length.firstObject;
+        totals[@"eighths"] = length.lastObject;
+    }
+
+    return totals;
+}
+
+- (NSDictionary*)characters { return self.results[@"characters"]; }
+- (NSDictionary*)intExt { return self.results[@"intExt"]; }
+- (NSDictionary*)timesOfDay { return self.results[@"timesOfDay"]; }
+- (NSDictionary*)tags { return self.results[@"tags"]; }
+- (NSDictionary*)revisions { return self.results[@"revisions"]; }
+
+- (NSArray*)scenesWithEighths:(bool)eighths
+{
+    NSArray<NSDictionary*>* scenes = self.results[@"scenes"];
+    NSArray<NSNumber*>* lengths = (eighths) ? [self eighthsForScenes] : nil;
+    if (lengths == nil) return scenes;
+
+    NSMutableArray* result = [NSMutableArray arrayWithCapacity:scenes.count];
+    for (NSInteger i = 0; i < scenes.count; i++) {
+        NSMutableDictionary* scene = scenes[i].mutableCopy;
+        scene[@"eighths"] = [self pagesAndEighths:lengths[i].integerValue];
+        [result addObject:scene];
+    }
+    return result;
+}
+
+- (NSDictionary*)locations
+{
+    NSDictionary<NSString*, NSDictionary*>* locations = self.results[@"locations"];
+    NSArray<NSNumber*>* lengths = [self eighthsForScenes];
+    if (lengths == nil) return locations;
+
+    // Sum up scene lengths for each location
+    NSMutableDictionary<NSString*, NSNumber*>* eighths = NSMutableDictionary.new;
+    NSArray<NSDictionary*>* scenes = self.results[@"scenes"];
+    for (NSInteger i = 0; i < scenes.count && i < lengths.count; i++) {
+        NSString* location = scenes[i][@"location"];
+        if ([scenes[i][@"omitted"] boolValue] || location.length == 0) continue;
+        eighths[location] = @(eighths[location].integerValue + lengths[i].integerValue);
+    }
+
+    NSMutableDictionary* result = [NSMutableDictionary dictionaryWithCapacity:locations.count];
+    for (NSString* location in locations) {
+        NSMutableDictionary* item = locations[location].mutableCopy;
+        item[@"eighths"] = [self pagesAndEighths:eighths[location].integerValue];
+        result[location] = item;
+    }
+    return result;
+}
+
+/// Returns `[pages, eighths]` for given number of eighths
+- (NSArray<NSNumber*>*)pagesAndEighths:(NSInteger)eighths
+{
+    return @[@(eighths / 8), @(eighths % 8)];
+}
+
+
+#pragma mark - Pagination
+
+/// Returns the length of each scene in eighths, or `nil` if there is no finished pagination
+- (NSArray<NSNumber*>*)eighthsForScenes
+{
+    BeatPaginationManager* pagination = self.delegate.pagination;
+    BeatPagination* finishedPagination = pagination.finishedPagination;
+    if (finishedPagination == nil) return nil;
+
+    NSDictionary* results = self.results;
+
+    @synchronized (self) {
+        if (_sceneEighths != nil && _eighthsPagination == finishedPagination) return _sceneEighths;
+        if (results != _results) return nil; // Invalidated while we were waiting
+
+        NSMutableArray<NSNumber*>* lengths = [NSMutableArray arrayWithCapacity:_sceneObjects.count];
+        for (OutlineScene* scene in _sceneObjects) {
+            if (![scene isKindOfClass:OutlineScene.class]) {
+                [lengths addObject:@0];
+                continue;
+            }
+
+            NSArray<NSNumber*>* length = [pagination sceneLengthInEights:scene];
+            NSInteger eighths = (length.count == 2) ? length[0].integerValue * 8 + length[1].integerValue : 0;
+            [lengths addObject:@(eighths)];
+        }
+
+        _sceneEighths = lengths;
+        _eighthsPagination = finishedPagination;
+        return lengths;
+    }
+}
+
+
+#pragma mark - Calculation
+
+- (NSDictionary*)results
+{
+    @synchronized (self) {
+        if (_results != nil) return _results;
+    }
+
+    // Don't hold the lock while waiting for main thread, because main thread might be waiting for us
+    __block NSDictionary* snapshot;
+    if (NSThread.isMainThread) snapshot = [self snapshotWithClones:false];
+    else dispatch_sync(dispatch_get_main_queue(), ^{ snapshot = [self snapshotWithClones:true]; });
+
+    NSArray<OutlineScene*>* sceneObjects;
+    NSDictionary* results = [self calculateWithSnapshot:snapshot sceneObjects:&sceneObjects];
+
+    @synchronized (self) {
+        if (_results != nil) return _results;
+
+        // Document changed while we were calculating, so these results only make sense for this call
+        if (_version != [snapshot[@"version"] unsignedIntegerValue]) return results;
+
+        _results = results;
+        _sceneObjects = sceneObjects;
+        _sceneEighths = nil;
+        return _results;
+    }
+}
+
+/// Captures lines, outline and their revision and tag attributes. Has to be called on main thread. When the results are calculated in background, the lines are cloned here, because live lines can change while we're reading them.
+- (NSDictionary*)snapshotWithClones:(bool)clone
+{
+    ContinuousFountainParser* parser = self.delegate.parser;
+    NSArray<Line*>* lines = parser.safeLines;
+
+    // Read attributes from live lines, because clones are indexed the same way
+    NSDictionary* attributes = [self attributesForLines:lines];
+
+    if (clone) parser = [self snapshotOf:parser];
+
+    NSUInteger version;
+    @synchronized (self) { version = _version; }
+
+    return @{
+        @"version": @(version),
+        @"lines": parser.safeLines,
+        @"outline": parser.safeOutline,
+        @"revisions": attributes[@"revisions"],
+        @"tags": attributes[@"tags"]
+    };
+}
+
+/// Reads revision and tag attributes from the editor without baking them into lines.
+/// Returns `{ revisions: { line index: { generation: characters } }, tags: { line index: [tag] } }`
+- (NSDictionary*)attributesForLines:(NSArray<Line*>*)lines
+{
+    NSAttributedString* string = self.delegate.attributedString;
+    NSMutableDictionary<NSNumber*, NSMutableDictionary*>* revisions = NSMutableDictionary.new;
+    NSMutableDictionary<NSNumber*, NSMutableArray*>* tags = NSMutableDictionary.new;
+
+    for (NSInteger i = 0; i < lines.count; i++) {
+        NSRange range = lines[i].textRange;
+        if (range.length == 0 || range.location >= string.length) continue;
+        range = NSIntersectionRange(range, NSMakeRange(0, string.length));
+
+        NSNumber* index = @(i);
+
+        [string enumerateAttribute:BeatRevisions.attributeKey inRange:range options:0 usingBlock:^(id  _Nullable value, NSRange attrRange, BOOL * _Nonnull stop) {
+            BeatRevisionItem* revision = value;
+            if (revision == nil || revision.type != RevisionAddition || attrRange.length == 0) return;
+
+            NSMutableDictionary* generations = revisions[index];
+            if (generations == nil) {
+                generations = NSMutableDictionary.new;
+                revisions[index] = generations;
+            }
+
+            NSNumber* level = @(revision.generationLevel);
+            generations[level] = @([generations[level] integerValue] + attrRange.length);
+        }];
+
+        [string enumerateAttribute:BeatTagging.attributeKey inRange:range options:0 usingBlock:^(id  _Nullable value, NSRange attrRange, BOOL * _Nonnull stop) {
+            BeatTag* tag = value;
+            if (tag == nil || attrRange.length == 0) return;
+
+            NSMutableArray* lineTags = tags[index];
+            if (lineTags == nil) {
+                lineTags = NSMutableArray.new;
+                tags[index] = lineTags;
+            }
+            [lineTags addObject:tag];
+        }];
+    }
+
+    return @{ @"revisions": revisions, @"tags": tags };
+}
+
+- (NSDictionary*)calculateWithSnapshot:(NSDictionary*)snapshot sceneObjects:(NSArray<OutlineScene*>**)sceneObjectsOut
+{
+    NSArray<Line*>* lines = snapshot[@"lines"];
+    NSArray<OutlineScene*>* outline = snapshot[@"outline"];
+    NSDictionary<NSNumber*, NSDictionary*>* lineRevisions = snapshot[@"revisions"];
+    NSDictionary<NSNumber*, NSArray*>* lineTags = snapshot[@"tags"];
+
+    // Map heading lines to their outline items
+    NSMapTable<Line*, OutlineScene*>* outlineItems = NSMapTable.strongToStrongObjectsMapTable;
+    for (OutlineScene* scene in outline) {
+        if (scene.type == heading && scene.line != nil) [outlineItems setObject:scene forKey:scene.line];
+    }
+
+    NSInteger totalWords = 0, totalGlyphs = 0, totalLines = 0;
+
+    NSMutableArray<OutlineScene*>* sceneObjects = NSMutableArray.new;
+    NSMutableArray<NSMutableDictionary*>* scenes = NSMutableArray.new;
+    NSMutableDictionary<NSString*, NSMutableDictionary*>* characters = NSMutableDictionary.new;
+    NSMutableDictionary<NSString*, NSMutableSet*>* characterScenes = NSMutableDictionary.new;
+    NSMutableDictionary<NSString*, NSMutableDictionary*>* tags = NSMutableDictionary.new;
+    NSMutableDictionary<NSString*, NSMutableDictionary*>* revisions = NSMutableDictionary.new;
+
+    NSMutableDictionary* scene;
+    NSMutableArray* sceneCharacters;
+    NSString* speaker;
+
+    for (NSInteger i = 0; i < lines.count; i++) {
+        Line* line = lines[i];
+
+        if (line.type == heading) {
+            OutlineScene* outlineItem = [outlineItems objectForKey:line];
+            scene = [self recordForHeading:line outlineItem:outlineItem index:scenes.count];
+            sceneCharacters = scene[@"characters"];
+            [scenes addObject:scene];
+            [sceneObjects addObject:outlineItem ?: (OutlineScene*)NSNull.null];
+            speaker = nil;
+        }
+
+        // Revisions and tags are counted for invisible lines, too
+        NSDictionary<NSNumber*, NSNumber*>* generations = lineRevisions[@(i)];
+        for (NSNumber* generation in generations) {
+            NSMutableDictionary* revision = revisions[generation.stringValue];
+            if (revision == nil) {
+                revision = [NSMutableDictionary dictionaryWithDictionary:@{ @"lines": @0, @"characters": @0 }];
+                revisions[generation.stringValue] = revision;
+            }
+            revision[@"lines"] = @([revision[@"lines"] integerValue] + 1);
+            revision[@"characters"] = @([revision[@"characters"] integerValue] + generations[generation].integerValue);
+        }
+
+        for (BeatTag* tag in lineTags[@(i)]) {
+            NSString* category = tag.typeAsString;
+            NSString* name = tag.definition.name;
+            if (category.length == 0 || name.length == 0) continue;
+
+            NSMutableDictionary* group = tags[category];
+            if (group == nil) {
+                group = NSMutableDictionary.new;
+                tags[category] = group;
+            }
+
+            NSMutableDictionary* record = group[name];
+            if (record == nil) {
+                record = [NSMutableDictionary dictionaryWithDictionary:@{ @"count": @0, @"scenes": NSMutableIndexSet.new }];
+                group[name] = record;
+            }
+            record[@"count"] = @([record[@"count"] integerValue] + 1);
+            if (scene != nil) [record[@"scenes"] addIndex:[scene[@"index"] integerValue]];
+        }
+
+        if (line.isInvisible || line.type == empty) continue;
+
+        NSString* string = line.stripFormatting;
+        NSInteger words = BeatQueryWordCount(string);
+        if (words == 0 && line.type != pageBreak) continue;
+
+        totalLines += 1;
+        totalWords += words;
+        totalGlyphs += string.length;
+
+        if (scene != nil) {
+            scene[@"lines"] = @([scene[@"lines"] integerValue] + 1);
+            scene[@"words"] = @([scene[@"words"] integerValue] + words);
+        }
+
+        // Dialogue
+        if (line.isAnyCharacter) {
+            speaker = line.characterName;
+            if (speaker.length == 0) {
+                speaker = nil;
+                continue;
+            }
+
+            NSMutableDictionary* character = characters[speaker];
+            if (character == nil) {
+                character = [NSMutableDictionary dictionaryWithDictionary:@{ @"cues": @0, @"words": @0, @"scenes": @0 }];
+                characters[speaker] = character;
+                characterScenes[speaker] = NSMutableSet.new;
+            }
+            character[@"cues"] = @([character[@"cues"] integerValue] + 1);
+
+            if (scene != nil) {
+                NSMutableSet* appearances = characterScenes[speaker];
+                if (![appearances containsObject:scene[@"index"]]) {
+                    [appearances addObject:scene[@"index"]];
+                    [sceneCharacters addObject:speaker];
+                }
+            }
+        }
+        else if (line.isAnyDialogue && speaker != nil) {
+            NSMutableDictionary* character = characters[speaker];
+            character[@"words"] = @([character[@"words"] integerValue] + words);
+        }
+        else if (!line.isDialogueElement && !line.isDualDialogueElement) {
+            speaker = nil;
+        }
+    }
+
+    // Finalize groupings
+    for (NSString* name in characters) {
+        characters[name][@"scenes"] = @(characterScenes[name].count);
+    }
+
+    for (NSString* category in tags) {
+        for (NSString* name in tags[category]) {
+            NSMutableDictionary* record = tags[category][name];
+            record[@"scenes"] = @([record[@"scenes"] count]);
+        }
+    }
+
+    NSMutableDictionary<NSString*, NSNumber*>* intExt = [NSMutableDictionary dictionaryWithDictionary:@{ @"interior": @0, @"exterior": @0, @"both": @0, @"other": @0 }];
+    NSMutableDictionary<NSString*, NSNumber*>* times = NSMutableDictionary.new;
+    NSMutableDictionary<NSString*, NSMutableDictionary*>* locations = NSMutableDictionary.new;
+    NSInteger sceneCount = 0;
+
+    for (NSDictionary* record in scenes) {
+        if ([record[@"omitted"] boolValue]) continue;
+        sceneCount += 1;
+
+        NSString* prefix = record[@"intExt"];
+        intExt[prefix] = @(intExt[prefix].integerValue + 1);
+
+        NSString* time = record[@"time"];
+        if (time.length > 0) times[time] = @(times[time].integerValue + 1);
+
+        NSString* location = record[@"location"];
+        if (location.length > 0) {
+            NSMutableDictionary* item = locations[location];
+            if (item == nil) {
+                item = [NSMutableDictionary dictionaryWithDictionary:@{ @"scenes": @0 }];
+                locations[location] = item;
+            }
+            item[@"scenes"] = @([item[@"scenes"] integerValue] + 1);
+        }
+    }
+
+    *sceneObjectsOut = sceneObjects;
+    return @{
+        @"totals": @{ @"words": @(totalWords), @"glyphs": @(totalGlyphs), @"lines": @(totalLines), @"scenes": @(sceneCount) },
+        @"characters": characters,
+        @"scenes": scenes,
+        @"locations": locations,
+        @"intExt": intExt,
+        @"timesOfDay": times,
+        @"tags": tags,
+        @"revisions": revisions
+    };
+}
+
+/// Returns a parser with cloned lines and an outline built from them. Has to be called on main thread. Pagination looks scenes up by UUID, so eighths work with cloned scenes, too.
+- (ContinuousFountainParser*)snapshotOf:(ContinuousFountainParser*)parser
+{
+    NSArray<Line*>* lines = parser.safeLines;
+    NSMutableArray<Line*>* clones = [NSMutableArray arrayWithCapacity:lines.count];
+    for (Line* line in lines) [clones addObject:line.clone];
+
+    ContinuousFountainParser* snapshot = ContinuousFountainParser.new;
+    snapshot.lines = clones;
+    [snapshot updateOutline];
+
+    return snapshot;
+}
+
+/// Creates a scene record and parses location, time of day and INT/EXT prefix from the heading
+- (NSMutableDictionary*)recordForHeading:(Line*)line outlineItem:(OutlineScene*)outlineItem index:(NSInteger)index
+{
+    NSString* heading = (outlineItem != nil) ? outlineItem.string : line.stripFormatting;
+    heading = [heading stringByTrimmingCharactersInSet:NSCharacterSet.whitespaceCharacterSet].uppercaseString;
+
+    NSString* rest = heading;
+    NSString* prefix = @"other";
+
+    if (line.forced) {
+        // Forced headings don't have a prefix
+        if ([rest hasPrefix:@"."]) rest = [rest substringFromIndex:1];
+    } else {
+        NSRange space = [heading rangeOfCharacterFromSet:NSCharacterSet.whitespaceCharacterSet];
+        NSString* firstWord = (space.location != NSNotFound) ? [heading substringToIndex:space.location] : heading;
+        firstWord = [firstWord stringByReplacingOccurrencesOfString:@"." withString:@""];
+
+        if ([firstWord isEqualToString:@"INT"] || [firstWord isEqualToString:@"I"]) prefix = @"interior";
+        else if ([firstWord isEqualToString:@"EXT"] || [firstWord isEqualToString:@"E"] || [firstWord isEqualToString:@"EST"]) prefix = @"exterior";
+        else if ([firstWord containsString:@"/"]) prefix = @"both";
+
+        if (![prefix isEqualToString:@"other"]) {
+            rest = (space.location != NSNotFound) ? [heading substringFromIndex:NSMaxRange(space)] : @"";
+        }
+    }
+
+    // Time of day is whatever follows the last dash
+    NSString* location = rest;
+    NSString* time = @"";
+    NSRange dash = [rest rangeOfString:@"- " options:NSBackwardsSearch];
+    if (dash.location != NSNotFound) {
+        location = [rest substringToIndex:dash.location];
+        time = [rest substringFromIndex:NSMaxRange(dash)];
+    }
+
+    NSCharacterSet* trimmed = NSCharacterSet.whitespaceCharacterSet;
+
+    return [NSMutableDictionary dictionaryWithDictionary:@{
+        @"index": @(index),
+        @"uuid": line.uuidString ?: @"",
+        @"heading": heading,
+        @"sceneNumber": line.sceneNumber ?: @"",
+        @"location": [location stringByTrimmingCharactersInSet:trimmed],
+        @"intExt": prefix,
+        @"time": [time stringByTrimmingCharactersInSet:trimmed],
+        @"lines": @0,
+        @"words": @0,
+        @"characters": NSMutableArray.new,
+        @"omitted": @(outlineItem.omitted)
+    }];
+}
+
+@end
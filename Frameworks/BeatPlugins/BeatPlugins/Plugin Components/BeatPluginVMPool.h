@@ -0,0 +1,23 @@
+//
+//  BeatPluginVMPool.h
+//  BeatPlugins
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+#import <Foundation/Foundation.h>
+#import <JavaScriptCore/JavaScriptCore.h>
+
+NS_ASSUME_NONNULL_BEGIN
+
+@interface BeatPluginVMPool : NSObject
++ (BeatPluginVMPool*)shared;
+/// Returns a fresh, empty JavaScript context in a virtual machine which is not used by any other running plugin. Contexts are created ahead of time when possible, so starting a plugin doesn't have to wait for it.
+- (JSContext*)dequeueContext;
+/// Returns the virtual machine of a context to the pool. Only call this after the plugin has ended and won't run any more code.
+- (void)returnContext:(JSContext*)context;
+/// Returns the contents of a script file. Sources are cached by path and modification date.
+- (NSString* _Nullable)sourceAtPath:(NSString*)path error:(NSError* _Nullable * _Nullable)error;
+@end
+
+NS_ASSUME_NONNULL_END
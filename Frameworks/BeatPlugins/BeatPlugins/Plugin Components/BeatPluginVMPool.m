@@ -0,0 +1,175 @@
+//
+//  BeatPluginVMPool.m
+//  BeatPlugins
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+/**
+ 
+ Pre-warmed virtual machines and contexts for plugins.
+ 
+ Creating a `JSVirtualMachine` and its first context is the most expensive part of starting a plugin. The pool keeps an idle VM with
+ an empty context ready, and when it's taken, a new one is prepared in the background.
+ 
+ A VM runs one thread at a time, so a resident plugin doing heavy work with `Beat.dispatch` would stall any other plugin sharing its VM,
+ even the main thread listeners. Because of this, each plugin gets exclusive use of its VM for as long as it's running. VMs are only reused
+ after a plugin has ended and returned its context. Contexts in a reused VM share the JSC code cache, so a module which has been evaluated
+ once (say, `Template.js`) won't have to be compiled again. Module sources are cached by path and modification date, so editing a module
+ during development is picked up immediately.
+ 
+ */
+
+#import "BeatPluginVMPool.h"
+
+/// Maximum number of idle virtual machines kept in the pool
+#define BEAT_PLUGIN_IDLE_VM_COUNT 2
+
+@interface BeatPluginSource : NSObject
+@property (nonatomic) NSDate* modificationDate;
+@property (nonatomic) NSString* source;
+@end
+
+@implementation BeatPluginSource
+@end
+
+@interface BeatPluginVMPool ()
+/// Virtual machines which are not used by any running plugin
+@property (nonatomic) NSMutableArray<JSVirtualMachine*>* idleMachines;
+/// Pre-warmed contexts for idle VMs. A missing context means that it's still being prepared.
+@property (nonatomic) NSMapTable<JSVirtualMachine*, JSContext*>* readyContexts;
+@property (nonatomic) NSMutableDictionary<NSString*, BeatPluginSource*>* sources;
+@property (nonatomic) dispatch_queue_t warmupQueue;
+@end
+
+@implementation BeatPluginVMPool
+
++ (BeatPluginVMPool*)shared
+{
+    static BeatPluginVMPool* pool;
+    static dispatch_once_t onceToken;
+    dispatch_once(&onceToken, ^{
+        pool = BeatPluginVMPool.new;
+    });
+    return pool;
+}
+
+- (instancetype)init
+{
+    self = [super init];
+    if (self) {
+        _idleMachines = NSMutableArray.new;
+        _readyContexts = NSMapTable.strongToStrongObjectsMapTable;
+        _sources = NSMutableDictionary.new;
+        _warmupQueue = dispatch_queue_create("com.beat.plugins.warmup", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+        
+        [self prepareIdleMachine];
+    }
+    return self;
+}
+
+
+#pragma mark - Contexts
+
+- (JSContext*)dequeueContext
+{
+    JSVirtualMachine* vm;
+    JSContext* context;
+    
+    @synchronized (self) {
+        vm = _idleMachines.lastObject;
+        if (vm != nil) {
+            [_idleMachines removeLastObject];
+            context = [_readyContexts objectForKey:vm];
+            [_readyContexts removeObjectForKey:vm];
+        }
+    }
+    
+    // Nothing was ready yet, so we'll have to create the context right here
+    if (vm == nil) vm = JSVirtualMachine.new;
+    if (context == nil) context = [JSContext.alloc initWithVirtualMachine:vm];
+    
+    [self prepareIdleMachine];
+    return context;
+}
+
+- (void)returnContext:(JSContext*)context
+{
+    JSVirtualMachine* vm = context.virtualMachine;
+    if (vm == nil) return;
+    
+    @synchronized (self) {
+        if ([_idleMachines containsObject:vm] || _idleMachines.count >= BEAT_PLUGIN_IDLE_VM_COUNT) return;
+        [_idleMachines insertObject:vm atIndex:0];
+    }
+    
+    [self prepareContextForMachine:vm];
+}
+
+/// Makes sure there's at least one idle VM ready for the next plugin
+- (void)prepareIdleMachine
+{
+    dispatch_async(_warmupQueue, ^{
+        @synchronized (self) {
+            if (self.idleMachines.count > 0) return;
+        }
+        
+        JSVirtualMachine* vm = JSVirtualMachine.new;
+        JSContext* context = [JSContext.alloc initWithVirtualMachine:vm];
+        
+        @synchronized (self) {
+            if (self.idleMachines.count > 0) return;
+            [self.idleMachines addObject:vm];
+            [self.readyContexts setObject:context forKey:vm];
+        }
+    });
+}
+
+/// Prepares an empty context for an idle VM
+- (void)prepareContextForMachine:(JSVirtualMachine*)vm
+{
+    dispatch_async(_warmupQueue, ^{
+        @synchronized (self) {
+            if (![self.idleMachines containsObject:vm] || [self.readyContexts objectForKey:vm] != nil) return;
+        }
+        
+        JSContext* context = [JSContext.alloc initWithVirtualMachine:vm];
+        
+        @synchronized (self) {
+            if ([self.idleMachines containsObject:vm] && [self.readyContexts objectForKey:vm] == nil) [self.readyContexts setObject:context forKey:vm];
+        }
+    });
+}
+
+
+#pragma mark - Sources
+
+- (NSString*)sourceAtPath:(NSString*)path error:(NSError**)error
+{
+    if (path.length == 0) return nil;
+    
+    NSDictionary* attributes = [NSFileManager.defaultManager attributesOfItemAtPath:path error:error];
+    if (attributes == nil) return nil;
+    
+    NSDate* modificationDate = attributes.fileModificationDate;
+    
+    @synchronized (_sources) {
+        BeatPluginSource* cached = _sources[path];
+        if (cached != nil && [cached.modificationDate isEqualToDate:modificationDate]) return cached.source;
+    }
+    
+    NSString* source = [NSString stringWithContentsOfFile:path encoding:NSUTF8StringEncoding error:error];
+    if (source == nil) return nil;
+    
+    BeatPluginSource* item = BeatPluginSource.new;
+    item.modificationDate = modificationDate;
+    item.source = source;
+    
+    @synchronized (_sources) {
+        _sources[path] = item;
+    }
+    
+    return source;
+}
+
+@end
@@ -0,0 +1,28 @@
+//
+//  BeatPluginWorker.h
+//  BeatPlugins
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+#import <Foundation/Foundation.h>
+#import <JavaScriptCore/JavaScriptCore.h>
+
+@class BeatPlugin;
+
+NS_ASSUME_NONNULL_BEGIN
+
+@protocol BeatPluginWorkerExports <JSExport>
+/// Number of messages waiting to be processed
+@property (nonatomic, readonly) NSInteger pending;
+/// Sends a message to the worker along with a snapshot of the current document
+- (void)post:(JSValue* _Nullable)message;
+/// Stops the worker. Any queued messages are dropped.
+- (void)terminate;
+@end
+
+@interface BeatPluginWorker : NSObject <BeatPluginWorkerExports>
+- (instancetype)initWithPlugin:(BeatPlugin*)plugin script:(NSString*)script callback:(JSValue* _Nullable)callback;
+@end
+
+NS_ASSUME_NONNULL_END
@@ -0,0 +1,226 @@
+//
+//  BeatPluginWorker.m
+//  BeatPlugins
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+
+/**
+
+ Background workers for plugins (`Beat.worker()`).
+
+ `Beat.dispatch()` runs callbacks in the plugin's own context, which means that background code reads the same
+ `Line` objects the editor is mutating on main thread. A worker instead has its own virtual machine and context, and only
+ communicates with the plugin through messages. Each message comes with a read-only document snapshot made of cloned lines,
+ so the worker never touches live parser data, and the editor never has to wait for the analysis to finish.
+
+ ```
+ const worker = Beat.worker(function (message, doc) {
+    let words = 0
+    for (let i = 0; i < doc.count; i++) {
+        if (doc.types[i] == types.dialogue) words += doc.string(i).split(" ").length
+    }
+    return words
+ }, (words) => {
+    Beat.log("Dialogue words: " + words)
+ })
+
+ worker.post()
+ ```
+
+ The worker can either be a function, which receives `(message, doc)` and whose return value is posted back, or a script which
+ defines a global `onmessage` function and calls `postMessage(value)`. Messages are passed as JSON in both directions, so only
+ plain data survives the trip. Worker context has `postMessage`, `log` and `types` (line types) available.
+
+ */
+
+#import "BeatPluginWorker.h"
+#import <BeatPlugins/BeatPlugin.h>
+#import "BeatPlugin+Parser.h"
+#import "BeatPlugin+Logging.h"
+#import "BeatPluginDocumentSnapshot.h"
+#import "BeatPluginProfiler.h"
+
+@interface BeatPluginWorker ()
+@property (nonatomic, weak) BeatPlugin* plugin;
+@property (nonatomic) NSString* pluginName;
+/// Profiler of the owning plugin, so worker calls are measured against its budget
+@property (nonatomic) BeatPluginProfiler* profiler;
+@property (nonatomic) JSValue* callback;
+@property (nonatomic) NSInteger pending;
+@property (atomic) bool terminated;
+
+/// Worker queue. The virtual machine and context are only accessed on this queue.
+@property (nonatomic) dispatch_queue_t queue;
+@property (nonatomic) JSVirtualMachine* vm;
+@property (nonatomic) JSContext* context;
+@end
+
+@implementation BeatPluginWorker
+
+- (instancetype)initWithPlugin:(BeatPlugin*)plugin script:(NSString*)script callback:(JSValue*)callback
+{
+    self = [super init];
+    if (self) {
+        _plugin = plugin;
+        _pluginName = (plugin.pluginName != nil) ? plugin.pluginName : @"";
+        _profiler = plugin.profiler;
+        _callback = callback;
+        _queue = dispatch_queue_create("beat.plugin.worker", dispatch_queue_attr_make_with_qos_class(DISPATCH_QUEUE_SERIAL, QOS_CLASS_UTILITY, 0));
+
+        NSDictionary* types = (plugin.type != nil) ? plugin.type.copy : @{};
+
+        __weak typeof(self) weakSelf = self;
+        dispatch_async(_queue, ^{
+            [weakSelf setupContextWithScript:script types:types];
+        });
+    }
+    return self;
+}
+
+/// Creates the worker context. Called on worker queue.
+- (void)setupContextWithScript:(NSString*)script types:(NSDictionary*)types
+{
+    if (self.terminated) return;
+
+    _vm = JSVirtualMachine.new;
+    _context = [JSContext.alloc initWithVirtualMachine:_vm];
+    _context.name = [NSString stringWithFormat:@"%@ (worker)", _pluginName];
+
+    __weak typeof(self) weakSelf = self;
+
+    [_context setExceptionHandler:^(JSContext *context, JSValue *exception) {
+        NSString* error = exception.toString;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [weakSelf.plugin reportError:@"Worker error" withText:error];
+        });
+    }];
+
+    _context[@"postMessage"] = ^(JSValue* value) {
+        [weakSelf deliver:[BeatPluginWorker serialize:value]];
+    };
+
+    _context[@"log"] = ^(NSString* string) {
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [weakSelf.plugin log:string];
+        });
+    };
+
+    _context[@"types"] = types;
+
+    [_context evaluateScript:script];
+}
+
+
+#pragma mark - Messaging
+
+/// Sends a message to the worker. Call this on main thread.
+- (void)post:(JSValue*)message
+{
+    if (self.terminated) return;
+
+    NSString* json = [BeatPluginWorker serialize:message];
+    ContinuousFountainParser* parser = [self documentSnapshot];
+    if (parser == nil) return;
+
+    self.pending += 1;
+
+    __weak typeof(self) weakSelf = self;
+    dispatch_async(_queue, ^{
+        [weakSelf process:json parser:parser];
+
+        dispatch_async(dispatch_get_main_queue(), ^{
+            weakSelf.pending -= 1;
+        });
+    });
+}
+
+/// Runs the message handler. Called on worker queue.
+- (void)process:(NSString*)json parser:(ContinuousFountainParser*)parser
+{
+    if (self.terminated || _context == nil) return;
+
+    JSValue* onMessage = _context[@"onmessage"];
+    if (onMessage.isUndefined || onMessage.isNull) {
+        __weak typeof(self) weakSelf = self;
+        dispatch_async(dispatch_get_main_queue(), ^{
+            [weakSelf.plugin reportError:@"Worker error" withText:@"Worker has no onmessage function"];
+        });
+        return;
+    }
+
+    // The outline is built here, so the main thread only has to clone lines
+    if (parser.outline == nil) [parser updateOutline];
+
+    JSValue* message = (json != nil) ? [_context[@"JSON"] invokeMethod:@"parse" withArguments:@[json]] : [JSValue valueWithUndefinedInContext:_context];
+    BeatPluginDocumentSnapshot* snapshot = [BeatPluginDocumentSnapshot.alloc initWithParser:parser detached:true];
+
+    uint64_t start = BeatPluginProfiler.now;
+    JSValue* result = [onMessage callWithArguments:@[message, snapshot]];
+    [_profiler record:@"worker" start:start];
+
+    if (result != nil && !result.isUndefined) [self deliver:[BeatPluginWorker serialize:result]];
+}
+
+/// Passes a result to the plugin callback on main thread
+- (void)deliver:(NSString*)json
+{
+    dispatch_async(dispatch_get_main_queue(), ^{
+        JSValue* callback = self.callback;
+        BeatPlugin* plugin = self.plugin;
+        if (self.terminated || callback == nil || plugin == nil || callback.context == nil) return;
+
+        JSContext* context = callback.context;
+        JSValue* result = (json != nil) ? [context[@"JSON"] invokeMethod:@"parse" withArguments:@[json]] : [JSValue valueWithUndefinedInContext:context];
+
+        [plugin runCallback:callback withArguments:@[result] label:@"worker"];
+    });
+}
+
+/// Messages are passed as JSON, so no live objects can leak between contexts
++ (NSString*)serialize:(JSValue*)value
+{
+    if (value == nil || value.isUndefined) return nil;
+
+    JSValue* json = [value.context[@"JSON"] invokeMethod:@"stringify" withArguments:@[value]];
+    return (json.isString) ? json.toString : nil;
+}
+
+
+#pragma mark - Document snapshot
+
+/// Returns a parser with cloned lines. Each message gets its own clones, so changes a worker makes to the lines don't leak into the next message.
+- (ContinuousFountainParser*)documentSnapshot
+{
+    id<BeatPluginDelegate> delegate = self.plugin.delegate;
+    if (delegate == nil) return nil;
+
+    NSArray<Line*>* lines = delegate.parser.safeLines;
+    NSMutableArray<Line*>* clones = [NSMutableArray arrayWithCapacity:lines.count];
+    for (Line* line in lines) [clones addObject:line.clone];
+
+    ContinuousFountainParser* parser = ContinuousFountainParser.new;
+    parser.lines = clones;
+
+    return parser;
+}
+
+
+#pragma mark - Termination
+
+- (void)terminate
+{
+    if (self.terminated) return;
+
+    self.terminated = true;
+    self.callback = nil;
+
+    dispatch_async(_queue, ^{
+        self.context = nil;
+        self.vm = nil;
+    });
+
+    [self.plugin.workers removeObject:self];
+}
+
+@end
@@ -13,6 +13,8 @@
 @protocol BeatPluginListenerExports <JSExport>
 
 - (void)onTextChange:(JSValue* _Nullable)updateMethod;
+/// Batched change listener. Callback receives a delta object at most once per run loop turn, or after given amount of milliseconds has passed since last change.
+JSExportAs(onDocumentChange, - (void)onDocumentChange:(JSValue* _Nullable)updateMethod debounce:(NSInteger)ms);
 
 - (void)setSelectionUpdate:(JSValue* _Nullable)updateMethod;
 - (void)onSelectionChange:(JSValue* _Nullable)updateMethod;
@@ -46,6 +48,7 @@
 - (void)escapePressed;
 
 - (void)updateText:(NSRange)range;
+- (void)lineWasRemoved:(Line*)line;
 - (void)updateSelection:(NSRange)selection;
 - (void)updateOutline:(OutlineChanges* _Nullable)changes;
 - (void)updateSceneIndex:(NSInteger)sceneIndex;
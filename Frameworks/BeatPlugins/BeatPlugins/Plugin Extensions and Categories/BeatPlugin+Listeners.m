@@ -8,6 +8,8 @@
 #import "BeatPlugin+Listeners.h"
 #import <BeatPlugins/BeatPlugins-Swift.h>
 #import "BeatPlugin+Menus.h"
+#import "BeatPluginChangeBatch.h"
+#import "BeatPluginProfiler.h"
 
 @interface BeatPlugin () <BeatTextChangeObserver>
 @end
@@ -34,8 +36,52 @@
     [self makeResident];
 }
 - (void)updateText:(NSRange)range {
+    if (self.changeBatch != nil) {
+        [self.changeBatch addEditInRange:range];
+        if (!self.onTextChangeDisabled) [self scheduleDocumentChange];
+    }
+    
     if (self.updateTextMethod == nil || self.updateTextMethod.isNull) return;
-    if (!self.onTextChangeDisabled) [self.updateTextMethod callWithArguments:@[@(range.location), @(range.length)]];
+    if (!self.onTextChangeDisabled) [self callListener:self.updateTextMethod name:@"onTextChange" arguments:@[@(range.location), @(range.length)]];
+}
+
+- (void)lineWasRemoved:(Line*)line
+{
+    [self.changeBatch removeLine:line];
+}
+
+/** Creates a batched listener for document changes. Instead of being called on every edit, the callback receives a single delta object which contains the UUIDs of changed, inserted and removed lines, outline changes and a document version number.
+ - note: Set `debounce` to 0 to receive changes once per run loop turn. Otherwise the changes are delivered after no edits have been made for given amount of milliseconds.
+ */
+- (void)onDocumentChange:(JSValue*)updateMethod debounce:(NSInteger)ms
+{
+    self.documentChangeMethod = updateMethod;
+    self.documentChangeDebounce = MAX(ms, 0);
+    self.changeBatch = (updateMethod != nil && !updateMethod.isNull && !updateMethod.isUndefined) ? [BeatPluginChangeBatch.alloc initWithParser:self.delegate.parser] : nil;
+    
+    [self makeResident];
+}
+
+- (void)scheduleDocumentChange
+{
+    NSInteger token = ++self.documentChangeToken;
+    
+    // Without debounce, the token check just makes sure the batch is delivered only once per run loop turn
+    dispatch_time_t time = dispatch_time(DISPATCH_TIME_NOW, (int64_t)self.documentChangeDebounce * NSEC_PER_MSEC);
+    
+    __weak typeof(self) weakSelf = self;
+    dispatch_after(time, dispatch_get_main_queue(), ^{
+        if (weakSelf.documentChangeToken != token) return;
+        [weakSelf deliverDocumentChange];
+    });
+}
+
+- (void)deliverDocumentChange
+{
+    if (self.changeBatch == nil || self.documentChangeMethod == nil) return;
+    
+    NSDictionary* delta = self.changeBatch.flush;
+    [self callListener:self.documentChangeMethod name:@"onDocumentChange" arguments:@[delta]];
 }
 
 /// Creates a listener for changing selection in editor.
@@ -53,7 +99,7 @@
 - (void)updateSelection:(NSRange)selection
 {
     if (!self.updateSelectionMethod || [self.updateSelectionMethod isNull]) return;
-    if (!self.onSelectionChangeDisabled) [self.updateSelectionMethod callWithArguments:@[@(selection.location), @(selection.length)]];
+    if (!self.onSelectionChangeDisabled) [self callListener:self.updateSelectionMethod name:@"onSelectionChange" arguments:@[@(selection.location), @(selection.length)]];
 }
 
 /// Creates a listener for changes in outline.
@@ -70,8 +116,13 @@
 }
 - (void)updateOutline:(OutlineChanges*)changes
 {
+    if (self.changeBatch != nil) {
+        [self.changeBatch addOutlineChanges:changes];
+        if (!self.onOutlineChangeDisabled) [self scheduleDocumentChange];
+    }
+    
     if (!self.updateOutlineMethod || [self.updateOutlineMethod isNull]) return;
-    if (!self.onOutlineChangeDisabled) [self.updateOutlineMethod callWithArguments:@[changes]];
+    if (!self.onOutlineChangeDisabled) [self callListener:self.updateOutlineMethod name:@"onOutlineChange" arguments:@[changes]];
 }
 
 /// Creates a listener for selecting a new scene.
@@ -87,7 +138,7 @@
 }
 - (void)updateSceneIndex:(NSInteger)sceneIndex
 {
-    if (!self.onSceneIndexUpdateDisabled) [self.updateSceneMethod callWithArguments:@[@(sceneIndex)]];
+    if (!self.onSceneIndexUpdateDisabled) [self callListener:self.updateSceneMethod name:@"onSceneIndexUpdate" arguments:@[@(sceneIndex)]];
 }
 
 /// Creates a listener for escape key
@@ -124,7 +175,7 @@
 
 - (void)observedTextDidChange:(id<BeatTextChangeObservable>)object
 {
-    [self.observedTextViews[[NSValue valueWithNonretainedObject:object]] callWithArguments:nil];
+    [self callListener:self.observedTextViews[[NSValue valueWithNonretainedObject:object]] name:@"onNotepadChange" arguments:nil];
 }
 
 - (void)clearObservables
@@ -177,7 +228,7 @@
         [indices addObject:@(idx)];
     }];
     
-    [self.updatePreviewMethod callWithArguments:@[indices, pagination]];
+    [self callListener:self.updatePreviewMethod name:@"onPreviewFinished" arguments:@[indices, pagination]];
 }
 
 /// Creates a listener for when document was saved.
@@ -192,6 +243,40 @@
 }
 
 
+#pragma mark - Profiling
+
+/// Calls a listener and records its execution time. If the listener is being throttled for going over budget, only the latest event is delivered once the throttle interval has passed.
+- (void)callListener:(JSValue*)method name:(NSString*)name arguments:(NSArray*)arguments
+{
+    if (method == nil || method.isNull || method.isUndefined) return;
+    
+    BeatPluginProfiler* profiler = self.profiler;
+    NSTimeInterval throttle = [profiler throttleIntervalFor:name];
+    
+    if (throttle > 0.0) {
+        if (self.throttledListenerCalls == nil) self.throttledListenerCalls = NSMutableDictionary.new;
+        bool scheduled = (self.throttledListenerCalls[name] != nil);
+        self.throttledListenerCalls[name] = (arguments != nil) ? arguments : @[];
+        
+        if (!scheduled) {
+            __weak typeof(self) weakSelf = self;
+            dispatch_after(dispatch_time(DISPATCH_TIME_NOW, (int64_t)(throttle * NSEC_PER_SEC)), dispatch_get_main_queue(), ^{
+                NSArray* latestArguments = weakSelf.throttledListenerCalls[name];
+                if (latestArguments == nil) return;
+                
+                [weakSelf.throttledListenerCalls removeObjectForKey:name];
+                [weakSelf callListener:method name:name arguments:latestArguments];
+            });
+        }
+        return;
+    }
+    
+    uint64_t start = BeatPluginProfiler.now;
+    [method callWithArguments:arguments];
+    [profiler record:name start:start];
+}
+
+
 #pragma mark - Resident plugin data providers
 
 /// Callback for when scene headings are being autocompleted. Can be used to inject data into autocompletion.
@@ -204,7 +289,9 @@
 {
     if (self.sceneCompletionCallback == nil) return @[];
     
+    uint64_t start = BeatPluginProfiler.now;
     JSValue *value = [self.sceneCompletionCallback callWithArguments:nil];
+    [self.profiler record:@"onSceneHeadingAutocompletion" start:start];
     if (!value.isArray) return @[];
     else return value.toArray;
 }
@@ -217,7 +304,9 @@
 - (NSArray<NSString*>*)completionsForCharacters {
     if (self.characterCompletionCallback == nil) return @[];
     
+    uint64_t start = BeatPluginProfiler.now;
     JSValue *value = [self.characterCompletionCallback callWithArguments:nil];
+    [self.profiler record:@"onCharacterAutocompletion" start:start];
     if (!value.isArray) return @[];
     else return value.toArray;
 }
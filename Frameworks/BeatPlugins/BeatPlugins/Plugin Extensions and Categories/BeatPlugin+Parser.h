@@ -9,6 +9,8 @@
 #import <JavaScriptCore/JavaScriptCore.h>
 
 @class Line;
+@class BeatPluginDocumentSnapshot;
+@class BeatPluginQuery;
 
 @protocol BeatPluginParserExports <JSExport>
 
@@ -46,6 +48,10 @@ JSExportAs(line, - (Line*)lineWithString:(NSString*)string type:(LineType)type);
 - (NSString*)scenesAsJSON;
 /// Returns all lines as a JSON string
 - (NSString*)linesAsJSON;
+/// Returns a read-only snapshot of the document with typed array columns and lazily bridged lines and scenes. Use this instead of the JSON methods when scanning through the whole document.
+- (BeatPluginDocumentSnapshot*)snapshot;
+/// Returns cached counts and groupings (characters, scenes, locations, tags, revisions etc.) for the current document version
+- (BeatPluginQuery*)query;
 /// Returns the line at given position in document
 - (Line*)lineAtPosition:(NSInteger)index;
 /// Returns the scene at given position in document
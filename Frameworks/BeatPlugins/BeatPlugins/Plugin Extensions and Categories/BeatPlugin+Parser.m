@@ -6,6 +6,10 @@
 //
 
 #import "BeatPlugin+Parser.h"
+#import "BeatPluginDocumentSnapshot.h"
+#import "BeatPluginProfiler.h"
+#import "BeatPluginQuery.h"
+#import "BeatPluginAgent.h"
 
 @implementation BeatPlugin (Parser)
 
@@ -26,7 +30,11 @@
 }
 
 /// Returns parsed `Line` objects for current document.
-- (NSArray*)lines { return self.delegate.parser.lines; }
+- (NSArray*)lines
+{
+    [self.profiler countCall:@"lines"];
+    return self.delegate.parser.lines;
+}
 - (NSArray*)linesForScene:(id)sceneId { return [self.delegate.parser linesForScene:(OutlineScene*)sceneId]; }
 
 - (NSArray*)scenes { return self.delegate.parser.scenes; }
@@ -49,34 +57,19 @@
 
 - (NSString*)scenesAsJSON
 {
-    NSMutableArray *scenesToSerialize = NSMutableArray.new;
-    NSArray* scenes = self.delegate.parser.scenes.copy;
-    
-    for (OutlineScene* scene in scenes) {
-        [scenesToSerialize addObject:scene.forSerialization];
-    }
-    
-    return scenesToSerialize.json;
+    [self.profiler countCall:@"scenesAsJSON"];
+    return [OutlineScene jsonForScenes:self.delegate.parser.scenes.copy];
 }
 
 - (NSString*)outlineAsJSON
 {
-    NSArray<OutlineScene*>* outline = self.delegate.parser.outline.copy;
-    NSMutableArray *scenesToSerialize = [NSMutableArray arrayWithCapacity:outline.count];
-        
-    for (OutlineScene* scene in outline) {
-        [scenesToSerialize addObject:scene.forSerialization];
-    }
-    
-    NSError *error;
-    NSData *jsonData = [NSJSONSerialization dataWithJSONObject:scenesToSerialize options:0 error:&error];
-    NSString *json = [[NSString alloc] initWithData:jsonData encoding:NSUTF8StringEncoding];
-    
-    return json;
+    [self.profiler countCall:@"outlineAsJSON"];
+    return [OutlineScene jsonForScenes:self.delegate.parser.outline.copy];
 }
 
 /// Returns all lines as JSON
 - (NSString*)linesAsJSON {
+    [self.profiler countCall:@"linesAsJSON"];
     NSMutableArray *linesToSerialize = NSMutableArray.new;
     NSArray* lines = self.delegate.parser.safeLines.copy;
     
@@ -90,6 +83,21 @@
     return linesToSerialize.json;
 }
 
+/// Returns a snapshot of the document for fast scanning
+- (BeatPluginDocumentSnapshot*)snapshot
+{
+    [self.profiler countCall:@"snapshot"];
+    return [BeatPluginDocumentSnapshot.alloc initWithParser:self.delegate.parser];
+}
+
+/// Returns the shared query object for this document
+- (BeatPluginQuery*)query
+{
+    [self.profiler countCall:@"query"];
+    BeatPluginQuery* query = self.delegate.pluginAgent.query;
+    return (query != nil) ? query : [BeatPluginQuery.alloc initWithDelegate:self.delegate];
+}
+
 - (OutlineScene*)getCurrentScene
 {
     return self.delegate.currentScene;
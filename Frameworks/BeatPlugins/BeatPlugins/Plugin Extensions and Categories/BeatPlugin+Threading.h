@@ -8,6 +8,8 @@
 #import <BeatPlugins/BeatPlugins.h>
 #import <JavaScriptCore/JavaScriptCore.h>
 
+@class BeatPluginWorker;
+
 @protocol BeatPluginThreadingExports <JSExport>
 
 /// Dispatch a block into a background thread
@@ -20,6 +22,8 @@
 - (void)dispatch_sync:(JSValue* _Nullable)callback;
 /// Returns `true` if the current operation happens in main thread
 - (bool)isMainThread;
+/// Creates a background worker with its own context. The script is either a function `(message, doc) => result` or a string which defines `onmessage`. Results are passed to the callback in main thread.
+JSExportAs(worker, - (BeatPluginWorker* _Nullable)worker:(JSValue* _Nullable)script callback:(JSValue* _Nullable)callback);
 
 @end
 
@@ -42,6 +46,9 @@ NS_ASSUME_NONNULL_BEGIN
 /// Returns `true` if the current operation happens in main thread
 - (bool)isMainThread;
 
+/// Creates a background worker with its own context
+- (BeatPluginWorker* _Nullable)worker:(JSValue* _Nullable)script callback:(JSValue* _Nullable)callback;
+
 @end
 
 NS_ASSUME_NONNULL_END
@@ -6,6 +6,9 @@
 //
 
 #import "BeatPlugin+Threading.h"
+#import "BeatPluginProfiler.h"
+#import "BeatPluginWorker.h"
+#import "BeatPlugin+Logging.h"
 
 @implementation BeatPlugin (Threading)
 
@@ -48,18 +51,47 @@
     }
     
     dispatch_async(dispatch_get_global_queue(p, 0), ^(void) {
+        uint64_t start = BeatPluginProfiler.now;
         [callback callWithArguments:nil];
+        [self.profiler record:@"dispatch" start:start];
     });
 }
 /// Runs the given block in **main thread**
 - (void)dispatch_sync:(JSValue*)callback
 {
     dispatch_async(dispatch_get_main_queue(), ^(void){
+        uint64_t start = BeatPluginProfiler.now;
         [callback callWithArguments:nil];
+        [self.profiler record:@"dispatch_sync" start:start];
     });
 }
 
 - (bool)isMainThread { return NSThread.isMainThread; }
 
 
+#pragma mark - Workers
+
+/// Creates a worker with its own context, which receives document snapshots and passes results back by messages
+- (BeatPluginWorker*)worker:(JSValue*)script callback:(JSValue*)callback
+{
+    NSString* source;
+    
+    if ([script isInstanceOf:script.context[@"Function"]]) {
+        source = [NSString stringWithFormat:@"var onmessage = (%@);", script.toString];
+    } else if (script.isString) {
+        source = script.toString;
+    } else {
+        [self reportError:@"Worker" withText:@"Worker script has to be a function or a string"];
+        return nil;
+    }
+    
+    BeatPluginWorker* worker = [BeatPluginWorker.alloc initWithPlugin:self script:source callback:callback];
+    
+    if (self.workers == nil) self.workers = NSMutableArray.new;
+    [self.workers addObject:worker];
+    
+    return worker;
+}
+
+
 @end
@@ -16,7 +16,7 @@
 - (BeatPluginTimer*)timerFor:(CGFloat)seconds callback:(JSValue*)callback repeats:(bool)repeats
 {
     BeatPluginTimer *timer = [BeatPluginTimer scheduledTimerWithTimeInterval:seconds repeats:repeats block:^(NSTimer * _Nonnull timer) {
-        [self runCallback:callback withArguments:nil];
+        [self runCallback:callback withArguments:nil label:@"timer"];
     }];
     
     // When adding a new timer, remove references to invalid ones
@@ -0,0 +1,277 @@
+//
+//  BeatCLI+Convert.swift
+//  Beat CLI
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+/**
+
+ Batch conversion. Source files are parsed and preprocessed on a bounded worker pool, and every requested format is written
+ from the same preprocessed document. Fonts and stylesheets are loaded once and shared by all jobs.
+
+ PDF output goes through the native print operation, which has to run on main thread, so PDF files are rendered one at a time
+ while other jobs keep working in the background. Results are printed as JSON lines.
+
+ */
+
+import Foundation
+import BeatParsing
+import BeatCore
+import BeatPagination2
+import BeatFileExport
+import ArgumentParser
+
+struct Convert: ParsableCommand {
+    static let configuration = CommandConfiguration(
+        commandName: "convert",
+        abstract: "Convert multiple files into one or more formats"
+    )
+
+    /// Command-line format names mapped to export module names. PDF is handled separately.
+    static let exportFormats = [
+        "fdx": "FDX",
+        "rtf": "RTF",
+        "docx": "Microsoft Word",
+        "epub": "ePub",
+        "outline": "Outline"
+    ]
+
+    @Argument(help: "Source files or directories containing Fountain files")
+    var inputs:[String]
+
+    @Option(name: .shortAndLong, parsing: .upToNextOption, help: "Output formats: pdf fdx rtf docx epub outline")
+    var formats:[String] = ["pdf"]
+
+    @Option(name: .shortAndLong, help: "Output directory. If not set, files are written next to their sources.")
+    var output:String?
+
+    @Option(name: .shortAndLong, help: "Number of parallel jobs. Defaults to the number of CPU cores.")
+    var jobs:Int?
+
+    @Option(name: .shortAndLong, help: "Paper Size: a4/letter")
+    var pageSize:String?
+
+    @Option(help: "Seconds to wait for a single PDF to render before reporting it as failed")
+    var timeout:Double = 60
+
+    public func run() throws {
+        let formats = self.formats.map { $0.lowercased() }
+        let unknownFormats = formats.filter { $0 != "pdf" && Convert.exportFormats[$0] == nil }
+        if unknownFormats.count > 0 {
+            print("ERROR: Unknown formats:", unknownFormats.joined(separator: ", "))
+            throw ExitCode.failure
+        }
+
+        let files = sourceFiles()
+        if files.count == 0 {
+            print("ERROR: No source files found")
+            throw ExitCode.failure
+        }
+
+        // Shared resources are loaded before any jobs start
+        BeatCLI.registerFonts()
+        let manager = BeatFileExportManager.shared
+        if formats.contains("epub") { BeatEPubExport.register(manager) }
+
+        let reporter = ConversionReporter()
+        let styles = StylesheetCache()
+
+        let queue = OperationQueue()
+        queue.name = "beat-cli convert"
+        queue.maxConcurrentOperationCount = max(jobs ?? ProcessInfo.processInfo.activeProcessorCount, 1)
+
+        for url in files {
+            queue.addOperation {
+                autoreleasepool {
+                    convert(url, formats: formats, manager: manager, styles: styles, reporter: reporter)
+                }
+            }
+        }
+
+        // Main thread has to keep its run loop alive for PDF rendering
+        queue.addBarrierBlock {
+            DispatchQueue.main.async { CFRunLoopStop(CFRunLoopGetMain()) }
+        }
+        CFRunLoopRun()
+
+        if reporter.failures > 0 { throw ExitCode.failure }
+    }
+
+    /// Expands directories into the Fountain files they contain
+    func sourceFiles() -> [URL] {
+        let fm = FileManager.default
+        var urls:[URL] = []
+
+        for input in inputs {
+            let url = URL(filePath: input)
+            var isDirectory:ObjCBool = false
+
+            guard fm.fileExists(atPath: url.path(), isDirectory: &isDirectory) else {
+                print("ERROR: File not found:", input)
+                continue
+            }
+
+            if isDirectory.boolValue {
+                let contents = (try? fm.contentsOfDirectory(at: url, includingPropertiesForKeys: nil)) ?? []
+                urls.append(contentsOf: contents.filter { $0.pathExtension.lowercased() == "fountain" }.sorted { $0.path() < $1.path() })
+            } else {
+                urls.append(url)
+            }
+        }
+
+        return urls
+    }
+
+    func convert(_ url:URL, formats:[String], manager:BeatFileExportManager, styles:StylesheetCache, reporter:ConversionReporter) {
+        let start = Date()
+
+        let string:String
+        do {
+            string = try String(contentsOf: url, encoding: .utf8)
+        } catch {
+            reporter.report(file: url, format: nil, output: nil, start: start, error: error.localizedDescription)
+            return
+        }
+
+        let settings = BeatDocumentSettings()
+        let range = settings.readAndReturnRange(string)
+        let fountain = string.substring(range: range)
+
+        let parser = ContinuousFountainParser(staticParsingWith: fountain, settings: settings)
+
+        let exportSettings = BeatExportSettings()
+        exportSettings.paperSize = BeatPaperSize(rawValue: settings.getInt(DocSettingPageSize)) ?? .A4
+        exportSettings.documentSettings = settings
+        if let pageSize { exportSettings.paperSize = pageSize == "a4" ? .A4 : .usLetter }
+
+        let stylesheet = styles.stylesheet(named: settings.getString(DocSettingStylesheet))
+        exportSettings.styles = stylesheet
+
+        let fileName = url.deletingPathExtension().lastPathComponent
+        let directory = (output != nil) ? URL(filePath: output!) : url.deletingLastPathComponent()
+
+        let document = BeatExportDocument(parser: parser, exportSettings: exportSettings, styles: stylesheet, fileName: fileName)
+        reporter.report(file: url, format: "parse", output: nil, start: start, error: nil)
+
+        for format in formats {
+            let formatStart = Date()
+
+            if format == "pdf" {
+                let target = directory.appendingPathComponent(fileName).appendingPathExtension("pdf")
+                let error = renderPDF(document, to: target)
+                reporter.report(file: url, format: format, output: target, start: formatStart, error: error)
+                continue
+            }
+
+            guard let exportFormat = Convert.exportFormats[format] else { continue }
+            let results = manager.export(document: document, formats: [exportFormat], directory: directory, fileName: fileName)
+
+            if let target = results[exportFormat] {
+                reporter.report(file: url, format: format, output: target, start: formatStart, error: nil)
+            } else {
+                reporter.report(file: url, format: format, output: nil, start: formatStart, error: "Export failed")
+            }
+        }
+    }
+
+    /// Renders the PDF on main thread and waits for the result. Returns an error message on failure or timeout.
+    func renderPDF(_ document:BeatExportDocument, to target:URL) -> String? {
+        let semaphore = DispatchSemaphore(value: 0)
+        let lock = NSLock()
+        var errorMessage:String?
+        var timedOut = false
+        var finished = false
+
+        // Screenplay is preprocessed here, on the worker thread
+        let screenplay = document.screenplay
+
+        DispatchQueue.main.async {
+            var printView:BeatPrintView?
+            printView = BeatPrintView(window: nil, operation: .toFile, settings: document.exportSettings, delegate: nil, screenplays: [screenplay]) { _, result in
+                defer {
+                    printView = nil
+                    semaphore.signal()
+                }
+
+                lock.lock()
+                defer { lock.unlock() }
+
+                // The file was already reported as failed, don't write it anymore
+                if timedOut { return }
+                finished = true
+
+                guard let tempURL = result as? URL else {
+                    errorMessage = "PDF rendering failed"
+                    return
+                }
+
+                do {
+                    let fm = FileManager.default
+                    if fm.fileExists(atPath: target.path()) {
+                        _ = try fm.replaceItemAt(target, withItemAt: tempURL)
+                    } else {
+                        try fm.moveItem(at: tempURL, to: target)
+                    }
+                } catch {
+                    errorMessage = error.localizedDescription
+                }
+            }
+        }
+
+        let result = semaphore.wait(timeout: .now() + timeout)
+
+        lock.lock()
+        defer { lock.unlock() }
+
+        if result == .timedOut && !finished {
+            timedOut = true
+            return "PDF rendering timed out after \(timeout) seconds"
+        }
+        return errorMessage
+    }
+}
+
+/// Prints conversion results as JSON lines
+final class ConversionReporter {
+    private let lock = NSLock()
+    private(set) var failures = 0
+
+    func report(file:URL, format:String?, output:URL?, start:Date, error:String?) {
+        var result:[String:Any] = [
+            "file": file.path(),
+            "seconds": (Date().timeIntervalSince(start) * 1000).rounded() / 1000,
+            "status": (error == nil) ? "ok" : "failed"
+        ]
+        if let format { result["format"] = format }
+        if let output { result["output"] = output.path() }
+        if let error { result["error"] = error }
+
+        guard let data = try? JSONSerialization.data(withJSONObject: result, options: [.sortedKeys]),
+              let line = String(data: data, encoding: .utf8) else { return }
+
+        lock.lock()
+        if error != nil { failures += 1 }
+        print(line)
+        fflush(stdout)
+        lock.unlock()
+    }
+}
+
+/// Stylesheets are loaded once per name and shared between jobs
+final class StylesheetCache {
+    private let lock = NSLock()
+    private var stylesheets:[String:BeatStylesheet] = [:]
+
+    func stylesheet(named name:String?) -> BeatStylesheet {
+        let name = name ?? ""
+
+        lock.lock()
+        defer { lock.unlock() }
+
+        if let stylesheet = stylesheets[name] { return stylesheet }
+
+        let stylesheet = BeatStyles.shared.styles(name: name.count > 0 ? name : nil)
+        stylesheets[name] = stylesheet
+        return stylesheet
+    }
+}
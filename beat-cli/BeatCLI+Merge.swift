@@ -0,0 +1,86 @@
+//
+//  BeatCLI+Merge.swift
+//  Beat CLI
+//
+//  Created by Lauri-Matti Parppei on 19.10.2026.
+//
+/**
+
+ Headless three-way merge. If no base file is given, the latest common commit in version control history is used.
+
+ */
+
+import Foundation
+import BeatParsing
+import BeatCore
+import ArgumentParser
+
+struct Merge: ParsableCommand {
+    static let configuration = CommandConfiguration(
+        commandName: "merge",
+        abstract: "Merge two versions of the same screenplay"
+    )
+
+    @Argument(help: "Path to our version")
+    var oursURL:String
+
+    @Argument(help: "Path to their version")
+    var theirsURL:String
+
+    @Option(name: .shortAndLong, help: "Path to common ancestor. If not set, the latest common version control commit is used.")
+    var base:String?
+
+    @Option(name: .shortAndLong, help: "Path to target file. If not set, our version is overwritten.")
+    var output:String?
+
+    public func run() throws {
+        let start = Date()
+
+        guard let ours = read(oursURL), let theirs = read(theirsURL) else {
+            throw ExitCode.failure
+        }
+
+        var merge:BeatThreeWayMerge?
+
+        if let base {
+            guard let baseString = read(base) else { throw ExitCode.failure }
+            merge = BeatThreeWayMerge(base: baseString, ours: ours, theirs: theirs)
+        } else {
+            merge = BeatThreeWayMerge.withCommonAncestor(ours: ours, theirs: theirs)
+        }
+
+        guard let merge else {
+            print("ERROR: No common ancestor found. Enable version control in both documents or provide a base file with --base.")
+            throw ExitCode.failure
+        }
+
+        merge.oursLabel = URL(filePath: oursURL).lastPathComponent
+        merge.theirsLabel = URL(filePath: theirsURL).lastPathComponent
+
+        let result = merge.merge()
+        let targetURL = URL(filePath: output ?? oursURL)
+
+        do {
+            try result.document.write(to: targetURL, atomically: true, encoding: .utf8)
+        } catch {
+            print("ERROR: Failed to write merged file at", targetURL)
+            print(error)
+            throw ExitCode.failure
+        }
+
+        print(String(format: "Merged in %.3f s, %ld segments auto-merged, %ld conflicts", Date().timeIntervalSince(start), result.autoMerged, result.conflicts))
+
+        // Unresolved conflicts are reported with a non-zero exit code, similar to git
+        if result.conflicts > 0 { throw ExitCode(1) }
+    }
+
+    func read(_ path:String) -> String? {
+        do {
+            return try String(contentsOf: URL(filePath: path), encoding: .utf8)
+        } catch {
+            print("ERROR: Failed to read file at", path)
+            print(error)
+            return nil
+        }
+    }
+}
@@ -21,11 +21,11 @@ import ArgumentParser
 struct BeatCLI:ParsableCommand {
     static let configuration = CommandConfiguration(
         abstract: "Command-line interface for (beat)",
-        subcommands: [CreatePDF.self]
+        subcommands: [CreatePDF.self, Merge.self, Convert.self]
     )
     
     func run() throws {
-        print("(beat) CLI interface\nUsage: beat-cli pdf [source] [target] [options]. Use 'beat-cli pdf --help' for more help.")
+        print("(beat) CLI interface\nUsage: beat-cli pdf [source] [target] [options]. Use 'beat-cli pdf --help' for more help.\nbeat-cli merge [ours] [theirs] [options] merges two versions of the same screenplay.\nbeat-cli convert [files or folders] --formats pdf fdx rtf docx epub outline converts files in parallel.")
     }
     
 }